@@ -42,10 +42,19 @@ namespace backlot
 	 * nextByte() can be used to align the current position in order to
 	 * minimize CPU usage, although this usually comes with a larger buffer
 	 * size.
+	 *
+	 * The memory grows geometrically, so appending data only rarely needs
+	 * a reallocation. reserve() can be used to allocate enough memory for a
+	 * message of known size at once.
 	 */
 	class Buffer : public ReferenceCounted
 	{
 		public:
+			/**
+			 * Function which returns borrowed memory to its owner.
+			 */
+			typedef void (*ReleaseCallback)(void *context);
+
 			/**
 			 * Constructor.
 			 */
@@ -59,6 +68,19 @@ namespace backlot
 			 * destroyed.
 			 */
 			Buffer(void *data, unsigned int size, bool copy = false);
+			/**
+			 * Constructor which borrows memory owned by someone else, for
+			 * example the data of a received network packet, without copying
+			 * it.
+			 * @param data Pointer to the new buffer content.
+			 * @param size Length of the data.
+			 * @param release Called with context instead of freeing the
+			 * memory when the buffer is destroyed. If the buffer has to grow,
+			 * the data is copied first and the memory is released early.
+			 * @param context Parameter passed to release.
+			 */
+			Buffer(void *data, unsigned int size, ReleaseCallback release,
+				void *context);
 			/**
 			 * Copy constructor.
 			 */
@@ -77,6 +99,16 @@ namespace backlot
 			 * Returns the size of the buffer.
 			 */
 			unsigned int getSize();
+			/**
+			 * Makes sure that the buffer can hold at least capacity bytes
+			 * without reallocating its memory.
+			 */
+			void reserve(unsigned int capacity);
+			/**
+			 * Returns the number of bytes the buffer can hold without
+			 * reallocating its memory.
+			 */
+			unsigned int getCapacity();
 
 			/**
 			 * Sets the read/write position.
@@ -163,6 +195,47 @@ namespace backlot
 			 */
 			unsigned int readUnsignedInt(unsigned int size);
 
+			/**
+			 * Writes an unsigned integer as a varint: 7 bits per byte, the
+			 * highest bit of each byte is set if another byte follows. Values
+			 * below 128 take one byte, the largest ones take five. Like all
+			 * other data, the bytes are not aligned.
+			 */
+			void writeVarInt(uint32_t value);
+			/**
+			 * Reads a varint written by writeVarInt().
+			 */
+			uint32_t readVarInt();
+			/**
+			 * Writes a signed integer as a varint after zigzag encoding
+			 * (0, -1, 1, -2, 2, ... become 0, 1, 2, 3, 4, ...), so that
+			 * values with a small magnitude take little space.
+			 */
+			void writeZigZag(int32_t value);
+			/**
+			 * Reads an integer written by writeZigZag().
+			 */
+			int32_t readZigZag();
+			/**
+			 * Writes an unsigned integer with exponential-Golomb coding of
+			 * the given order. Values below 2^order take order + 1 bits, and
+			 * every doubling of the value costs two more bits. Order 0 is
+			 * the Elias gamma code of value + 1.
+			 */
+			void writeExpGolomb(uint32_t value, unsigned int order = 0);
+			/**
+			 * Reads an integer written by writeExpGolomb().
+			 */
+			uint32_t readExpGolomb(unsigned int order = 0);
+
+			/**
+			 * Writes the first bits bits of another buffer at the current
+			 * position. Unlike operator+=, this also works if the current
+			 * position is not aligned to a byte boundary and can be used to
+			 * splice preencoded data into a bit-packed stream.
+			 */
+			void writeBits(const Buffer &buf, unsigned int bits);
+
 			/**
 			 * Rounds the read/write position up to the next byte. This is
 			 * useful to reduce CPU load if there is no gain from using bit
@@ -183,17 +256,26 @@ namespace backlot
 			 * Dumps the buffer to stdout.
 			 */
 			void dump();
+		protected:
+			/**
+			 * Returns buffers created by BufferPool to the pool.
+			 */
+			virtual void dispose() const;
 		private:
 			/**
-			 * Writes one byte to the buffer, does not change the current
-			 * position.
+			 * Makes sure that the buffer memory can hold at least size bytes.
+			 * The capacity is at least doubled if the memory has to grow.
 			 */
-			void writeByte(unsigned char value);
+			void grow(unsigned int size);
 			/**
-			 * Reads one byte from the buffer, does not change the current
-			 * position.
+			 * Resizes the buffer memory to capacity bytes without changing the
+			 * buffer size.
 			 */
-			unsigned char readByte();
+			void reallocate(unsigned int capacity);
+			/**
+			 * Frees or releases the buffer memory.
+			 */
+			void freeData();
 
 			/**
 			 * Buffer data.
@@ -203,10 +285,26 @@ namespace backlot
 			 * Buffer size in bytes.
 			 */
 			unsigned int size;
+			/**
+			 * Size of the allocated memory in bytes. The memory behind the
+			 * data is always zeroed.
+			 */
+			unsigned int capacity;
 			/**
 			 * Read/write position in bits.
 			 */
 			unsigned int position;
+			/**
+			 * Callback for borrowed memory, 0 if the buffer owns its data.
+			 */
+			ReleaseCallback release;
+			void *releasecontext;
+			/**
+			 * True if the buffer was created by BufferPool.
+			 */
+			bool pooled;
+
+			friend class BufferPool;
 	};
 
 	typedef SharedPointer<Buffer> BufferPointer;
@@ -0,0 +1,110 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _BUFFERPOOL_HPP_
+#define _BUFFERPOOL_HPP_
+
+#include "Buffer.hpp"
+
+#include <pthread.h>
+#include <vector>
+
+namespace backlot
+{
+	/**
+	 * Free list of buffers which are reused instead of being allocated for
+	 * every message. Buffers from allocate() go back to the pool when the
+	 * last BufferPointer to them is dropped and keep their memory, so once
+	 * the pool has warmed up, creating the network messages of a tick does
+	 * not allocate any memory.
+	 *
+	 * Every thread has a small cache of free buffers which is used without
+	 * locking. Buffers are often dropped by a different thread than the one
+	 * which created them (e.g. the network thread after sending them), so
+	 * full caches pass half of their buffers to a shared list from which
+	 * empty caches are refilled.
+	 */
+	class BufferPool
+	{
+		public:
+			/**
+			 * Returns the global pool.
+			 */
+			static BufferPool &get();
+
+			/**
+			 * Returns an empty buffer.
+			 * @param capacity Minimum capacity of the buffer.
+			 */
+			BufferPointer allocate(unsigned int capacity = 0);
+
+			/**
+			 * Returns the number of allocate() calls which reused a buffer.
+			 */
+			unsigned int getHits();
+			/**
+			 * Returns the number of allocate() calls which had to create a
+			 * new buffer.
+			 */
+			unsigned int getMisses();
+			/**
+			 * Returns the number of free buffers in the pool.
+			 */
+			unsigned int getSize();
+			/**
+			 * Returns the highest number of free buffers which were in the
+			 * pool at the same time.
+			 */
+			unsigned int getHighWater();
+		private:
+			BufferPool();
+			~BufferPool();
+
+			/**
+			 * Puts a buffer which is not referenced any more back into the
+			 * pool.
+			 */
+			void recycle(Buffer *buffer);
+
+			typedef std::vector<Buffer*> Cache;
+			/**
+			 * Returns the cache of the current thread.
+			 */
+			Cache *getCache();
+			/**
+			 * Moves the buffers of a thread which exits to the shared list.
+			 */
+			static void destroyCache(void *cache);
+
+			pthread_mutex_t mutex;
+			std::vector<Buffer*> shared;
+			pthread_key_t cachekey;
+
+			long hits;
+			long misses;
+			long size;
+			long highwater;
+
+			friend class Buffer;
+	};
+}
+
+#endif
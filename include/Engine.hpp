@@ -82,6 +82,14 @@ namespace backlot
 			 * Stops execution after the next frame.
 			 */
 			void stop();
+			#if defined(CLIENT)
+			/**
+			 * Returns how far the current frame lies between the last two
+			 * simulation ticks, from 0 (previous tick) to 1 (last tick).
+			 * Used to interpolate positions when rendering.
+			 */
+			float getFrameAlpha();
+			#endif
 
 			static uint64_t getTime()
 			{
@@ -102,6 +110,9 @@ namespace backlot
 			std::string directory;
 
 			uint64_t lastframe;
+			#if defined(CLIENT)
+			float framealpha;
+			#endif
 
 			bool stopping;
 	};
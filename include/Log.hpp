@@ -0,0 +1,232 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _LOG_HPP_
+#define _LOG_HPP_
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string>
+#include <fstream>
+
+namespace backlot
+{
+	enum LogLevel
+	{
+		ELL_Debug,
+		ELL_Info,
+		ELL_Warning,
+		ELL_Error
+	};
+
+	/**
+	 * Single log line. Formats the values written to it into a fixed size
+	 * buffer without allocating any memory, longer messages are cut off.
+	 */
+	class LogMessage
+	{
+		public:
+			static const unsigned int MAX_LENGTH = 512;
+
+			LogMessage();
+
+			const char *getText() const
+			{
+				return text;
+			}
+			unsigned int getLength() const
+			{
+				return length;
+			}
+
+			LogMessage &operator<<(const char *s);
+			LogMessage &operator<<(const std::string &s);
+			LogMessage &operator<<(const unsigned char *s);
+			LogMessage &operator<<(char c);
+			LogMessage &operator<<(bool b);
+			LogMessage &operator<<(int i);
+			LogMessage &operator<<(unsigned int i);
+			LogMessage &operator<<(long i);
+			LogMessage &operator<<(unsigned long i);
+			LogMessage &operator<<(long long i);
+			LogMessage &operator<<(unsigned long long i);
+			LogMessage &operator<<(double d);
+			LogMessage &operator<<(const void *p);
+		private:
+			void append(const char *s, unsigned int size);
+
+			char text[MAX_LENGTH];
+			unsigned int length;
+	};
+
+	/**
+	 * State of a single log statement, used for rate limiting.
+	 */
+	struct LogSite
+	{
+		uint64_t window;
+		unsigned int count;
+		unsigned int suppressed;
+	};
+
+	/**
+	 * Asynchronous logger. Messages are put into a lock-free ring buffer and
+	 * written by a separate thread, so logging only costs formatting the
+	 * message in the calling thread. If the ring buffer is full, messages
+	 * are dropped instead of blocking the caller. Until init() is called,
+	 * messages are written immediately.
+	 *
+	 * Messages are usually written with the LOG_* macros, which also limit
+	 * every single log statement to a few messages per second. LOG_DEBUG
+	 * is removed completely in builds with NDEBUG defined.
+	 */
+	class Log
+	{
+		public:
+			static Log &get();
+			/**
+			 * Destructor. Writes all remaining messages.
+			 */
+			~Log();
+
+			/**
+			 * Starts the writer thread.
+			 */
+			bool init();
+			/**
+			 * Writes all remaining messages and stops the writer thread.
+			 */
+			void destroy();
+
+			/**
+			 * Writes all following messages into a file instead of stdout
+			 * and stderr.
+			 */
+			bool setFile(std::string filename);
+
+			/**
+			 * Sets the lowest level which is written.
+			 */
+			void setLevel(LogLevel level);
+			LogLevel getLevel()
+			{
+				return level;
+			}
+			bool isEnabled(LogLevel level)
+			{
+				return level >= this->level;
+			}
+
+			/**
+			 * Sets how many messages a single log statement may write per
+			 * second. 0 disables rate limiting.
+			 */
+			void setRateLimit(unsigned int messages);
+
+			/**
+			 * Queues a message.
+			 */
+			void write(LogLevel level, const LogMessage &message);
+			/**
+			 * Checks whether the rate limit of a log statement allows
+			 * another message.
+			 */
+			bool allow(LogSite &site);
+			/**
+			 * Queues a message of a rate limited log statement. Also reports
+			 * how many messages of the statement were suppressed.
+			 */
+			void write(LogLevel level, const LogMessage &message,
+				LogSite &site);
+
+			/**
+			 * Waits until all queued messages have been written.
+			 */
+			void flush();
+		private:
+			Log();
+
+			static void *writerMain(void *log);
+			bool writeNext();
+			void output(LogLevel level, const char *text,
+				unsigned int length);
+
+			static const unsigned int RING_SIZE = 1024;
+			struct Entry
+			{
+				volatile unsigned int sequence;
+				LogLevel level;
+				unsigned int length;
+				char text[LogMessage::MAX_LENGTH];
+			};
+			Entry *ring;
+			volatile unsigned int writeposition;
+			volatile unsigned int readposition;
+			volatile unsigned int dropped;
+
+			pthread_t writer;
+			pthread_mutex_t outputmutex;
+			volatile bool running;
+			volatile bool stopping;
+
+			std::ofstream file;
+
+			LogLevel level;
+			unsigned int ratelimit;
+	};
+}
+
+#ifndef NDEBUG
+#define LOG_DEBUG(message) LOG_WRITE(backlot::ELL_Debug, message)
+#else
+// Still compiled so that debug messages cannot break, but never executed
+#define LOG_DEBUG(message) \
+	do \
+	{ \
+		if (0) \
+		{ \
+			backlot::LogMessage logmessage; \
+			logmessage << message; \
+		} \
+	} \
+	while (0)
+#endif
+#define LOG_INFO(message) LOG_WRITE(backlot::ELL_Info, message)
+#define LOG_WARNING(message) LOG_WRITE(backlot::ELL_Warning, message)
+#define LOG_ERROR(message) LOG_WRITE(backlot::ELL_Error, message)
+
+#define LOG_WRITE(level, message) \
+	do \
+	{ \
+		if (backlot::Log::get().isEnabled(level)) \
+		{ \
+			static backlot::LogSite logsite = {0, 0, 0}; \
+			if (backlot::Log::get().allow(logsite)) \
+			{ \
+				backlot::LogMessage logmessage; \
+				logmessage << message; \
+				backlot::Log::get().write(level, logmessage, logsite); \
+			} \
+		} \
+	} \
+	while (0)
+
+#endif
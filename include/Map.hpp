@@ -87,6 +87,17 @@ namespace backlot
 			bool isAccessible(Vector2F start, Vector2F end, float maxheight,
 				Vector2F *collision = 0);
 
+			/**
+			 * Moves an entity with the given speed (units per second) for
+			 * one tick. The entity stays where it is if the step would end
+			 * on a square which is too high to climb. This is the movement
+			 * of Entity::update() on both server and client, the client uses
+			 * it as well to repeat the movement when the prediction was
+			 * wrong, so both have to use exactly the same code.
+			 * @return New position.
+			 */
+			Vector2F move(Vector2F position, Vector2F speed);
+
 		protected:
 			bool readHeader(std::ifstream &file);
 
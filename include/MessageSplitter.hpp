@@ -0,0 +1,50 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _MESSAGESPLITTER_HPP_
+#define _MESSAGESPLITTER_HPP_
+
+#include "Buffer.hpp"
+
+#include <vector>
+
+namespace backlot
+{
+	/**
+	 * Unpacks the packets received from the server into the messages they
+	 * contain. EPT_Compressed packets are decompressed and EPT_Batch packets
+	 * are split into their parts, so that the clients only have to handle
+	 * plain messages. Every returned message starts with its packet type.
+	 */
+	class MessageSplitter
+	{
+		public:
+			/**
+			 * Appends all messages contained in a packet to a list.
+			 * @return False if the packet is corrupt. The messages before
+			 * the error are still appended.
+			 */
+			static bool split(BufferPointer packet,
+				std::vector<BufferPointer> &messages);
+	};
+}
+
+#endif
@@ -26,6 +26,12 @@ namespace backlot
 {
 	enum PacketType
 	{
+		/**
+		 * Sent by the client once the map is loaded. Contains the wanted
+		 * NetworkFeature flags (8 bits) and the number of ticks remote
+		 * entities are drawn behind the current tick (8 bits), which the
+		 * server adds to the lag compensation. Older clients send neither.
+		 */
 		EPT_Ready = 1,
 		EPT_InitialData,
 		EPT_MapChange,
@@ -34,9 +40,52 @@ namespace backlot
 		EPT_ActivateEntity,
 		EPT_DeactivateEntity,
 		EPT_Rotation,
+		/**
+		 * Input of the client for the last ticks, sent unreliably every
+		 * tick. Contains the client time (32 bits) and the sequence number
+		 * of the newest input command (32 bits). Then for every local entity
+		 * with input properties the entity ID + 1 (16 bits), the number of
+		 * commands (8 bits) and the commands from the oldest to the newest,
+		 * each with the values of the EPF_Input properties. Ends with an
+		 * entity ID of 0.
+		 */
 		EPT_Keys,
 		EPT_Update,
-		EPT_UpdateReceived
+		EPT_UpdateReceived,
+		/**
+		 * Packet coded by PacketCompressor. Only sent to clients which asked
+		 * for compression in EPT_Ready.
+		 */
+		EPT_Compressed,
+		/**
+		 * Several reliable messages in one packet, each prefixed with its
+		 * size in bytes (16 bits).
+		 */
+		EPT_Batch,
+		/**
+		 * Server load information, sent once per second to clients which
+		 * asked for ENF_Statistics.
+		 */
+		EPT_ServerStatistics
+	};
+	/**
+	 * ENet channels. Reliable messages use their own channel so that they
+	 * are not held back by or hold back the unreliable update stream.
+	 */
+	enum NetworkChannel
+	{
+		ENC_Updates = 0,
+		ENC_Reliable = 1
+	};
+	/**
+	 * Optional protocol features. The server lists the features it supports
+	 * in EPT_InitialData, the client replies with the ones it wants to use
+	 * in EPT_Ready.
+	 */
+	enum NetworkFeature
+	{
+		ENF_Compression = 0x01,
+		ENF_Statistics = 0x02
 	};
 	enum KeyMask
 	{
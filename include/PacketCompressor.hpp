@@ -0,0 +1,58 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _PACKETCOMPRESSOR_HPP_
+#define _PACKETCOMPRESSOR_HPP_
+
+#include "Buffer.hpp"
+
+namespace backlot
+{
+	/**
+	 * Entropy coder for network packets. Packets are coded byte by byte with
+	 * an adaptive binary range coder, every byte is split into 8 binary
+	 * decisions with their own probabilities (order 0, like the literal
+	 * coder in LZMA). The model adapts within a few bytes, which matters as
+	 * every packet has to be decodable on its own because unreliable packets
+	 * can get lost.
+	 *
+	 * Compressed packets start with EPT_Compressed followed by the
+	 * uncompressed size (16 bits) and the coded data.
+	 */
+	class PacketCompressor
+	{
+		public:
+			/**
+			 * Compresses a complete packet.
+			 * @return EPT_Compressed packet or 0 if compression would not make
+			 * the packet smaller.
+			 */
+			static BufferPointer compress(BufferPointer packet);
+			/**
+			 * Restores the original packet from a compressed one. The read
+			 * position has to be directly behind the packet type.
+			 * @return Uncompressed packet or 0 if the data is corrupt.
+			 */
+			static BufferPointer decompress(BufferPointer packet);
+	};
+}
+
+#endif
@@ -38,6 +38,34 @@ namespace backlot
 		unsigned int state;
 	};
 
+	class PathFinder;
+
+	/**
+	 * Search grid and job queue shared by the path finders of one game. Every
+	 * thread running a game has its own context, see setCurrent().
+	 */
+	struct PathFinderContext
+	{
+		PathFinderContext();
+		~PathFinderContext();
+
+		/**
+		 * Returns the context of the calling thread. Threads which did not
+		 * set one use a global default context.
+		 */
+		static PathFinderContext *getCurrent();
+		/**
+		 * Sets the context used by path finders created in the calling
+		 * thread and by PathFinder::updateAll().
+		 */
+		static void setCurrent(PathFinderContext *context);
+
+		PathFinderCell *grid;
+		Vector2I gridsize;
+		unsigned int lastgridid;
+		std::queue<SharedPointer<PathFinder> > jobs;
+	};
+
 	/**
 	 * Status of a path finding request.
 	 */
@@ -107,7 +135,7 @@ namespace backlot
 			Vector2F getNextWaypoint(Vector2F currentposition);
 
 			/**
-			 * Updates all path finders.
+			 * Updates all path finders of the current context.
 			 */
 			static void updateAll();
 			/**
@@ -132,9 +160,7 @@ namespace backlot
 			MapPointer map;
 
 			unsigned char *accessibility;
-			static PathFinderCell *grid;
-			static Vector2I gridsize;
-			static unsigned int lastgridid;
+			PathFinderContext *context;
 			Vector2I start;
 			Vector2I end;
 
@@ -159,8 +185,6 @@ namespace backlot
 
 			PathFinderStatus status;
 			std::list<Vector2F> path;
-
-			static std::queue<SharedPointer<PathFinder> > pathjobs;
 	};
 
 	typedef SharedPointer<PathFinder> PathFinderPointer;
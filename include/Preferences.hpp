@@ -124,6 +124,26 @@ namespace backlot
 			 * @param frequency The new frequency.
 			 */
 			void setFrequency(int frequency);
+
+			/**
+			 * Returns the time in milliseconds by which remote entities are
+			 * drawn behind the latest server update. Should be larger than
+			 * the usual interval between updates.
+			 */
+			int getInterpolationDelay() const;
+			/**
+			 * Sets the interpolation delay in milliseconds.
+			 */
+			void setInterpolationDelay(int delay);
+			/**
+			 * Returns the time in milliseconds for which remote entities are
+			 * moved on if no newer update has arrived.
+			 */
+			int getMaxExtrapolation() const;
+			/**
+			 * Sets the maximum extrapolation time in milliseconds.
+			 */
+			void setMaxExtrapolation(int extrapolation);
 		private:
 			/**
 			 * The private constructor.
@@ -139,6 +159,9 @@ namespace backlot
 			 bool stereo;
 			 int frequency;
 			 int bitrate;
+
+			 int interpolationdelay;
+			 int maxextrapolation;
 	};
 }
 #endif
@@ -22,6 +22,10 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #ifndef _REFERENCECOUNTED_HPP_
 #define _REFERENCECOUNTED_HPP_
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 namespace backlot
 {
 	template<typename T> struct remove_const
@@ -100,6 +104,9 @@ namespace backlot
 	 * This is done via grab() (increments the reference count) and drop()
 	 * (decrements the reference count). When the reference count reaches 0, the
 	 * object is destroyed.
+	 * The reference count is changed atomically, so different threads can
+	 * share pointers to the same object as long as they do not modify the
+	 * object itself. Weak pointers are not thread-safe.
 	 */
 	class ReferenceCounted
 	{
@@ -121,22 +128,38 @@ namespace backlot
 			 */
 			void grab() const
 			{
-				refcount++;
+#ifdef _MSC_VER
+				_InterlockedIncrement(&refcount);
+#else
+				__sync_add_and_fetch(&refcount, 1);
+#endif
 			}
 			/**
 			 * Decrements the reference count.
 			 */
 			void drop() const
 			{
-				refcount--;
-				if (refcount <= 0)
-					delete this;
+#ifdef _MSC_VER
+				if (_InterlockedDecrement(&refcount) <= 0)
+#else
+				if (__sync_sub_and_fetch(&refcount, 1) <= 0)
+#endif
+					dispose();
+			}
+		protected:
+			/**
+			 * Called when the last reference has been dropped. Deletes the
+			 * object, classes which recycle their objects can override this.
+			 */
+			virtual void dispose() const
+			{
+				delete this;
 			}
 		private:
 			/**
 			 * Number of references to the object.
 			 */
-			mutable int refcount;
+			mutable long refcount;
 
 			GenericWeakPointer *weakptr;
 
@@ -0,0 +1,100 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _REPLAYDATA_HPP_
+#define _REPLAYDATA_HPP_
+
+/**
+ * Replay file format, written by ReplayRecorder on the server.
+ *
+ * A replay starts with a header (REPLAY_MAGIC, version, tick length in
+ * microseconds and keyframe interval, 32 bit each) followed by records. Every
+ * record starts with the tick (32 bits), the record type (8 bits) and the
+ * size of the payload in bytes (32 bits). The payload is a sequence of
+ * changes, each starting with a ReplayChangeType and padded to full bytes,
+ * and ends with ERC_End. All values are in network byte order like in the
+ * network packets. Zero bytes after the last record (a type of 0) mark the
+ * end of the file.
+ *
+ * The index file (replay name + ".idx") contains the tick (32 bits) and the
+ * file offset (64 bits) of every keyframe. For keyframes which are spread
+ * over several records the offset is the one of the ERT_KeyframeStart record
+ * and the tick is the one of the record which completes the keyframe.
+ */
+
+namespace backlot
+{
+	static const char REPLAY_MAGIC[4] = {'B', 'L', 'R', 'P'};
+	static const unsigned int REPLAY_VERSION = 2;
+	static const unsigned int REPLAY_HEADER_SIZE = 16;
+	static const unsigned int REPLAY_RECORD_HEADER_SIZE = 9;
+	static const unsigned int REPLAY_INDEX_ENTRY_SIZE = 12;
+
+	enum ReplayRecordType
+	{
+		/**
+		 * Complete state of the game at the end of the tick. Contains one
+		 * ERC_Created change for every entity, all other entities are
+		 * removed.
+		 */
+		ERT_Keyframe = 1,
+		/**
+		 * Changes since the last record.
+		 */
+		ERT_Delta,
+		/**
+		 * Start of a keyframe which took too long to be written in one tick.
+		 * Contains the changes since the last record like ERT_Delta and the
+		 * ERC_Created changes for a part of the entities. The remaining
+		 * entities follow as ERC_Created changes in the next ERT_Delta
+		 * records, until then their updates are written as
+		 * ERC_PendingUpdate.
+		 */
+		ERT_KeyframeStart
+	};
+	enum ReplayChangeType
+	{
+		ERC_End = 0,
+		/**
+		 * Entity ID (16 bits), owner (16 bits), template name and the
+		 * state as written by Entity::getState().
+		 */
+		ERC_Created,
+		/**
+		 * Entity ID (16 bits).
+		 */
+		ERC_Deleted,
+		/**
+		 * Entity ID (16 bits) and the changed properties as written by
+		 * Entity::getUpdate().
+		 */
+		ERC_Update,
+		/**
+		 * Entity ID (16 bits), the size of the update in bytes (16 bits) and
+		 * the update like ERC_Update. Used for entities which are not yet
+		 * part of the current keyframe, readers starting at that keyframe
+		 * do not know the entity yet and skip the update.
+		 */
+		ERC_PendingUpdate
+	};
+}
+
+#endif
@@ -46,7 +46,20 @@ namespace backlot
 
 			void setCallback(ScriptPointer script, std::string function);
 
+			/**
+			 * Calls the callbacks of all expired timers of the current
+			 * timer list.
+			 */
 			static void callCallbacks();
+
+			/**
+			 * Sets the list the timers started by the calling thread are
+			 * added to, so that every game running in its own thread only
+			 * calls its own timers. Threads which did not set a list use a
+			 * global default list.
+			 */
+			static void setTimerList(std::vector<Timer*> *list);
+			static std::vector<Timer*> *getTimerList();
 		private:
 			ScriptPointer script;
 			std::string function;
@@ -56,8 +69,7 @@ namespace backlot
 			unsigned int time;
 			uint64_t starttime;
 			bool running;
-
-			static std::vector<Timer*> timers;
+			std::vector<Timer*> *list;
 	};
 }
 
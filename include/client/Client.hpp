@@ -56,7 +56,16 @@ namespace backlot
 		private:
 			Client();
 
+			/**
+			 * Parses a message from the server. Compressed packets and
+			 * batches are split by MessageSplitter before.
+			 * @return False if the message could not be handled and the
+			 * connection is unusable.
+			 */
+			bool handleMessage(BufferPointer msg);
+
 			ClientMapPointer map;
+			std::vector<BufferPointer> messages;
 
 			ENetHost *host;
 			ENetPeer *peer;
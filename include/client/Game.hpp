@@ -25,6 +25,8 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Script.hpp"
 #include "entity/Entity.hpp"
 #include "entity/EntityList.hpp"
+#include "entity/EntityTable.hpp"
+#include "entity/EntityGrid.hpp"
 #include "Client.hpp"
 #include "Rectangle.hpp"
 
@@ -61,10 +63,26 @@ namespace backlot
 			 * Returns the number of ticks passed since the start of the game.
 			 */
 			unsigned int getTime();
+			/**
+			 * Returns the tick at which remote entities are drawn. This is
+			 * the time of the current frame minus the interpolation delay.
+			 * The time is taken from a local clock which advances every
+			 * tick and slowly follows the newest server update.
+			 */
+			float getRenderTime();
+			/**
+			 * Returns the number of ticks remote entities are drawn behind
+			 * the latest server update.
+			 */
+			float getInterpolationDelay();
+			/**
+			 * Returns the maximum number of ticks remote entities are
+			 * extrapolated past their last snapshot.
+			 */
+			float getMaxExtrapolation();
 
 			void injectUpdates(BufferPointer buffer);
 
-			void setAcknowledgedPacket(int time);
 			void setLag(unsigned int lag);
 
 			void setInputTarget(EntityPointer entity);
@@ -75,6 +93,25 @@ namespace backlot
 			EntityListPointer getEntities(RectangleF area, std::string type);
 			EntityListPointer getEntities(RectangleF area);
 			EntityListPointer getEntities(std::string type);
+			/**
+			 * Returns all movable entities which are at most radius away
+			 * from the center. An empty type matches all entities.
+			 */
+			EntityListPointer getEntitiesInRadius(Vector2F center,
+				float radius, std::string type);
+			/**
+			 * Returns the movable entity nearest to the position or 0 if
+			 * there is none within maxdistance. An empty type matches all
+			 * entities.
+			 */
+			EntityPointer getNearestEntity(Vector2F position,
+				float maxdistance, std::string type);
+
+			/**
+			 * Called by entities when their position has changed, keeps the
+			 * spatial index up to date.
+			 */
+			void onEntityMoved(Entity *entity);
 
 			void update();
 		private:
@@ -83,13 +120,32 @@ namespace backlot
 			int clientid;
 			std::string mapname;
 
-			EntityPointer entities[65535];
-			std::list<EntityPointer> localentities;
-			int maxentityid;
+			EntityTable entities;
+			EntityGrid grid;
+			std::vector<int> queryresult;
+			std::vector<EntityPointer> updateentities;
 			WeakPointer<Entity> inputentity;
 
 			unsigned int time;
 			unsigned int lag;
+			/**
+			 * Sequence number of the last input command, see EPT_Keys.
+			 * Unlike the time it is not changed by server updates, so it
+			 * always increases by one per tick.
+			 */
+			unsigned int inputsequence;
+			/**
+			 * Server tick of the newest update received so far.
+			 */
+			unsigned int newestupdate;
+			/**
+			 * Estimate of the current server tick used for drawing remote
+			 * entities, see getRenderTime().
+			 */
+			float renderclock;
+
+			float interpolationdelay;
+			float maxextrapolation;
 	};
 }
 
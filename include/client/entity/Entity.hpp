@@ -35,11 +35,24 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 namespace backlot
 {
-	struct SpeedInfo
+	/**
+	 * Position of a local entity at the end of a tick as predicted by the
+	 * client, together with the speed it moved with during the tick.
+	 */
+	struct PredictedState
 	{
-		int time;
+		int tick;
+		Vector2F position;
 		Vector2F speed;
 	};
+	/**
+	 * Position of a remote entity as sent by the server for one tick.
+	 */
+	struct PositionSnapshot
+	{
+		int time;
+		Vector2F position;
+	};
 
 	class Entity : public ReferenceCounted
 	{
@@ -69,6 +82,13 @@ namespace backlot
 			bool isMovable();
 			void setPosition(const Vector2F &position);
 			Vector2F getPosition();
+			/**
+			 * Returns the position at which the entity is drawn. For remote
+			 * entities this is interpolated between the snapshots around
+			 * Game::getRenderTime(), local entities are drawn between their
+			 * positions of the last two ticks.
+			 */
+			Vector2F getRenderPosition();
 			void setSpeed(Vector2F speed, bool ignoreobstacles);
 			Vector2F getSpeed();
 			RectangleF getRectangle();
@@ -84,10 +104,41 @@ namespace backlot
 
 			ScriptPointer getScript();
 
-			void dropPredictionData(int time);
+			/**
+			 * Returns true if the entity has EPF_Input properties.
+			 */
+			bool hasInput();
+			/**
+			 * Stores the current values of the input properties as the
+			 * input command of this tick.
+			 */
+			void recordInput();
+			/**
+			 * Writes the number of stored input commands (8 bits) and the
+			 * commands from the oldest to the newest, see EPT_Keys.
+			 */
+			void getInput(BufferPointer buffer);
 
 			void onChange(Property *property);
+
+			/**
+			 * Maximum number of snapshots kept per entity.
+			 */
+			static const unsigned int MAX_SNAPSHOTS = 32;
+			/**
+			 * Number of ticks for which the predicted states of local
+			 * entities are kept. Corrections from the server which are
+			 * older than this are applied as if they were this old.
+			 */
+			static const unsigned int PREDICTION_SIZE = 64;
+			/**
+			 * Number of input commands sent in every packet. Input is only
+			 * lost if this many packets in a row are lost.
+			 */
+			static const unsigned int INPUT_HISTORY = 8;
 		private:
+			void addSnapshot(int time, const Vector2F &position);
+
 			EntityTemplatePointer tpl;
 
 			ScriptPointer script;
@@ -96,7 +147,10 @@ namespace backlot
 			std::vector<AnimationPointer> animations;
 			Property *positionproperty;
 			Vector2F speed;
-			std::deque<SpeedInfo> recentspeeds;
+			PredictedState predictions[PREDICTION_SIZE];
+			std::deque<PositionSnapshot> snapshots;
+			std::deque<BufferPointer> inputhistory;
+			Vector2F previousposition;
 
 			bool changed;
 
@@ -36,9 +36,21 @@ namespace backlot
 			void setPosition(Vector2F position);
 			Vector2F getPosition();
 
+			/**
+			 * Remembers the current position as the one of the previous
+			 * tick. Called before every simulation tick.
+			 */
+			void saveState();
+
+			/**
+			 * Sets the projection, the camera is placed between the
+			 * positions of the last two ticks according to
+			 * Engine::getFrameAlpha().
+			 */
 			void apply();
 		private:
 			Vector2F position;
+			Vector2F previousposition;
 	};
 
 	typedef SharedPointer<Camera> CameraPointer;
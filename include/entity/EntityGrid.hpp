@@ -0,0 +1,151 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _ENTITYGRID_HPP_
+#define _ENTITYGRID_HPP_
+
+#include "Rectangle.hpp"
+
+#include <vector>
+
+namespace backlot
+{
+	/**
+	 * Spatial hash over the bounding rectangles of entities. Every entry is
+	 * stored in the grid cell containing the upper left corner of its
+	 * rectangle, the cells are hashed into a fixed number of buckets so that
+	 * the map size does not matter. Moving an entry within its cell only
+	 * updates the stored rectangle, moving it into another cell takes
+	 * constant time as well.
+	 *
+	 * Queries only look at the cells near the queried area. Because entries
+	 * are sorted in by their upper left corner, the area is extended to the
+	 * upper left by the largest entry size seen so far.
+	 *
+	 * The grid only knows entity IDs and does not depend on Entity, so it
+	 * can be used (and benchmarked) on its own.
+	 */
+	class EntityGrid
+	{
+		public:
+			/**
+			 * Interface for additional conditions in getNearest().
+			 */
+			class Filter
+			{
+				public:
+					virtual ~Filter()
+					{
+					}
+
+					/**
+					 * Returns true if the entry with the given ID may be
+					 * returned.
+					 */
+					virtual bool accept(int id) = 0;
+			};
+
+			/**
+			 * Constructor.
+			 * @param cellsize Edge length of a grid cell. Should be somewhat
+			 * larger than the usual entity and query size.
+			 */
+			EntityGrid(float cellsize = 4.0f);
+			/**
+			 * Destructor.
+			 */
+			~EntityGrid();
+
+			/**
+			 * Removes all entries.
+			 */
+			void clear();
+
+			/**
+			 * Inserts an entry or moves it if it already exists.
+			 */
+			void update(int id, const RectangleF &rectangle);
+			/**
+			 * Removes an entry. Does nothing if the ID is not in the grid.
+			 */
+			void remove(int id);
+
+			/**
+			 * Returns the number of entries.
+			 */
+			unsigned int getSize()
+			{
+				return count;
+			}
+
+			/**
+			 * Returns the IDs of all entries whose rectangle touches the
+			 * area. The result vector is cleared first and can be reused
+			 * between queries to avoid allocations.
+			 */
+			void query(const RectangleF &area, std::vector<int> &result);
+			/**
+			 * Returns the IDs of all entries whose rectangle is at most
+			 * radius away from the center.
+			 */
+			void queryRadius(const Vector2F &center, float radius,
+				std::vector<int> &result);
+			/**
+			 * Returns the entry whose rectangle is nearest to the position.
+			 * Cells are searched in rings around the position until no
+			 * nearer entry is possible any more.
+			 * @param maxdistance Maximum distance of the returned entry.
+			 * @param filter Optional additional condition.
+			 * @return ID of the entry or -1 if there is none.
+			 */
+			int getNearest(const Vector2F &position, float maxdistance,
+				Filter *filter = 0);
+		private:
+			struct Entry
+			{
+				RectangleF rectangle;
+				int cellx;
+				int celly;
+				unsigned int slot;
+				bool used;
+			};
+
+			static const unsigned int BUCKET_COUNT = 4096;
+
+			int getCell(float coordinate);
+			unsigned int getBucket(int cellx, int celly)
+			{
+				return ((unsigned int)cellx * 73856093u
+					^ (unsigned int)celly * 19349663u) & (BUCKET_COUNT - 1);
+			}
+			void removeFromBucket(int id);
+			void visitNearest(int cellx, int celly, const Vector2F &position,
+				float &bestdistance, int &best, Filter *filter);
+
+			float cellsize;
+			float maxextent;
+			unsigned int count;
+			std::vector<Entry> entries;
+			std::vector<int> buckets[BUCKET_COUNT];
+	};
+}
+
+#endif
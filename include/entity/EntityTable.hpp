@@ -0,0 +1,142 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _ENTITYTABLE_HPP_
+#define _ENTITYTABLE_HPP_
+
+#include "entity/Entity.hpp"
+
+#include <vector>
+#include <map>
+#include <queue>
+
+namespace backlot
+{
+	/**
+	 * Table of all entities in the game. Entities can be looked up by their
+	 * ID, iterated over in a packed array which only contains live entities
+	 * and queried by owner. All operations take constant time (or time
+	 * proportional to the number of returned entities), independent of the
+	 * highest ID ever used.
+	 *
+	 * On the server the table also allocates entity IDs. Released IDs are
+	 * reused in the order they were freed, so that an ID is not reused
+	 * immediately while clients might still have packets referring to the
+	 * old entity in flight.
+	 */
+	class EntityTable
+	{
+		public:
+			/**
+			 * Maximum number of entities. IDs range from 0 to
+			 * MAX_ENTITIES - 1.
+			 */
+			static const int MAX_ENTITIES = 65535;
+
+			/**
+			 * Constructor.
+			 */
+			EntityTable();
+			/**
+			 * Destructor.
+			 */
+			~EntityTable();
+
+			/**
+			 * Removes all entities and resets the ID allocator.
+			 */
+			void clear();
+
+			/**
+			 * Reserves an unused ID.
+			 * @return New ID or -1 if no ID is left.
+			 */
+			int allocateID();
+			/**
+			 * Makes an ID available for allocateID() again. The entity with
+			 * the ID has to be removed before.
+			 */
+			void releaseID(int id);
+
+			/**
+			 * Inserts an entity into the table. The ID of the entity has to
+			 * be set before and must not be in use by another entity.
+			 */
+			void insert(EntityPointer entity);
+			/**
+			 * Removes the entity with the given ID from the table.
+			 */
+			void remove(int id);
+
+			/**
+			 * Returns the entity with the given ID or 0 if there is none.
+			 */
+			EntityPointer get(int id)
+			{
+				if (id < 0 || id >= MAX_ENTITIES)
+					return 0;
+				return entities[id];
+			}
+
+			/**
+			 * Returns the number of live entities.
+			 */
+			unsigned int getSize()
+			{
+				return live.size();
+			}
+			/**
+			 * Returns a live entity. Indices range from 0 to getSize() - 1.
+			 * Removing an entity moves the last entity into its slot, so
+			 * loops which might remove entities should iterate over a copy
+			 * of getEntities().
+			 */
+			const EntityPointer &getEntity(unsigned int index)
+			{
+				return live[index];
+			}
+			/**
+			 * Returns all live entities in the order of getEntity().
+			 */
+			const std::vector<EntityPointer> &getEntities()
+			{
+				return live;
+			}
+
+			/**
+			 * Returns all entities owned by a client.
+			 */
+			const std::vector<EntityPointer> &getOwnedEntities(int owner);
+		private:
+			EntityPointer entities[MAX_ENTITIES];
+			unsigned int liveindex[MAX_ENTITIES];
+			unsigned int ownerindex[MAX_ENTITIES];
+			std::vector<EntityPointer> live;
+			std::map<int, std::vector<EntityPointer> > owned;
+
+			std::queue<int> freeids;
+			int nextid;
+
+			static std::vector<EntityPointer> noentities;
+	};
+}
+
+#endif
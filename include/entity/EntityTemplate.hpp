@@ -57,6 +57,11 @@ namespace backlot
 			EntityTemplate();
 			~EntityTemplate();
 
+			/**
+			 * Loads the template with the given name or returns an already
+			 * loaded one. Can be called from several threads, the templates
+			 * are not changed after loading and are shared.
+			 */
 			static SharedPointer<EntityTemplate> get(std::string name);
 
 			bool load(std::string name);
@@ -41,7 +41,7 @@ namespace backlot
 		 */
 		EPT_Integer,
 		/**
-		 * Float. Always 32 bits large.
+		 * Float. 32 bits large unless the property is quantized.
 		 */
 		EPT_Float,
 		/**
@@ -85,7 +85,39 @@ namespace backlot
 		 * clients may not change it. This is mostly used for input handling.
 		 * Do not use this in cases where it can be used for cheating!
 		 */
-		EPF_Unlocked = 0x4
+		EPF_Unlocked = 0x4,
+		/**
+		 * Unlocked property which is part of the player input. The owner
+		 * sends the value of every tick in EPT_Keys instead of sending
+		 * changes in EPT_Update, and the server applies the values in the
+		 * order of the ticks.
+		 */
+		EPF_Input = 0x8
+	};
+
+	/**
+	 * Network encoding of integer properties.
+	 */
+	enum PropertyEncoding
+	{
+		/**
+		 * Fixed number of bits, set via setSize().
+		 */
+		EPE_Fixed,
+		/**
+		 * Unsigned varint, see Buffer::writeVarInt(). Negative values take
+		 * five bytes.
+		 */
+		EPE_VarInt,
+		/**
+		 * Signed varint, see Buffer::writeZigZag().
+		 */
+		EPE_ZigZag,
+		/**
+		 * Bit-level exponential-Golomb code of the zigzag encoded value,
+		 * see Buffer::writeExpGolomb().
+		 */
+		EPE_ExpGolomb
 	};
 
 	/**
@@ -156,6 +188,44 @@ namespace backlot
 			 * Returns the number of bits transmitted for integer values.
 			 */
 			unsigned int getSize() const;
+			/**
+			 * Sets how integers and integer vectors are encoded. The
+			 * variable-length encodings need less space for small values and
+			 * do not truncate large ones.
+			 * @param order Order of the exponential-Golomb code.
+			 */
+			void setEncoding(PropertyEncoding encoding, unsigned int order = 0);
+			/**
+			 * Returns the encoding of integer values.
+			 */
+			PropertyEncoding getEncoding() const;
+			/**
+			 * Returns the order of the exponential-Golomb code.
+			 */
+			unsigned int getEncodingOrder() const;
+			/**
+			 * Makes float and float vector properties use a fixed-point
+			 * encoding. Values are clamped to [min, max] and transmitted with
+			 * the given number of bits per component, so the precision is
+			 * (max - min) / (2^bits - 1). The local value is not changed,
+			 * only the value on the other side is rounded.
+			 * @param bits Bits per component (at most 24). 0 disables
+			 * quantization and sends full 32 bit floats.
+			 */
+			void setQuantization(float min, float max, unsigned int bits);
+			/**
+			 * Returns the number of bits per quantized component or 0 if the
+			 * property is not quantized.
+			 */
+			unsigned int getQuantizationBits() const;
+			/**
+			 * Returns the lower end of the quantization range.
+			 */
+			float getMinimum() const;
+			/**
+			 * Returns the upper end of the quantization range.
+			 */
+			float getMaximum() const;
 
 			/**
 			 * Sets the entity which owns this property and gets change
@@ -261,17 +331,31 @@ namespace backlot
 			 * Returns the time of the last change.
 			 */
 			int getChangeTime() const;
+			/**
+			 * Marks the property as changed in the current tick without
+			 * changing the value, so that it is sent to the clients again.
+			 */
+			void touch();
 
 			Property &operator=(const Property &property);
 			bool operator==(const Property &property);
 			bool operator!=(const Property &property);
 		private:
 			void onChange();
+			void writeFloat(const BufferPointer &buffer, float value) const;
+			float readFloat(const BufferPointer &buffer) const;
+			void writeInteger(const BufferPointer &buffer, int value) const;
+			int readInteger(const BufferPointer &buffer) const;
 
 			std::string name;
 			PropertyType type;
 			PropertyFlags flags;
 			unsigned int size;
+			PropertyEncoding encoding;
+			unsigned int encodingorder;
+			float minimum;
+			float maximum;
+			unsigned int quantizationbits;
 			char data[8];
 			std::string stringdata;
 			Entity *entity;
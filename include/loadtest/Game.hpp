@@ -0,0 +1,108 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _GAME_HPP_
+#define _GAME_HPP_
+
+#include "LoadClient.hpp"
+
+#include <enet/enet.h>
+#include <string>
+#include <vector>
+
+namespace backlot
+{
+	/**
+	 * Swarm of load test clients connected to one server. Connects the
+	 * clients, runs them in lockstep with the server tick and prints the
+	 * measured traffic, packet loss and latency once per second.
+	 */
+	class Game
+	{
+		public:
+			static Game &get();
+			~Game();
+
+			/**
+			 * Starts connecting to the server.
+			 * @param address Server address ("host:port").
+			 * @param clientcount Number of clients.
+			 * @param ramp Number of clients connected per second, 0 connects
+			 * all clients at once.
+			 * @param compression If true, the clients ask for compressed
+			 * packets.
+			 */
+			bool init(std::string address, unsigned int clientcount,
+				unsigned int ramp, bool compression);
+			/**
+			 * Disconnects all clients and prints the results of the whole
+			 * run.
+			 */
+			void destroy();
+
+			/**
+			 * Runs one tick of all clients.
+			 */
+			void update();
+
+			unsigned int getTime();
+
+			/**
+			 * Called when a client got EPT_ServerStatistics.
+			 * @param ticktime Average server tick time in microseconds.
+			 * @param maxticktime Longest server tick in microseconds.
+			 * @param clients Number of clients connected to the server.
+			 */
+			void setServerStatistics(unsigned int ticktime,
+				unsigned int maxticktime, unsigned int clients);
+		private:
+			Game();
+
+			bool connect();
+			void removeClient(LoadClient *client);
+			void collectStatistics();
+			void printStatistics(std::string label,
+				const std::vector<TrafficStatistics> &statistics,
+				float ticktime, unsigned int maxticktime);
+
+			ENetHost *host;
+			ENetAddress address;
+			unsigned int clientcount;
+			unsigned int ramp;
+			bool compression;
+
+			unsigned int time;
+
+			std::vector<LoadClient*> clients;
+			std::vector<TrafficStatistics> interval;
+			std::vector<TrafficStatistics> total;
+
+			unsigned int ticktime;
+			unsigned int maxticktime;
+			unsigned int serverclients;
+			bool newstatistics;
+			uint64_t totalticktime;
+			unsigned int totalmaxticktime;
+			unsigned int statisticscount;
+	};
+}
+
+#endif
@@ -0,0 +1,172 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _LOADCLIENT_HPP_
+#define _LOADCLIENT_HPP_
+
+#include "Buffer.hpp"
+#include "entity/Entity.hpp"
+
+#include <enet/enet.h>
+#include <deque>
+#include <map>
+#include <vector>
+
+namespace backlot
+{
+	/**
+	 * Traffic and latency measured by a load test client.
+	 */
+	struct TrafficStatistics
+	{
+		TrafficStatistics();
+
+		/**
+		 * Adds the values of another measurement.
+		 */
+		void add(const TrafficStatistics &other);
+
+		/**
+		 * Ticks the client was in the game.
+		 */
+		unsigned int ticks;
+		/**
+		 * Payload bytes received from the server.
+		 */
+		uint64_t received;
+		/**
+		 * Payload bytes sent to the server.
+		 */
+		uint64_t sent;
+		/**
+		 * Update packets received.
+		 */
+		unsigned int updates;
+		/**
+		 * Update packets the server sent in the same time. The server sends
+		 * one update per tick, so every gap in the update times is a lost
+		 * packet.
+		 */
+		unsigned int expectedupdates;
+		/**
+		 * Time in microseconds between sending an update and getting it
+		 * acknowledged by the server.
+		 */
+		std::vector<unsigned int> latency;
+	};
+
+	/**
+	 * Single simulated player of the load test. Speaks the same protocol as
+	 * the real client, but only keeps the entity properties and replaces
+	 * the player input with random movement.
+	 */
+	class LoadClient
+	{
+		public:
+			/**
+			 * Constructor.
+			 * @param peer Connection to the server.
+			 * @param seed Seed for the random movement.
+			 * @param compression If true, the client asks the server for
+			 * compressed packets.
+			 */
+			LoadClient(ENetPeer *peer, unsigned int seed, bool compression);
+			/**
+			 * Destructor.
+			 */
+			~LoadClient();
+
+			/**
+			 * Returns the network connection to the server.
+			 */
+			ENetPeer *getPeer()
+			{
+				return peer;
+			}
+
+			/**
+			 * Returns true once the client has entered the game.
+			 */
+			bool isReady();
+			/**
+			 * Returns false if the client got data it could not parse.
+			 */
+			bool isValid();
+
+			/**
+			 * Parses a packet received from the server.
+			 */
+			void receive(ENetPacket *packet);
+			/**
+			 * Changes the input and sends it to the server. Called once per
+			 * tick.
+			 */
+			void update();
+
+			/**
+			 * Returns the statistics since the last call and starts a new
+			 * measurement interval.
+			 */
+			TrafficStatistics collectStatistics();
+		private:
+			/**
+			 * Ticks between two update packets sent only to measure the
+			 * latency.
+			 */
+			static const unsigned int LATENCY_INTERVAL = 10;
+
+			bool handleMessage(BufferPointer msg);
+			void injectUpdates(BufferPointer msg);
+			void updateInput(const EntityPointer &entity);
+			void send(BufferPointer buffer, bool reliable = false);
+			unsigned int getRandom();
+
+			ENetPeer *peer;
+			unsigned int seed;
+			bool compression;
+
+			bool ready;
+			bool valid;
+			int clientid;
+
+			std::map<int, EntityPointer> entities;
+			std::vector<BufferPointer> messages;
+
+			unsigned int time;
+			unsigned int lastupdate;
+			unsigned int lastacked;
+			unsigned int inputsequence;
+
+			unsigned int nextkeys;
+			float turnspeed;
+
+			struct SentUpdate
+			{
+				unsigned int time;
+				uint64_t sent;
+			};
+			std::deque<SentUpdate> sentupdates;
+
+			TrafficStatistics statistics;
+	};
+}
+
+#endif
@@ -0,0 +1,108 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _ENTITY_HPP_
+#define _ENTITY_HPP_
+
+#include "ReferenceCounted.hpp"
+#include "Buffer.hpp"
+#include "entity/EntityTemplate.hpp"
+
+#include <deque>
+#include <vector>
+
+namespace backlot
+{
+	/**
+	 * Copy of a server entity as seen by a load test client. Only the
+	 * properties are kept, which is enough to parse the update stream and to
+	 * send input for the entities owned by the client.
+	 */
+	class Entity : public ReferenceCounted
+	{
+		public:
+			Entity();
+			~Entity();
+
+			bool create(EntityTemplatePointer tpl, int owner,
+				BufferPointer state = 0);
+			EntityTemplatePointer getTemplate();
+
+			void setState(BufferPointer buffer);
+
+			void applyUpdate(BufferPointer buffer);
+			/**
+			 * Writes all unlocked properties which were changed after the
+			 * given time. Input is sent separately, see getInput().
+			 */
+			void getUpdate(int time, BufferPointer buffer);
+			bool hasChanged(int time);
+
+			int getOwner();
+
+			void setActive(bool active);
+			bool isActive();
+
+			Property *getProperty(std::string name);
+			/**
+			 * Marks an unlocked property as changed at the given client
+			 * time. The properties are not attached to the entity, so this
+			 * has to be done manually after changing them.
+			 */
+			void setChanged(Property *property, int time);
+
+			/**
+			 * Returns true if the entity has EPF_Input properties.
+			 */
+			bool hasInput();
+			/**
+			 * Stores the current values of the input properties as the
+			 * input command of this tick.
+			 */
+			void recordInput();
+			/**
+			 * Writes the number of stored input commands (8 bits) and the
+			 * commands from the oldest to the newest, see EPT_Keys.
+			 */
+			void getInput(BufferPointer buffer);
+
+			void onChange(Property *property)
+			{
+			}
+		private:
+			/**
+			 * Number of input commands sent in every packet, the same as in
+			 * the real client.
+			 */
+			static const unsigned int INPUT_HISTORY = 8;
+
+			EntityTemplatePointer tpl;
+			std::vector<Property> properties;
+			std::vector<int> changetime;
+			int owner;
+			bool active;
+			std::deque<BufferPointer> inputhistory;
+	};
+
+	typedef SharedPointer<Entity> EntityPointer;
+}
+
+#endif
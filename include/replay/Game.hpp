@@ -0,0 +1,144 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _GAME_HPP_
+#define _GAME_HPP_
+
+#include "entity/Entity.hpp"
+#include "ReplayData.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace backlot
+{
+	/**
+	 * Keyframe in the replay index.
+	 */
+	struct ReplayKeyframe
+	{
+		unsigned int tick;
+		uint64_t offset;
+	};
+
+	/**
+	 * Game state read from a replay file recorded by the server's
+	 * ReplayRecorder. The state at any tick is restored by loading the last
+	 * keyframe before the tick and applying the deltas after it.
+	 */
+	class Game
+	{
+		public:
+			static Game &get();
+			~Game();
+
+			/**
+			 * Opens a replay file and its index. The replay is positioned
+			 * before the first record.
+			 */
+			bool load(std::string filename);
+			void destroy();
+
+			/**
+			 * Restores the state at the end of the given tick or at the end
+			 * of the replay if the tick lies behind it.
+			 */
+			bool seek(unsigned int tick);
+			/**
+			 * Applies the next record.
+			 * @return False at the end of the replay or if the record could
+			 * not be read.
+			 */
+			bool step();
+
+			/**
+			 * Returns the tick of the last applied record.
+			 */
+			unsigned int getTime();
+			unsigned int getKeyframeInterval();
+			unsigned int getKeyframeCount();
+
+			/**
+			 * Writes all entities and their properties to stdout.
+			 */
+			void print();
+
+			/**
+			 * Sets whether the values of integer properties read from the
+			 * replay are collected for printEncodings().
+			 */
+			void setSampling(bool sampling);
+			/**
+			 * Remembers the value of a property which was read from the
+			 * replay.
+			 */
+			void addSample(EntityTemplatePointer tpl, const Property &property);
+			/**
+			 * Encodes the collected values with all integer encodings and
+			 * prints the resulting size and the encoding time.
+			 */
+			void printEncodings();
+		private:
+			Game();
+
+			/**
+			 * Returns the index of the last keyframe at or before the tick.
+			 * Keyframes are written at multiples of the keyframe interval,
+			 * so the position is calculated and only corrected if ticks
+			 * were not recorded or keyframes were spread over several
+			 * ticks.
+			 */
+			int findKeyframe(unsigned int tick);
+			/**
+			 * Reads the header of the record at position.
+			 * @return False if there is no further record.
+			 */
+			bool readRecordHeader(uint64_t position, unsigned int &tick,
+				ReplayRecordType &type, unsigned int &size);
+			bool applyRecord(BufferPointer record, ReplayRecordType type);
+
+			char *data;
+			uint64_t size;
+			/**
+			 * Offset of the next record.
+			 */
+			uint64_t position;
+
+			unsigned int ticklength;
+			unsigned int keyframeinterval;
+			std::vector<ReplayKeyframe> keyframes;
+
+			unsigned int time;
+			std::map<int, EntityPointer> entities;
+
+			struct Samples
+			{
+				unsigned int size;
+				std::vector<int> values;
+			};
+			bool sampling;
+			std::map<std::string, Samples> samples;
+	};
+}
+
+#endif
@@ -25,9 +25,14 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Buffer.hpp"
 
 #include <enet/enet.h>
+#include <deque>
+#include <vector>
+#include <pthread.h>
 
 namespace backlot
 {
+	class Room;
+
 	enum ClientStatus
 	{
 		ECS_Connecting,
@@ -35,12 +40,79 @@ namespace backlot
 		ECS_Playing
 	};
 
+	/**
+	 * Packet queued for one or more clients. ENet is not thread-safe, so the
+	 * ENet packet is only created by the network thread when the packet is
+	 * passed to the first peer. The ENet packet references the buffer instead
+	 * of copying it, and all peers share it via ENet's own reference count,
+	 * so a broadcast is neither copied nor allocated once per client.
+	 *
+	 * The network thread holds an extra reference to the ENet packet until
+	 * all send queues have been flushed, as otherwise ENet could free the
+	 * packet after sending it to the first peer while other send queues still
+	 * contain it. The buffer must not be changed after it has been queued.
+	 *
+	 * Packets are kept in a free list once they are not referenced any more
+	 * and are reused by create(), like the buffers of BufferPool.
+	 */
+	class OutgoingPacket : public ReferenceCounted
+	{
+		public:
+			/**
+			 * Returns a packet from the free list or a new one.
+			 * @param buffer Data to send.
+			 * @param reliable If set to true, the data will be sent reliably.
+			 */
+			static SharedPointer<OutgoingPacket> create(BufferPointer buffer,
+				bool reliable);
+			/**
+			 * Destructor.
+			 */
+			~OutgoingPacket();
+
+			/**
+			 * Passes the packet to ENet. Must only be called by the network
+			 * thread.
+			 * @return True if the ENet packet was created by this call. In
+			 * this case release() has to be called after all send queues
+			 * have been flushed.
+			 */
+			bool send(ENetPeer *peer);
+			/**
+			 * Drops the reference of the network thread to the ENet packet.
+			 * If the packet is queued again later, a new ENet packet is
+			 * created.
+			 */
+			void release();
+		protected:
+			/**
+			 * Puts the packet back into the free list.
+			 */
+			virtual void dispose() const;
+		private:
+			OutgoingPacket();
+
+			BufferPointer buffer;
+			bool reliable;
+			ENetPacket *packet;
+	};
+	typedef SharedPointer<OutgoingPacket> OutgoingPacketPointer;
+
 	/**
 	 * Server-side client information. Here both network connection information
 	 * and the time of the last packet which definately has been received by the
 	 * player are tracked.
 	 * The latter provides a safe way to send only the info which really is
 	 * needed.
+	 *
+	 * As not every update packet contains all changed entities, the client
+	 * also remembers which entities were in the recently sent packets. When
+	 * a packet is acknowledged, its entities are known to be up to date at
+	 * that time, and later updates only need to contain changes since then.
+	 *
+	 * Clients are used by the thread of their room. ENet is not thread-safe,
+	 * so packets are only queued there and passed to ENet by the network
+	 * thread in flushSendQueue().
 	 */
 	class Client
 	{
@@ -80,11 +152,73 @@ namespace backlot
 			 * @param reliable If set to true, the data will be sent reliably.
 			 */
 			void send(BufferPointer buffer, bool reliable = false);
+			/**
+			 * Queues a reliable message. All queued messages are sent
+			 * together in as few packets as possible by flushReliable().
+			 */
+			void queueReliable(BufferPointer buffer);
+			/**
+			 * Sends all queued reliable messages. Called once per tick.
+			 */
+			void flushReliable();
+			/**
+			 * Sends a packet without compressing it.
+			 */
+			void sendRaw(BufferPointer buffer, bool reliable = false);
+			/**
+			 * Queues a packet which can be shared with other clients.
+			 */
+			void sendPacket(OutgoingPacketPointer packet);
+			/**
+			 * Passes all packets queued by sendRaw() to ENet and carries out
+			 * a requested disconnect. Must only be called by the network
+			 * thread.
+			 * @param created Receives the packets for which ENet packets were
+			 * created, these have to be released after all clients were
+			 * flushed.
+			 */
+			void flushSendQueue(std::vector<OutgoingPacketPointer> &created);
+			/**
+			 * Disconnects the client after the queued packets have been
+			 * sent.
+			 */
+			void disconnect();
+
+			/**
+			 * Sets the room the client was assigned to when connecting.
+			 */
+			void setRoom(Room *room);
+			/**
+			 * Returns the room of the client.
+			 */
+			Room *getRoom();
+			/**
+			 * Sets whether packets to this client are compressed.
+			 */
+			void setCompression(bool compression);
+			/**
+			 * Returns whether packets to this client are compressed.
+			 */
+			bool getCompression();
+			/**
+			 * Sets whether the client gets EPT_ServerStatistics packets.
+			 */
+			void setStatistics(bool statistics);
+			/**
+			 * Returns whether the client gets EPT_ServerStatistics packets.
+			 */
+			bool getStatistics();
 
 			/**
 			 * Sets the time of the last packet which the client definately got.
 			 */
 			void setAcknowledgedPacket(int time);
+			/**
+			 * Remembers which entities were part of the update packet sent
+			 * at the given time.
+			 */
+			void addSentUpdate(unsigned int time,
+				const std::vector<int> &entities);
 			/**
 			 * Returns the time of the last received packet.
 			 */
@@ -97,6 +231,17 @@ namespace backlot
 			 * Returns the time of thje last packet received from the client.
 			 */
 			int getLag();
+			/**
+			 * Sets the number of ticks the client draws remote entities
+			 * behind the current tick, as sent in EPT_Ready. Values above
+			 * 10 ticks are capped.
+			 */
+			void setRenderDelay(unsigned int delay);
+			/**
+			 * Returns the number of ticks the client draws remote entities
+			 * behind the current tick.
+			 */
+			unsigned int getRenderDelay();
 			/**
 			 * Tracks whether entity updates for this entity are sent to
 			 * this client.
@@ -107,6 +252,43 @@ namespace backlot
 			 * client.
 			 */
 			bool isEntityActive(int entity);
+			/**
+			 * Sets the time up to which the client is known to have all
+			 * changes of an entity.
+			 */
+			void setEntityBaseline(int entity, int time);
+			/**
+			 * Returns the time up to which the client is known to have all
+			 * changes of an entity. Updates have to contain all changes after
+			 * this time.
+			 */
+			int getEntityBaseline(int entity);
+			/**
+			 * Adds to the priority of a pending entity update and returns the
+			 * accumulated priority. Updates which do not fit into a packet
+			 * keep their priority and are preferred in the next tick.
+			 */
+			float accumulatePriority(int entity, float priority);
+			/**
+			 * Resets the priority of an entity after it has been sent.
+			 */
+			void clearPriority(int entity);
+
+			/**
+			 * Adapts the number of bytes per tick available for entity
+			 * updates to the round trip time and packet loss ENet measured.
+			 * The budget grows slowly while the connection is fine and is
+			 * cut when packets are lost or start to queue up. Called once
+			 * per tick. The statistics are copied from ENet in
+			 * flushSendQueue() as ENet must not be accessed by the room
+			 * thread.
+			 */
+			void updateBudget();
+			/**
+			 * Returns the number of bytes per tick available for entity
+			 * updates.
+			 */
+			unsigned int getBudget();
 			/**
 			 * Sets the client ID.
 			 */
@@ -120,8 +302,37 @@ namespace backlot
 			ClientStatus status;
 			int lastreceived;
 			int lag;
+			unsigned int renderdelay;
 			bool active[65535];
+			int baseline[65535];
+			float priority[65535];
 			int id;
+			bool compression;
+			bool statistics;
+
+			struct SentUpdate
+			{
+				unsigned int time;
+				std::vector<int> entities;
+			};
+			std::deque<SentUpdate> sentupdates;
+
+			std::vector<BufferPointer> outbox;
+
+			std::vector<OutgoingPacketPointer> sendqueue;
+			bool disconnecting;
+			/**
+			 * Copies of the ENet statistics made by the network thread.
+			 */
+			unsigned int roundtriptime;
+			unsigned int packetloss;
+			pthread_mutex_t sendmutex;
+
+			Room *room;
+
+			float budget;
+			unsigned int minrtt;
+			unsigned int backoff;
 	};
 }
 
@@ -25,8 +25,13 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Script.hpp"
 #include "entity/Entity.hpp"
 #include "entity/EntityList.hpp"
+#include "entity/EntityTable.hpp"
+#include "entity/EntityGrid.hpp"
 #include "Client.hpp"
 #include "Rectangle.hpp"
+#include "WorkerPool.hpp"
+#include "ServerMap.hpp"
+#include "ReplayRecorder.hpp"
 
 #include <queue>
 
@@ -40,15 +45,102 @@ namespace backlot
 		Vector2F point;
 	};
 
+	/**
+	 * Encoded entity update. Clients which acknowledged the same tick get
+	 * the same data, only the owner of the entity might get a different
+	 * update because of the property flags.
+	 */
+	struct UpdateCacheEntry
+	{
+		int from;
+		bool local;
+		BufferPointer update;
+	};
+
+	/**
+	 * Entity update waiting to be sent to a client, ordered by descending
+	 * priority.
+	 */
+	struct UpdateCandidate
+	{
+		unsigned int index;
+		float priority;
+
+		bool operator<(const UpdateCandidate &other) const
+		{
+			return priority > other.priority;
+		}
+	};
+
+	/**
+	 * Per-client state while the update packets are encoded. Each client is
+	 * handled by one thread only.
+	 */
+	struct ClientUpdate
+	{
+		Client *client;
+		BufferPointer packet;
+		std::vector<Vector2F> viewpoints;
+		std::vector<UpdateCandidate> candidates;
+		std::vector<int> sententities;
+	};
+
 	class Game
 	{
 		public:
-			static Game &get();
+			/**
+			 * Creates a game. Usually every room has its own game, see
+			 * Room.
+			 */
+			Game();
 			~Game();
 
+			/**
+			 * Returns the game of the calling thread, see setCurrent().
+			 * Threads which did not set one use a global default game.
+			 */
+			static Game &get();
+			/**
+			 * Sets the game returned by get() in the calling thread. All
+			 * entities, scripts and timers use get(), so each game has to
+			 * be updated in the thread it was made current in.
+			 */
+			static void setCurrent(Game *game);
+
+			/**
+			 * Loads the map and the game mode and creates the map entities.
+			 */
 			bool load(std::string mapname, std::string mode);
 			bool destroy();
 
+			/**
+			 * Returns the map the game is running on.
+			 */
+			MapPointer getMap();
+
+			/**
+			 * Sends a packet to all clients in the game. Reliable packets
+			 * are queued and sent batched at the end of the tick.
+			 */
+			void sendToAll(BufferPointer buffer, bool reliable = false);
+
+			/**
+			 * Sets the number of additional threads used to encode the
+			 * update packets for the clients. 0 encodes all packets on the
+			 * main thread.
+			 */
+			bool setWorkerThreads(unsigned int threads);
+
+			/**
+			 * Starts recording the game into a replay file, see
+			 * ReplayRecorder. Should be called right after load().
+			 */
+			bool startRecording(std::string filename);
+			/**
+			 * Writes the current tick and closes the replay file.
+			 */
+			void stopRecording();
+
 			std::string getMode();
 			int getTeamCount();
 			int getWeaponSlotCount();
@@ -69,34 +161,156 @@ namespace backlot
 			 * Returns the number of ticks passed since the start of the game.
 			 */
 			unsigned int getTime();
+			/**
+			 * Returns the tick a client currently sees, i.e. the current
+			 * tick minus the lag of the client and the delay with which the
+			 * client draws remote entities. Hit checks for actions of the
+			 * client should be done at this tick.
+			 */
+			unsigned int getLagCompensatedTime(int client);
 
 			void injectUpdates(Client *client, BufferPointer buffer);
+			/**
+			 * Queues the input commands in an EPT_Keys packet. The commands
+			 * are applied in update(), one per tick.
+			 */
+			void injectInput(Client *client, BufferPointer buffer);
 
 			CollisionInfo getCollision(Vector2F from, Vector2F to,
 				float maxheight);
+			/**
+			 * Checks a line against the map and against the entities at the
+			 * positions they had at the end of the given tick. The first
+			 * collision is returned. Ticks further back than
+			 * Entity::HISTORY_SIZE are clamped.
+			 */
+			CollisionInfo getCollision(Vector2F from, Vector2F to,
+				float maxheight, unsigned int tick);
+			/**
+			 * Like getCollision(from, to, maxheight, tick), but only checks
+			 * entities of the given type (all for an empty type) and skips
+			 * the entity with the ID ignore. Does not allocate any memory,
+			 * so this is the query to use for hit checks every tick.
+			 */
+			CollisionInfo getCollision(Vector2F from, Vector2F to,
+				float maxheight, unsigned int tick, const std::string &type,
+				int ignore);
 			EntityListPointer getEntities(RectangleF area, std::string type);
+			/**
+			 * Returns the entities which overlapped with the area at the end
+			 * of the given tick.
+			 */
+			EntityListPointer getEntities(RectangleF area,
+				const std::string &type, unsigned int tick);
 			EntityListPointer getEntities(RectangleF area);
 			EntityListPointer getEntities(std::string type);
+			/**
+			 * Returns all movable entities which are at most radius away
+			 * from the center. An empty type matches all entities.
+			 */
+			EntityListPointer getEntitiesInRadius(Vector2F center,
+				float radius, std::string type);
+			/**
+			 * Returns the movable entity nearest to the position or 0 if
+			 * there is none within maxdistance. An empty type matches all
+			 * entities.
+			 */
+			EntityPointer getNearestEntity(Vector2F position,
+				float maxdistance, std::string type);
+
+			/**
+			 * Called by entities when their position has changed, keeps the
+			 * spatial index up to date.
+			 */
+			void onEntityMoved(Entity *entity);
 
 			void update();
 		private:
-			Game();
+			/**
+			 * Decides whether updates for an entity are sent to a client.
+			 * Entities enter the client's set within viewradius of one of the
+			 * client's own entities and only leave it again outside
+			 * viewradius + viewhysteresis so that entities near the border do
+			 * not flicker in and out.
+			 */
+			bool isRelevant(ClientUpdate &update,
+				const EntityPointer &entity, float distance,
+				bool currentlyactive);
+			/**
+			 * Returns the distance of an entity to the nearest entity of the
+			 * client or 0 if either has no position.
+			 */
+			float getViewDistance(ClientUpdate &update,
+				const EntityPointer &entity);
+			/**
+			 * Returns the priority added to a pending update each tick.
+			 * Updates for the client's own entities and for nearby entities
+			 * are more important, and scripts can weight entities via
+			 * Entity::setPriority().
+			 */
+			float getUpdatePriority(Client *client, const EntityPointer &entity,
+				float distance);
+			/**
+			 * Returns the update for an entity since the given tick as seen
+			 * by the client. Every distinct update is only encoded once per
+			 * tick and then shared between all clients with the same
+			 * baseline. The number of valid bits is the position of the
+			 * returned buffer.
+			 * @param index Index of the entity in the entity table.
+			 */
+			BufferPointer getEncodedUpdate(unsigned int index, int from,
+				int client);
+			/**
+			 * Limits a tick to the range stored in the position history.
+			 */
+			unsigned int clampHistoryTick(unsigned int tick);
+			/**
+			 * Returns an area containing all rectangles the entities within
+			 * the given area had since the tick.
+			 */
+			RectangleF getHistorySearchArea(const RectangleF &area,
+				unsigned int tick);
+			/**
+			 * Builds the update packet for a client. Only reads the entities
+			 * and changes the state of the client, so several clients can be
+			 * encoded in parallel.
+			 */
+			void encodeUpdate(ClientUpdate &update);
+			static void encodeUpdateTask(unsigned int index, void *game);
 
 			std::string mode;
 			int teamcount;
 			int weaponslots;
 			float speed;
+			float viewradius;
+			float viewhysteresis;
 			ScriptPointer script;
 			std::string mapname;
+			ServerMapPointer map;
 
-			EntityPointer entities[65535];
-			int maxentityid;
+			EntityTable entities;
+			EntityGrid grid;
+			std::vector<int> queryresult;
+			float maxmovement;
 			std::queue<int> deletionqueue;
+			std::vector<EntityPointer> inputentities;
+			std::vector<EntityPointer> updateentities;
 
 			std::map<int, Client*> clients;
 			int lastclientid;
 
 			unsigned int time;
+
+			std::vector<ClientUpdate> clientupdates;
+			/**
+			 * Updates encoded in this tick, indexed like the entity table.
+			 * The lists are emptied every tick but keep their memory.
+			 */
+			std::vector<std::vector<UpdateCacheEntry> > updatecache;
+			pthread_mutex_t updatecachemutex;
+			WorkerPool workers;
+
+			ReplayRecorder recorder;
 	};
 }
 
@@ -0,0 +1,177 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _REPLAYRECORDER_HPP_
+#define _REPLAYRECORDER_HPP_
+
+#include "ReplayData.hpp"
+#include "entity/Entity.hpp"
+#include "entity/EntityTable.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace backlot
+{
+	/**
+	 * Records a game into an append-only replay file, see ReplayData.hpp for
+	 * the format. Every tick gets one delta record with the entities created
+	 * and deleted during the tick and the properties changed in it, encoded
+	 * like the updates sent to the clients. Every keyframeinterval ticks a
+	 * keyframe with the complete state is written instead, so that a replay
+	 * can be started at any tick by loading the last keyframe before it and
+	 * applying at most keyframeinterval deltas.
+	 *
+	 * Writing a tick may only take a small part of the tick (see setBudget()).
+	 * If writing a keyframe takes longer, the rest of the entities is written
+	 * in the following ticks, and the keyframe only is added to the index
+	 * once it is complete.
+	 *
+	 * The file is written through a memory mapped window which is moved
+	 * forward when it is full, so appending a record is only a memcpy() and
+	 * the kernel writes the data back in the background.
+	 */
+	class ReplayRecorder
+	{
+		public:
+			ReplayRecorder();
+			/**
+			 * Destructor. Closes the file.
+			 */
+			~ReplayRecorder();
+
+			/**
+			 * Creates the replay file and its index, replacing existing
+			 * files.
+			 * @param filename Path of the replay file.
+			 * @param keyframeinterval Ticks between two keyframes.
+			 */
+			bool open(std::string filename,
+				unsigned int keyframeinterval = 250);
+			/**
+			 * Truncates the file to the recorded data and closes it.
+			 */
+			void close();
+			bool isOpen();
+
+			/**
+			 * Sets how long writing a tick may take in microseconds before
+			 * the rest of a keyframe is moved to the next ticks. Defaults to
+			 * 400, which is 2% of a tick.
+			 */
+			void setBudget(unsigned int budget);
+
+			/**
+			 * Adds the creation of an entity to the record of the current
+			 * tick.
+			 */
+			void addCreated(const EntityPointer &entity);
+			/**
+			 * Adds the deletion of an entity to the record of the current
+			 * tick.
+			 */
+			void addDeleted(int id);
+			/**
+			 * Writes the record for a tick. Has to be called once the tick
+			 * is complete, including the changes made by client packets
+			 * after the game update, which have the same change time.
+			 * @param tick Tick of the record (Game::getTime()).
+			 * @param entities All entities of the game.
+			 * @return True if the record contains a keyframe or a part of
+			 * one.
+			 */
+			bool writeTick(unsigned int tick, EntityTable &entities);
+		private:
+			/**
+			 * Size of the mapped window. Larger records get a larger window.
+			 */
+			static const unsigned int WINDOW_SIZE = 16 * 1024 * 1024;
+
+			/**
+			 * Starts a new keyframe containing all entities in the table.
+			 */
+			void startKeyframe(EntityTable &entities);
+			/**
+			 * Writes the entities of the current keyframe until the budget
+			 * is used up, but at least enough to complete the keyframe
+			 * within half of the keyframe interval.
+			 * @param start Time at which writing the tick started.
+			 * @return True if the keyframe is complete.
+			 */
+			bool writeKeyframe(EntityTable &entities, uint64_t start);
+			void writeUpdates(unsigned int tick, EntityTable &entities);
+			void writeCreated(const EntityPointer &entity);
+			void writeIndex(unsigned int tick, uint64_t offset);
+			/**
+			 * Fills in the record header and appends the record to the file.
+			 */
+			bool writeRecord(unsigned int tick, ReplayRecordType type);
+			/**
+			 * Resets the record buffer to an empty payload.
+			 */
+			void clearRecord();
+			bool append(const void *data, unsigned int size);
+			/**
+			 * Maps a window of the file which contains at least size bytes
+			 * starting at offset and grows the file accordingly.
+			 */
+			bool mapWindow(uint64_t offset, unsigned int size);
+
+			int file;
+			FILE *index;
+			char *window;
+			uint64_t windowoffset;
+			unsigned int windowsize;
+			/**
+			 * Bytes written to the file so far.
+			 */
+			uint64_t length;
+
+			unsigned int keyframeinterval;
+			/**
+			 * Record which is currently being built, the header is filled in
+			 * by writeRecord(). Reused for all records to avoid allocations.
+			 */
+			BufferPointer record;
+			bool changed;
+
+			unsigned int budget;
+			/**
+			 * Entities of the current keyframe, the ones from
+			 * keyframeposition on have not been written yet.
+			 */
+			std::vector<int> keyframeentities;
+			unsigned int keyframeposition;
+			/**
+			 * Contains true for the IDs of the entities which still have to
+			 * be written, deleted entities are removed.
+			 */
+			std::vector<bool> keyframepending;
+			/**
+			 * File offset of the record starting the current keyframe.
+			 */
+			uint64_t keyframeoffset;
+	};
+}
+
+#endif
@@ -0,0 +1,167 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _ROOM_HPP_
+#define _ROOM_HPP_
+
+#include "Game.hpp"
+#include "TickProfiler.hpp"
+#include "TickScheduler.hpp"
+#include "PathFinder.hpp"
+#include "Timer.hpp"
+
+#include <pthread.h>
+#include <vector>
+
+namespace backlot
+{
+	/**
+	 * Network events passed from the network thread to a room.
+	 */
+	enum RoomEventType
+	{
+		ERE_Connect,
+		ERE_Packet,
+		ERE_Disconnect
+	};
+
+	struct RoomEvent
+	{
+		RoomEventType type;
+		Client *client;
+		BufferPointer packet;
+		/**
+		 * Monotonic time at which the packet arrived, see
+		 * TickScheduler::getArrivalTime().
+		 */
+		uint64_t arrival;
+	};
+
+	/**
+	 * A single match running in its own thread. Every room has its own game
+	 * with its entities, scripts and timers as well as its own path finding
+	 * context and tick profiler, which are made current for the thread so
+	 * that Game::get() and the other accessors return them. Maps and entity
+	 * templates are only read and are shared between all rooms.
+	 *
+	 * Clients are assigned to a room when they connect. The network thread
+	 * passes their packets to the room which handles them at the start of
+	 * its next tick. Packets sent by the room are queued in the clients and
+	 * passed to ENet by the network thread, see Client::flushSendQueue().
+	 */
+	class Room
+	{
+		public:
+			/**
+			 * Constructor.
+			 * @param id ID of the room, only used for the log.
+			 */
+			Room(int id);
+			/**
+			 * Destructor. Stops the room.
+			 */
+			~Room();
+
+			/**
+			 * Starts the room thread and loads the game.
+			 * @param threads Number of additional threads used to encode
+			 * the update packets, see Game::setWorkerThreads().
+			 * @param replay Replay file the game is recorded to, empty to
+			 * not record the game.
+			 * @return False if the game could not be loaded.
+			 */
+			bool init(std::string mapname, std::string mode,
+				unsigned int threads, std::string replay = "");
+			/**
+			 * Stops the room thread and destroys the game. The clients which
+			 * are still in the room are deleted.
+			 */
+			void destroy();
+
+			int getID();
+			/**
+			 * Returns the number of clients assigned to this room. Must only
+			 * be called by the network thread.
+			 */
+			unsigned int getClientCount();
+
+			/**
+			 * Assigns a newly connected client to the room.
+			 */
+			void onConnect(Client *client);
+			/**
+			 * Passes a packet from a client in this room to the game.
+			 * @param arrival Monotonic time at which the packet arrived.
+			 */
+			void onPacket(Client *client, BufferPointer packet,
+				uint64_t arrival);
+			/**
+			 * Removes a disconnected client from the room. The room deletes
+			 * the client afterwards, so the network thread must not use it
+			 * any more.
+			 */
+			void onDisconnect(Client *client);
+		private:
+			static void *roomMain(void *room);
+			void run();
+			void makeCurrent();
+			void tick();
+			void handleEvents();
+			void handlePacket(Client *client, BufferPointer packet);
+			void removeClient(Client *client);
+			void sendStatistics();
+
+			int id;
+			std::string mapname;
+			std::string mode;
+			unsigned int workerthreads;
+			std::string replay;
+
+			Game game;
+			TickProfiler profiler;
+			TickScheduler scheduler;
+			PathFinderContext pathfinder;
+			std::vector<Timer*> timers;
+
+			pthread_t thread;
+			bool running;
+			volatile bool stopping;
+			/**
+			 * Set by the room thread once the game has been loaded.
+			 */
+			bool loaded;
+			bool loadresult;
+			pthread_cond_t loadedcond;
+
+			pthread_mutex_t eventmutex;
+			std::vector<RoomEvent> events;
+			std::vector<RoomEvent> handledevents;
+
+			std::vector<Client*> clients;
+			unsigned int clientcount;
+
+			uint64_t ticktime;
+			uint64_t maxticktime;
+			unsigned int tickcount;
+	};
+}
+
+#endif
@@ -31,32 +31,82 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 namespace backlot
 {
+	class Room;
+
+	/**
+	 * Network side of the server. The server owns the ENet host and runs in
+	 * the main thread, the games run in rooms in separate threads. New
+	 * clients are assigned to the room with the fewest clients, and their
+	 * packets are passed on to it.
+	 */
 	class Server
 	{
 		public:
 			static Server &get();
 			~Server();
 
-			bool init(int port, std::string mapname, int maxclients = 8);
+			/**
+			 * Creates the network socket and starts the rooms.
+			 * @param rooms Number of independent games.
+			 * @param threads Additional threads per room used to encode the
+			 * update packets.
+			 * @param replay If not empty, every room records its game to
+			 * the replay file replay.<room>.rec.
+			 */
+			bool init(int port, std::string mapname, int maxclients = 32,
+				unsigned int rooms = 1, unsigned int threads = 0,
+				std::string replay = "");
+			/**
+			 * Stops all rooms and closes the socket.
+			 */
 			bool destroy();
 
-			MapPointer getMap()
-			{
-				return map.get();
-			}
-
-			void sendToAll(BufferPointer buffer, bool reliable = false);
+			/**
+			 * Returns the map of the game of the calling thread.
+			 */
+			MapPointer getMap();
 
+			/**
+			 * Reads all pending packets and passes them to the rooms. Called
+			 * once per tick and whenever data arrives in between.
+			 */
+			void receive();
+			/**
+			 * Passes the packets queued by the rooms to ENet and sends them.
+			 */
+			void flush();
+			/**
+			 * Services the ENet host once per tick so that lost packets are
+			 * resent and timeouts are detected.
+			 */
 			bool update();
+			/**
+			 * Wakes up the network thread so that it calls flush(). Called
+			 * by the rooms at the end of their ticks.
+			 */
+			void notify();
+
+			/**
+			 * Returns the UDP socket the server listens on.
+			 */
+			int getSocket();
 		private:
 			Server();
 
-			ServerMapPointer map;
-			std::string mapname;
+			/**
+			 * Returns the room a new client is assigned to.
+			 */
+			Room *selectRoom();
 
 			ENetHost *host;
 
 			std::vector<Client*> clients;
+			std::vector<Room*> rooms;
+			/**
+			 * Packets passed to ENet during flush() which are released after
+			 * all clients were flushed.
+			 */
+			std::vector<OutgoingPacketPointer> created;
 	};
 }
 
@@ -30,7 +30,8 @@ namespace backlot
 
 			/**
 			 * Loads the map with the given name or returns an already loaded
-			 * one.
+			 * one. Can be called from several threads, all rooms on the same
+			 * map share it.
 			 */
 			static SharedPointer<ServerMap> get(std::string name);
 
@@ -0,0 +1,158 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _TICKPROFILER_HPP_
+#define _TICKPROFILER_HPP_
+
+#include "entity/EntityTemplate.hpp"
+
+#include <stdint.h>
+#include <vector>
+
+namespace backlot
+{
+	/**
+	 * Parts of a server tick which are timed separately.
+	 */
+	enum TickPhase
+	{
+		ETP_Receive,
+		ETP_Entities,
+		ETP_Scripts,
+		ETP_Timers,
+		ETP_Encode,
+		ETP_Flush,
+		ETP_PathFinding,
+		ETP_Replay,
+		ETP_Count
+	};
+
+	/**
+	 * Measures how long the phases of each server tick take. Ticks which take
+	 * longer than the tick length are written to the log together with the
+	 * entities and entity templates which spent the most time in their
+	 * scripts. Additionally a summary is written once per second.
+	 *
+	 * All lines consist of space separated key=value pairs, for example:
+	 * @code
+	 * tick_overrun tick=1234 total_us=25300 receive_us=120 ...
+	 *     top_entities=12:player:5300,45:bot:2100 top_templates=player:8000
+	 * @endcode
+	 * The summary also contains the part of the budget spent on recording the
+	 * replay, separately for the ticks which wrote keyframes.
+	 * Every room has its own profiler, the lines then also contain room=<id>.
+	 * All methods must be called from the thread running the tick.
+	 */
+	class TickProfiler
+	{
+		public:
+			TickProfiler();
+			~TickProfiler();
+
+			/**
+			 * Returns the profiler of the calling thread, see setCurrent().
+			 * Threads which did not set one use a global default profiler.
+			 */
+			static TickProfiler &get();
+			/**
+			 * Sets the profiler returned by get() in the calling thread.
+			 */
+			static void setCurrent(TickProfiler *profiler);
+
+			/**
+			 * Sets the room ID written into the log lines, -1 for none.
+			 */
+			void setRoom(int room);
+
+			/**
+			 * Sets the time a tick may take before it is reported.
+			 * Defaults to 20000 microseconds.
+			 */
+			void setBudget(unsigned int budget);
+			/**
+			 * Sets how many entities and templates are listed for a slow
+			 * tick. Defaults to 5.
+			 */
+			void setReportCount(unsigned int count);
+
+			/**
+			 * Starts measuring a new tick.
+			 */
+			void beginTick(unsigned int tick);
+			/**
+			 * Finishes the tick and writes the report if it was too slow.
+			 */
+			void endTick();
+
+			/**
+			 * Adds the time since start to a phase.
+			 * @return Current time, can be used as the start of the next
+			 * phase.
+			 */
+			uint64_t addTime(TickPhase phase, uint64_t start);
+			/**
+			 * Adds the time an entity spent in its script this tick.
+			 */
+			void addEntityTime(int id, const EntityTemplatePointer &tpl,
+				unsigned int time);
+			/**
+			 * Marks the current tick as one which wrote (a part of) a replay
+			 * keyframe.
+			 */
+			void markKeyframe();
+		private:
+			void writeOverrun(unsigned int total);
+			void writeSummary();
+
+			unsigned int budget;
+			unsigned int reportcount;
+			int room;
+
+			unsigned int tick;
+			uint64_t tickstart;
+			unsigned int phases[ETP_Count];
+			bool keyframe;
+
+			struct EntityTime
+			{
+				int id;
+				EntityTemplatePointer tpl;
+				unsigned int time;
+
+				bool operator<(const EntityTime &other) const
+				{
+					return time > other.time;
+				}
+			};
+			std::vector<EntityTime> entitytimes;
+
+			uint64_t summaryphases[ETP_Count];
+			uint64_t summarytotal;
+			unsigned int summarymax;
+			unsigned int summaryticks;
+			unsigned int summaryoverruns;
+			uint64_t summarykeyframetime;
+			unsigned int summarykeyframemax;
+			unsigned int summarykeyframes;
+	};
+}
+
+#endif
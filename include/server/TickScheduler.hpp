@@ -0,0 +1,220 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _TICKSCHEDULER_HPP_
+#define _TICKSCHEDULER_HPP_
+
+#include "Log.hpp"
+
+#include <stdint.h>
+
+namespace backlot
+{
+	/**
+	 * Histogram of durations in microseconds with fixed, roughly logarithmic
+	 * buckets from 50 microseconds up to two ticks.
+	 */
+	class Histogram
+	{
+		public:
+			Histogram();
+
+			static const unsigned int BUCKETS = 11;
+
+			/**
+			 * Adds a value to the matching bucket.
+			 */
+			void add(unsigned int value);
+			/**
+			 * Resets all buckets.
+			 */
+			void clear();
+
+			unsigned int getCount();
+			unsigned int getMaximum();
+			/**
+			 * Returns the number of values in a bucket.
+			 */
+			unsigned int getBucket(unsigned int bucket);
+			/**
+			 * Returns the upper bound of a bucket, 0 for the last one which
+			 * has none.
+			 */
+			static unsigned int getBucketLimit(unsigned int bucket);
+
+			/**
+			 * Appends the histogram as "name=limit:count,...,inf:count" and
+			 * "name_max=..." to a log message.
+			 */
+			void write(LogMessage &message, const char *name);
+		private:
+			unsigned int buckets[BUCKETS];
+			unsigned int count;
+			unsigned int maximum;
+	};
+
+	/**
+	 * Result of TickScheduler::wait().
+	 */
+	enum TickEvent
+	{
+		/**
+		 * The next tick is due.
+		 */
+		ETE_Tick,
+		/**
+		 * Data can be read from the socket.
+		 */
+		ETE_Receive,
+		/**
+		 * Another thread called notify().
+		 */
+		ETE_Notify
+	};
+
+	/**
+	 * Schedules the server ticks and wakes the main loop as soon as packets
+	 * arrive so that they do not wait for the end of the sleep.
+	 *
+	 * On Linux the ticks are driven by a timerfd with absolute deadlines so
+	 * that oversleeping does not add up, and epoll waits for it and the
+	 * socket at the same time. Other systems use select() with a timeout
+	 * until the next deadline.
+	 *
+	 * The difference between the scheduled and the actual start of the ticks
+	 * and the time from the arrival of packets until a room handled them
+	 * (which includes waiting for the next tick of the room) are
+	 * collected in histograms and written to the log every 10 seconds (with
+	 * room=<id> after the tag for the schedulers of the rooms):
+	 * @code
+	 * tick_schedule ticks=1500 jitter_us=50:480,100:15,...,inf:0
+	 *     jitter_us_max=130 latency_us=50:60,... latency_us_max=90 missed=0
+	 * @endcode
+	 */
+	class TickScheduler
+	{
+		public:
+			TickScheduler();
+			~TickScheduler();
+
+			/**
+			 * Returns the scheduler of the network thread.
+			 */
+			static TickScheduler &get();
+
+			/**
+			 * Starts the tick timer.
+			 * @param socket Socket to watch for incoming data, -1 if only
+			 * the ticks shall be scheduled.
+			 * @param interval Length of a tick in microseconds.
+			 */
+			bool init(int socket, unsigned int interval = 20000);
+			void destroy();
+
+			/**
+			 * Blocks until the next tick is due or until data arrives. If
+			 * both happened, data is reported first so that the tick works
+			 * with the newest input. Ticks which were missed because the
+			 * previous ones took too long are returned immediately one
+			 * after another.
+			 */
+			TickEvent wait();
+			/**
+			 * Returns the monotonic time at which the data reported by the
+			 * last ETE_Receive was noticed.
+			 */
+			uint64_t getArrivalTime();
+			/**
+			 * Has to be called after the data reported by wait() has been
+			 * read.
+			 */
+			void onReceived();
+			/**
+			 * Wakes up wait() which then returns ETE_Notify. Can be called
+			 * from any thread.
+			 */
+			void notify();
+
+			/**
+			 * Sets the room ID written into the log lines, -1 for none.
+			 */
+			void setRoom(int room);
+
+			Histogram &getJitter();
+			/**
+			 * Returns the number of ticks which started at least one tick
+			 * late since the last report.
+			 */
+			unsigned int getMissed();
+			/**
+			 * Returns the histogram of the time between the arrival of
+			 * packets and their handling. The rooms add to the histograms
+			 * of their schedulers when they handle a packet.
+			 */
+			Histogram &getLatency();
+
+			/**
+			 * Returns a time in microseconds which does not jump when the
+			 * system clock is changed.
+			 */
+			static uint64_t getMonotonicTime();
+		private:
+			void waitForEvents(bool block);
+			void drainPipe();
+			void closeTimer();
+			void closePipe();
+			void startTick();
+			void writeReport();
+
+			int socket;
+			unsigned int interval;
+			/**
+			 * Monotonic time of the next tick.
+			 */
+			uint64_t deadline;
+			/**
+			 * Monotonic time at which the next tick should start.
+			 */
+			uint64_t nexttick;
+			unsigned int pendingticks;
+			bool readable;
+			bool notified;
+			bool handledfortick;
+			/**
+			 * Pipe used by notify() to wake up the waiting thread.
+			 */
+			int notifypipe[2];
+			int room;
+			uint64_t readabletime;
+
+			#if defined(__linux__)
+			int epollfd;
+			int timerfd;
+			#endif
+
+			unsigned int ticks;
+			unsigned int missed;
+			Histogram jitter;
+			Histogram latency;
+	};
+}
+
+#endif
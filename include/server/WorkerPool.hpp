@@ -0,0 +1,94 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#ifndef _WORKERPOOL_HPP_
+#define _WORKERPOOL_HPP_
+
+#include <pthread.h>
+#include <vector>
+
+namespace backlot
+{
+	/**
+	 * Fixed set of threads which execute independent tasks in parallel.
+	 * run() distributes the indices of a task among the workers and the
+	 * calling thread and returns once all of them have been processed. Tasks
+	 * must not touch anything shared with other tasks unless it is
+	 * protected separately.
+	 */
+	class WorkerPool
+	{
+		public:
+			/**
+			 * Function executed for every index of a task.
+			 */
+			typedef void (*Task)(unsigned int index, void *data);
+
+			/**
+			 * Constructor.
+			 */
+			WorkerPool();
+			/**
+			 * Destructor. Stops all threads.
+			 */
+			~WorkerPool();
+
+			/**
+			 * Starts the worker threads.
+			 * @param threads Number of additional threads. With 0 threads,
+			 * tasks are run on the calling thread only.
+			 */
+			bool init(unsigned int threads);
+			/**
+			 * Stops all worker threads.
+			 */
+			void destroy();
+
+			/**
+			 * Returns the number of worker threads.
+			 */
+			unsigned int getThreadCount();
+
+			/**
+			 * Calls task(i, data) for all i from 0 to count - 1 and waits
+			 * until all calls have finished.
+			 */
+			void run(Task task, void *data, unsigned int count);
+		private:
+			static void *workerMain(void *pool);
+			void process();
+
+			std::vector<pthread_t> threads;
+			pthread_mutex_t mutex;
+			pthread_cond_t startcond;
+			pthread_cond_t donecond;
+
+			Task task;
+			void *data;
+			unsigned int count;
+			volatile unsigned int next;
+			unsigned int active;
+			unsigned int generation;
+			bool stopping;
+	};
+}
+
+#endif
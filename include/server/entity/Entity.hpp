@@ -29,6 +29,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Rectangle.hpp"
 
 #include <vector>
+#include <deque>
 
 namespace backlot
 {
@@ -46,6 +47,10 @@ namespace backlot
 
 			void saveState();
 			void getUpdate(int time, BufferPointer buffer, int client = 0);
+			/**
+			 * Applies an update from the owner. Only unlocked properties
+			 * which are not input are changed.
+			 */
 			void applyUpdate(BufferPointer buffer);
 			bool hasChanged(int time);
 
@@ -62,6 +67,53 @@ namespace backlot
 			Vector2F getSpeed();
 			RectangleF getRectangle();
 
+			/**
+			 * Sets how important updates for this entity are compared to
+			 * other entities when the bandwidth of a client is not
+			 * sufficient for all of them. Defaults to 1.
+			 */
+			void setPriority(float priority);
+			float getPriority();
+
+			/**
+			 * Number of ticks for which the past positions of the entity are
+			 * kept, a bit more than one second.
+			 */
+			static const unsigned int HISTORY_SIZE = 64;
+			/**
+			 * Stores the current rectangle as the one at the end of the
+			 * given tick. Called once per tick for movable entities.
+			 * @return Distance the entity moved since the last call.
+			 */
+			float recordHistory(unsigned int tick);
+			/**
+			 * Returns the rectangle the entity had at the end of the given
+			 * tick. Ticks after the last recorded one return the current
+			 * rectangle.
+			 * @return False if the entity did not exist at that tick or the
+			 * tick is not in the history anymore.
+			 */
+			bool getPastRectangle(unsigned int tick, RectangleF &rectangle);
+
+			/**
+			 * Number of input commands which may be queued before the entity
+			 * catches up by applying several commands in one tick. Gives
+			 * packets which arrive late a bit of time without adding
+			 * latency for a steady stream of input.
+			 */
+			static const unsigned int MAX_INPUT_DELAY = 2;
+			/**
+			 * Reads one input command with the values of the EPF_Input
+			 * properties (see EPT_Keys) and queues it if it is newer than
+			 * all commands received so far. Older commands were already
+			 * received in a previous packet and are skipped.
+			 */
+			void queueInput(unsigned int sequence, BufferPointer buffer);
+			/**
+			 * Applies the next queued input command. Called once per tick.
+			 */
+			void applyInput();
+
 			Property *getProperty(std::string name);
 
 			bool isVisible(Entity *from);
@@ -78,9 +130,30 @@ namespace backlot
 			std::vector<Property> properties;
 			Property *positionproperty;
 			Vector2F speed;
+			float priority;
 
 			bool changed;
 
+			struct PositionSnapshot
+			{
+				unsigned int tick;
+				RectangleF rectangle;
+			};
+			PositionSnapshot history[HISTORY_SIZE];
+			bool hashistory;
+			unsigned int lasthistorytick;
+			/**
+			 * Tick during which the entity was created.
+			 */
+			unsigned int spawntick;
+			/**
+			 * Whether the entity moved in the last recorded tick.
+			 */
+			bool moving;
+
+			std::deque<BufferPointer> input;
+			unsigned int inputsequence;
+
 			int owner;
 			int id;
 	};
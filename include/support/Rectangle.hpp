@@ -97,6 +97,14 @@ namespace backlot
 			{
 			}
 
+			Rectangle<T> &operator=(const Rectangle<T> &r)
+			{
+				x = r.x;
+				y = r.y;
+				width = r.width;
+				height = r.height;
+				return *this;
+			}
 			template<typename T2> Rectangle<T> &operator=(const Rectangle<T2> &r)
 			{
 				x = r.x;
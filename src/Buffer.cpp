@@ -20,26 +20,59 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
 #include "Buffer.hpp"
+#include "BufferPool.hpp"
 #include "Engine.hpp"
+#include "Log.hpp"
 
 #include <cstdlib>
 #include <cstring>
-#include <iostream>
 
 namespace backlot
 {
+	/**
+	 * Minimum capacity of a buffer, enough for most small messages.
+	 */
+	static const unsigned int MIN_CAPACITY = 64;
+
 	static inline unsigned int bytes(unsigned int bits)
 	{
 		return (bits + 7) / 8;
 	}
+	/**
+	 * Loads/stores eight bytes in network byte order. The compiler turns this
+	 * into a single unaligned load/store plus a byte swap.
+	 */
+	static inline uint64_t load64(const unsigned char *data)
+	{
+		return ((uint64_t)data[0] << 56) | ((uint64_t)data[1] << 48)
+			| ((uint64_t)data[2] << 40) | ((uint64_t)data[3] << 32)
+			| ((uint64_t)data[4] << 24) | ((uint64_t)data[5] << 16)
+			| ((uint64_t)data[6] << 8) | (uint64_t)data[7];
+	}
+	static inline void store64(unsigned char *data, uint64_t value)
+	{
+		for (int i = 7; i >= 0; i--)
+		{
+			data[i] = value & 0xFF;
+			value >>= 8;
+		}
+	}
+
 	Buffer::Buffer() : ReferenceCounted()
 	{
 		data = 0;
 		size = 0;
+		capacity = 0;
 		position = 0;
+		release = 0;
+		releasecontext = 0;
+		pooled = false;
 	}
 	Buffer::Buffer(void *data, unsigned int size, bool copy) : ReferenceCounted()
 	{
+		release = 0;
+		releasecontext = 0;
+		pooled = false;
 		if (copy)
 		{
 			this->data = (char*)malloc(size);
@@ -51,32 +84,63 @@ namespace backlot
 			this->data = (char*)data;
 			this->size = size;
 		}
+		capacity = size;
+		position = 0;
+	}
+	Buffer::Buffer(void *data, unsigned int size, ReleaseCallback release,
+		void *context) : ReferenceCounted()
+	{
+		this->data = (char*)data;
+		this->size = size;
+		capacity = size;
 		position = 0;
+		this->release = release;
+		releasecontext = context;
+		pooled = false;
 	}
 	Buffer::Buffer(const Buffer &b) : ReferenceCounted()
 	{
 		data = (char*)malloc(b.size);
 		memcpy(data, b.data, b.size);
 		size = b.size;
+		capacity = b.size;
 		position = 0;
+		release = 0;
+		releasecontext = 0;
+		pooled = false;
 	}
 	Buffer::~Buffer()
 	{
-		if (data)
-			free(data);
+		freeData();
 	}
 
 	void Buffer::setSize(unsigned int size)
 	{
-		data = (char*)realloc(data, size);
+		if (size > this->size)
+			grow(size);
+		else
+		{
+			// Keep the memory behind the data zeroed
+			if (data)
+				memset(data + size, 0, this->size - size);
+			if (position > size * 8)
+				position = size * 8;
+		}
 		this->size = size;
-		if (position > size)
-			position = size;
 	}
 	unsigned int Buffer::getSize()
 	{
 		return size;
 	}
+	void Buffer::reserve(unsigned int capacity)
+	{
+		if (capacity > this->capacity)
+			reallocate(capacity);
+	}
+	unsigned int Buffer::getCapacity()
+	{
+		return capacity;
+	}
 
 	void Buffer::setPosition(unsigned int position)
 	{
@@ -98,30 +162,17 @@ namespace backlot
 	{
 		if (position % 8)
 		{
-			if (position + 8 > size * 8)
-			{
-				data = (char*)realloc(data, size + 1);
-				size++;
-			}
-			writeByte(value);
-			position += 8;
+			writeUnsignedInt(value, 8);
+			return;
 		}
-		else
+		// We are on an even position
+		if (position / 8 == size)
 		{
-			// We are on an even position
-			if (position / 8 == size)
-			{
-				data = (char*)realloc(data, size + 1);
-				*(uint8_t*)(data + position / 8) = value;
-				size++;
-				position += 8;
-			}
-			else
-			{
-				*(uint8_t*)(data + position / 8) = value;
-				position++;
-			}
+			grow(size + 1);
+			size++;
 		}
+		*(uint8_t*)(data + position / 8) = value;
+		position += 8;
 	}
 	uint8_t Buffer::read8()
 	{
@@ -131,51 +182,28 @@ namespace backlot
 			return 0;
 		}
 		if (position % 8)
-		{
-			uint8_t byte = readByte();
-			position += 8;
-			if (position > size * 8)
-				position = size * 8;
-			return byte;
-		}
-		else
-		{
-			// We are on an even position
-			uint8_t value = *(uint8_t*)(data + position / 8);
-			position += 8;
-			return value;
-		}
+			return readUnsignedInt(8);
+		// We are on an even position
+		uint8_t value = *(uint8_t*)(data + position / 8);
+		position += 8;
+		return value;
 	}
 	void Buffer::write16(uint16_t value)
 	{
 		if (position % 8)
 		{
-			if (position + 16 > size * 8)
-			{
-				data = (char*)realloc(data, bytes(position + 16));
-				size = bytes(position + 16);
-			}
-			writeByte(value >> 8);
-			position += 8;
-			writeByte(value & 0xFF);
-			position += 8;
+			writeUnsignedInt(value, 16);
+			return;
 		}
-		else
+		// We are on an even position
+		if (position / 8 + 2 > size)
 		{
-			// We are on an even position
-			if (position / 8 + 2 > size)
-			{
-				data = (char*)realloc(data, position / 8 + 2);
-				*(uint16_t*)(data + position / 8) = htons(value);
-				position += 16;
-				size = position / 8;
-			}
-			else
-			{
-				*(uint16_t*)(data + position / 8) = htons(value);
-				position += 16;
-			}
+			grow(position / 8 + 2);
+			size = position / 8 + 2;
 		}
+		value = htons(value);
+		memcpy(data + position / 8, &value, 2);
+		position += 16;
 	}
 	uint16_t Buffer::read16()
 	{
@@ -185,56 +213,29 @@ namespace backlot
 			return 0;
 		}
 		if (position % 8)
-		{
-			uint16_t value = readByte() << 8;
-			position += 8;
-			if (position > size * 8)
-				position = size * 8;
-			value |= readByte();
-			position += 8;
-			if (position > size * 8)
-				position = size * 8;
-			return value;
-		}
-		else
-		{
-			// We are on an even position
-			uint16_t value = *(uint16_t*)(data + position / 8);
-			position += 16;
-			return ntohs(value);
-		}
+			return readUnsignedInt(16);
+		// We are on an even position
+		uint16_t value;
+		memcpy(&value, data + position / 8, 2);
+		position += 16;
+		return ntohs(value);
 	}
 	void Buffer::write32(uint32_t value)
 	{
 		if (position % 8)
 		{
-			if (position + 32 > size * 8)
-			{
-				data = (char*)realloc(data, bytes(position + 32));
-				size = bytes(position + 32);
-			}
-			for (int shift = 24; shift >= 0; shift -= 8)
-			{
-				writeByte((value >> shift) & 0xFF);
-				position += 8;
-			}
+			writeUnsignedInt(value, 32);
+			return;
 		}
-		else
+		// We are on an even position
+		if (position / 8 + 4 > size)
 		{
-			// We are on an even position
-			if (position / 8 + 4 > size)
-			{
-				data = (char*)realloc(data, position / 8 + 4);
-				*(uint32_t*)(data + position / 8) = htonl(value);
-				position += 32;
-				size += 4;
-			}
-			else
-			{
-				*(uint32_t*)(data + position / 8) = htonl(value);
-				position += 32;
-			}
+			grow(position / 8 + 4);
+			size = position / 8 + 4;
 		}
+		value = htonl(value);
+		memcpy(data + position / 8, &value, 4);
+		position += 32;
 	}
 	uint32_t Buffer::read32()
 	{
@@ -244,57 +245,17 @@ namespace backlot
 			return 0;
 		}
 		if (position % 8)
-		{
-			uint32_t value = 0;
-			for (int shift = 24; shift >= 0; shift -= 8)
-			{
-				value |= (uint32_t)readByte() << shift;
-				position += 8;
-				if (position > size * 8)
-					position = size * 8;
-			}
-			return value;
-		}
-		else
-		{
-			// We are on an even position
-			uint32_t value = *(uint32_t*)(data + position / 8);
-			position += 32;
-			return ntohl(value);
-		}
+			return readUnsignedInt(32);
+		// We are on an even position
+		uint32_t value;
+		memcpy(&value, data + position / 8, 4);
+		position += 32;
+		return ntohl(value);
 	}
 	void Buffer::write64(uint64_t value)
 	{
-		if (position % 8)
-		{
-			if (position + 64 > size * 8)
-			{
-				data = (char*)realloc(data, bytes(position + 64));
-				size = bytes(position + 64);
-			}
-			for (int shift = 56; shift >= 0; shift -= 8)
-			{
-				writeByte((value >> shift) & 0xFF);
-				position += 8;
-			}
-		}
-		else
-		{
-			// We are on an even position
-			// TODO: Byte ordering
-			if (position / 8 + 8 > size)
-			{
-				data = (char*)realloc(data, position / 8 + 8);
-				*(uint64_t*)(data + position / 8) = value;
-				position += 64;
-				size += 8;
-			}
-			else
-			{
-				*(uint64_t*)(data + position / 8) = value;
-				position += 64;
-			}
-		}
+		writeUnsignedInt(value >> 32, 32);
+		writeUnsignedInt(value & 0xFFFFFFFF, 32);
 	}
 	uint64_t Buffer::read64()
 	{
@@ -303,26 +264,8 @@ namespace backlot
 			position = size * 8;
 			return 0;
 		}
-		if (position % 8)
-		{
-			uint32_t value = 0;
-			for (int shift = 56; shift >= 0; shift -= 8)
-			{
-				value |= (uint64_t)readByte() << shift;
-				position += 8;
-				if (position > size * 8)
-					position = size * 8;
-			}
-			return value;
-		}
-		else
-		{
-			// We are on an even position
-			// TODO: Byte ordering
-			uint64_t value = *(uint64_t*)(data + position / 8);
-			position += 64;
-			return value;
-		}
+		uint64_t value = (uint64_t)readUnsignedInt(32) << 32;
+		return value | readUnsignedInt(32);
 	}
 
 	void Buffer::writeFloat(float value)
@@ -352,16 +295,11 @@ namespace backlot
 			// We are on an even position
 			if (position / 8 + value.size() + 1 > size)
 			{
-				data = (char*)realloc(data, position / 8 + value.size() + 1);
-				strcpy(data + position / 8, value.c_str());
-				position += (value.size() + 1) * 8;
-				size += value.size() + 1;
-			}
-			else
-			{
-				strcpy(data + position / 8, value.c_str());
-				position += (value.size() + 1) * 8;
+				grow(position / 8 + value.size() + 1);
+				size = position / 8 + value.size() + 1;
 			}
+			strcpy(data + position / 8, value.c_str());
+			position += (value.size() + 1) * 8;
 		}
 	}
 	std::string Buffer::readString()
@@ -402,65 +340,177 @@ namespace backlot
 	}
 	int Buffer::readInt(unsigned int size)
 	{
-		unsigned int value = 0;
-		for (unsigned int i = 0; i < (size + 7) / 8; i++)
+		unsigned int value = readUnsignedInt(size);
+		// Extend sign if necessary
+		if (size > 0 && size < 32 && (value & (1 << (size - 1))))
+			value |= 0xFFFFFFFF << size;
+		return value;
+	}
+	void Buffer::writeUnsignedInt(unsigned int value, unsigned int size)
+	{
+		if (size == 0)
+			return;
+		// The value is placed into the 64 bits starting at the byte of the
+		// current position, which always contain the whole value
+		unsigned int first = position / 8;
+		unsigned int end = bytes(position + size);
+		if (end > this->size)
 		{
-			((char*)&value)[i] = readByte();
-			if (size - i * 8 >= 8)
-				position += 8;
-			else
+			grow(first + 8);
+			this->size = end;
+		}
+		unsigned int shift = 64 - position % 8 - size;
+		uint64_t mask = (0xFFFFFFFFull >> (32 - size)) << shift;
+		uint64_t bits = ((uint64_t)value << shift) & mask;
+		if (first + 8 <= capacity)
+		{
+			unsigned char *word = (unsigned char*)data + first;
+			store64(word, (load64(word) & ~mask) | bits);
+		}
+		else
+		{
+			// Near the end of the memory, only the needed bytes are written
+			for (unsigned int i = first; i < end; i++)
+			{
+				unsigned int byteshift = 56 - (i - first) * 8;
+				unsigned char bytemask = mask >> byteshift;
+				data[i] = (data[i] & ~bytemask) | (bits >> byteshift);
+			}
+		}
+		position += size;
+	}
+	unsigned int Buffer::readUnsignedInt(unsigned int size)
+	{
+		if (size == 0)
+			return 0;
+		unsigned int first = position / 8;
+		uint64_t word = 0;
+		if (first + 8 <= capacity)
+			word = load64((unsigned char*)data + first);
+		else
+		{
+			// Near the end of the memory, missing bytes are read as 0
+			for (unsigned int i = 0; i < 8; i++)
 			{
-				position += size - i * 8;
-				((char*)&value)[i] &= 0xFF << (((size + 7) & ~7) - size);
+				word <<= 8;
+				if (first + i < this->size)
+					word |= (unsigned char)data[first + i];
 			}
 		}
+		unsigned int value = (word << position % 8) >> (64 - size);
+		position += size;
 		if (position > this->size * 8)
 			position = this->size * 8;
-		value = ntohl(value);
-		// Extend sign if necessary
-		if (value & 0x80000000)
-			return (value >> (32 - size)) | (0xFFFFFFFF << size);
-		else
-			return value >> (32 - size);
+		return value;
 	}
-	void Buffer::writeUnsignedInt(unsigned int value, unsigned int size)
+
+	void Buffer::writeVarInt(uint32_t value)
 	{
-		// Allocate memory
-		if (position + size > this->size * 8)
+		while (value >= 0x80)
 		{
-			data = (char*)realloc(data, bytes(position + size));
-			this->size = bytes(position + size);
+			writeUnsignedInt((value & 0x7F) | 0x80, 8);
+			value >>= 7;
 		}
-		// Left-align the number in memory
-		value <<= 32 - size;
-		value = htonl(value);
-		for (unsigned int i = 0; i < (size + 7) / 8; i++)
+		writeUnsignedInt(value, 8);
+	}
+	uint32_t Buffer::readVarInt()
+	{
+		uint32_t value = 0;
+		for (unsigned int shift = 0; shift < 35; shift += 7)
 		{
-			writeByte(((char*)&value)[i]);
-			if (size - i * 8 >= 8)
-				position += 8;
-			else
-				position += size - i * 8;
+			unsigned int byte = readUnsignedInt(8);
+			value |= (byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+				break;
 		}
+		return value;
 	}
-	unsigned int Buffer::readUnsignedInt(unsigned int size)
+	void Buffer::writeZigZag(int32_t value)
+	{
+		writeVarInt(((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+	}
+	int32_t Buffer::readZigZag()
 	{
-		unsigned int value = 0;
-		for (unsigned int i = 0; i < (size + 7) / 8; i++)
+		uint32_t value = readVarInt();
+		return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+	}
+	void Buffer::writeExpGolomb(uint32_t value, unsigned int order)
+	{
+		// n zeros followed by the n + 1 bits of q
+		uint64_t q = ((uint64_t)value >> order) + 1;
+		unsigned int n = 0;
+		while (q >> (n + 1))
+			n++;
+		if (n < 16)
+			writeUnsignedInt(q, 2 * n + 1);
+		else
 		{
-			((char*)&value)[i] = readByte();
-			if (size - i * 8 >= 8)
-				position += 8;
+			writeUnsignedInt(0, n);
+			if (n == 32)
+			{
+				writeUnsignedInt(1, 1);
+				writeUnsignedInt(q & 0xFFFFFFFF, 32);
+			}
 			else
+				writeUnsignedInt(q, n + 1);
+		}
+		if (order > 0)
+			writeUnsignedInt(value & (0xFFFFFFFF >> (32 - order)), order);
+	}
+	uint32_t Buffer::readExpGolomb(unsigned int order)
+	{
+		unsigned int n = 0;
+		while (readUnsignedInt(1) == 0)
+		{
+			// Invalid or truncated data
+			if (n == 32 || position >= size * 8)
 			{
-				position += size - i * 8;
-				((char*)&value)[i] &= 0xFF << (((size + 7) & ~7) - size);
+				position = size * 8;
+				return 0;
 			}
+			n++;
 		}
-		if (position > this->size * 8)
-			position = this->size * 8;
-		value = ntohl(value);
-		return value >> (32 - size);
+		uint64_t q = ((uint64_t)1 << n) | readUnsignedInt(n);
+		uint32_t value = (q - 1) << order;
+		if (order > 0)
+			value |= readUnsignedInt(order);
+		return value;
+	}
+
+	void Buffer::writeBits(const Buffer &buf, unsigned int bits)
+	{
+		if (bits > buf.size * 8)
+			bits = buf.size * 8;
+		unsigned int bytecount = bits / 8;
+		const unsigned char *source = (const unsigned char*)buf.data;
+		if (position % 8)
+		{
+			// Unaligned, every word has to be shifted
+			grow(bytes(position + bits) + 8);
+			unsigned int i = 0;
+			for (; i + 4 <= bytecount; i += 4)
+			{
+				writeUnsignedInt(((unsigned int)source[i] << 24)
+					| (source[i + 1] << 16) | (source[i + 2] << 8)
+					| source[i + 3], 32);
+			}
+			for (; i < bytecount; i++)
+				writeUnsignedInt(source[i], 8);
+		}
+		else
+		{
+			// We are on an even position, copy all whole bytes at once
+			if (position / 8 + bytecount > size)
+			{
+				grow(position / 8 + bytecount);
+				size = position / 8 + bytecount;
+			}
+			memcpy(data + position / 8, source, bytecount);
+			position += bytecount * 8;
+		}
+		// Remaining bits
+		if (bits % 8)
+			writeUnsignedInt(source[bytecount] >> (8 - bits % 8), bits % 8);
 	}
 
 	void Buffer::nextByte()
@@ -470,16 +520,20 @@ namespace backlot
 
 	Buffer &Buffer::operator=(const Buffer &b)
 	{
+		if (&b == this)
+			return *this;
+		freeData();
 		data = (char*)malloc(b.size);
 		memcpy(data, b.data, b.size);
 		size = b.size;
+		capacity = b.size;
 		position = 0;
 		return *this;
 	}
 	Buffer &Buffer::operator+=(const Buffer &b)
 	{
 		// TODO: Non-aligned buffers
-		data = (char*)realloc(data, size + b.size);
+		grow(size + b.size);
 		memcpy(data + size, b.data, b.size);
 		size += b.size;
 		return *this;
@@ -492,59 +546,59 @@ namespace backlot
 		{
 			snprintf(msg + i * 3, (size - i) * 3, "%02x ", (unsigned char)data[i]);
 		}
-		std::cout << msg << std::endl;
+		LOG_INFO(msg);
 		free(msg);
 	}
 
-	void Buffer::writeByte(unsigned char value)
+	void Buffer::dispose() const
 	{
-		if (position % 8)
-		{
-			// Write two halves of the byte
-			int offset = position % 8;
-			unsigned char b1 = value >> offset;
-			unsigned char b2 = value << (8 - offset);
-			unsigned char mask1 = 0xFF >> offset;
-			unsigned char mask2 = 0xFF << (8 - offset);
-			data[position / 8] &= mask2;
-			data[position / 8] |= b1;
-			if (position / 8 + 1 < size)
-			{
-				data[position / 8 + 1] &= mask1;
-				data[position / 8 + 1] |= b2;
-			}
-		}
+		if (pooled)
+			BufferPool::get().recycle(const_cast<Buffer*>(this));
 		else
-		{
-			// Directly write one byte
-			data[position / 8] = value;
-		}
+			delete this;
 	}
-	unsigned char Buffer::readByte()
+
+	void Buffer::grow(unsigned int size)
 	{
-		if (position >= size * 8)
-			return 0;
-		if (position % 8)
+		if (size <= capacity)
+			return;
+		unsigned int newcapacity = capacity * 2;
+		if (newcapacity < MIN_CAPACITY)
+			newcapacity = MIN_CAPACITY;
+		if (newcapacity < size)
+			newcapacity = size;
+		reallocate(newcapacity);
+	}
+	void Buffer::reallocate(unsigned int capacity)
+	{
+		if (!release)
+			data = (char*)realloc(data, capacity);
+		else
 		{
-			int offset = position % 8;
-			if (size * 8 < position + 8)
-			{
-				// Only read one half
-				unsigned char b = data[position / 8];
-				b <<= offset;
-				return b;
-			}
-			else
-			{
-				// Read the whole byte
-				unsigned char b1 = data[position / 8];
-				unsigned char b2 = data[position / 8 + 1];
-				return (b1 << offset) | (b2 >> (8 - offset));
-			}
+			// Borrowed memory cannot be resized, move the data into our own
+			char *copy = (char*)malloc(capacity);
+			memcpy(copy, data, size);
+			release(releasecontext);
+			release = 0;
+			releasecontext = 0;
+			data = copy;
 		}
-		else
+		// The memory behind the data is always zeroed so that partial writes
+		// at the end of the buffer never leave garbage in the unused bits
+		memset(data + this->capacity, 0, capacity - this->capacity);
+		this->capacity = capacity;
+	}
+	void Buffer::freeData()
+	{
+		if (release)
 		{
-			return data[position / 8];
+			release(releasecontext);
+			release = 0;
+			releasecontext = 0;
 		}
+		else if (data)
+			free(data);
+		data = 0;
+		capacity = 0;
 	}
 }
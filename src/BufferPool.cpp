@@ -0,0 +1,171 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "BufferPool.hpp"
+#include "ThreadLocal.hpp"
+
+#include <cstring>
+
+namespace backlot
+{
+	/**
+	 * Number of buffers a thread keeps in its own cache.
+	 */
+	static const unsigned int CACHE_SIZE = 64;
+	/**
+	 * Limits for the pooled memory. Larger buffers are rare and are freed.
+	 */
+	static const unsigned int MAX_POOL_SIZE = 4096;
+	static const unsigned int MAX_POOLED_CAPACITY = 65536;
+
+	static THREAD_LOCAL std::vector<Buffer*> *currentcache = 0;
+
+	static inline long atomicAdd(long *value, long amount)
+	{
+#ifdef _MSC_VER
+		return _InterlockedExchangeAdd(value, amount) + amount;
+#else
+		return __sync_add_and_fetch(value, amount);
+#endif
+	}
+
+	BufferPool &BufferPool::get()
+	{
+		// Never destroyed, buffers might be dropped during shutdown
+		static BufferPool *pool = new BufferPool;
+		return *pool;
+	}
+
+	BufferPointer BufferPool::allocate(unsigned int capacity)
+	{
+		Cache *cache = getCache();
+		if (cache->size() == 0)
+		{
+			// Refill the cache from the shared list
+			pthread_mutex_lock(&mutex);
+			unsigned int count = shared.size();
+			if (count > CACHE_SIZE / 2)
+				count = CACHE_SIZE / 2;
+			cache->insert(cache->end(), shared.end() - count, shared.end());
+			shared.resize(shared.size() - count);
+			pthread_mutex_unlock(&mutex);
+		}
+		Buffer *buffer;
+		if (cache->size() > 0)
+		{
+			buffer = cache->back();
+			cache->pop_back();
+			atomicAdd(&size, -1);
+			atomicAdd(&hits, 1);
+		}
+		else
+		{
+			buffer = new Buffer();
+			buffer->pooled = true;
+			atomicAdd(&misses, 1);
+		}
+		buffer->reserve(capacity);
+		return buffer;
+	}
+
+	unsigned int BufferPool::getHits()
+	{
+		return hits;
+	}
+	unsigned int BufferPool::getMisses()
+	{
+		return misses;
+	}
+	unsigned int BufferPool::getSize()
+	{
+		return size;
+	}
+	unsigned int BufferPool::getHighWater()
+	{
+		return highwater;
+	}
+
+	BufferPool::BufferPool()
+	{
+		pthread_mutex_init(&mutex, 0);
+		pthread_key_create(&cachekey, destroyCache);
+		hits = 0;
+		misses = 0;
+		size = 0;
+		highwater = 0;
+	}
+	BufferPool::~BufferPool()
+	{
+		pthread_key_delete(cachekey);
+		pthread_mutex_destroy(&mutex);
+	}
+
+	void BufferPool::recycle(Buffer *buffer)
+	{
+		if (buffer->getCapacity() > MAX_POOLED_CAPACITY
+			|| size >= (long)MAX_POOL_SIZE)
+		{
+			delete buffer;
+			return;
+		}
+		// Empty the buffer but keep its memory
+		if (buffer->size > 0)
+			memset(buffer->data, 0, buffer->size);
+		buffer->size = 0;
+		buffer->position = 0;
+		long newsize = atomicAdd(&size, 1);
+		// The high-water mark is only a statistic, races do not matter
+		if (newsize > highwater)
+			highwater = newsize;
+		Cache *cache = getCache();
+		cache->push_back(buffer);
+		if (cache->size() > CACHE_SIZE)
+		{
+			// Pass half of the buffers to other threads
+			pthread_mutex_lock(&mutex);
+			shared.insert(shared.end(), cache->begin() + CACHE_SIZE / 2,
+				cache->end());
+			pthread_mutex_unlock(&mutex);
+			cache->resize(CACHE_SIZE / 2);
+		}
+	}
+
+	BufferPool::Cache *BufferPool::getCache()
+	{
+		if (!currentcache)
+		{
+			currentcache = new Cache();
+			currentcache->reserve(CACHE_SIZE + 1);
+			pthread_setspecific(cachekey, currentcache);
+		}
+		return currentcache;
+	}
+	void BufferPool::destroyCache(void *cache)
+	{
+		BufferPool &pool = get();
+		Cache *buffers = (Cache*)cache;
+		pthread_mutex_lock(&pool.mutex);
+		pool.shared.insert(pool.shared.end(), buffers->begin(),
+			buffers->end());
+		pthread_mutex_unlock(&pool.mutex);
+		delete buffers;
+	}
+}
@@ -0,0 +1,326 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "Log.hpp"
+#include "Engine.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace backlot
+{
+	LogMessage::LogMessage()
+	{
+		length = 0;
+		text[0] = 0;
+	}
+
+	LogMessage &LogMessage::operator<<(const char *s)
+	{
+		if (s)
+			append(s, strlen(s));
+		return *this;
+	}
+	LogMessage &LogMessage::operator<<(const std::string &s)
+	{
+		append(s.c_str(), s.size());
+		return *this;
+	}
+	LogMessage &LogMessage::operator<<(const unsigned char *s)
+	{
+		return *this << (const char*)s;
+	}
+	LogMessage &LogMessage::operator<<(char c)
+	{
+		append(&c, 1);
+		return *this;
+	}
+	LogMessage &LogMessage::operator<<(bool b)
+	{
+		return *this << (b ? "1" : "0");
+	}
+	LogMessage &LogMessage::operator<<(int i)
+	{
+		char s[16];
+		return *this << (snprintf(s, sizeof(s), "%d", i), s);
+	}
+	LogMessage &LogMessage::operator<<(unsigned int i)
+	{
+		char s[16];
+		return *this << (snprintf(s, sizeof(s), "%u", i), s);
+	}
+	LogMessage &LogMessage::operator<<(long i)
+	{
+		char s[32];
+		return *this << (snprintf(s, sizeof(s), "%ld", i), s);
+	}
+	LogMessage &LogMessage::operator<<(unsigned long i)
+	{
+		char s[32];
+		return *this << (snprintf(s, sizeof(s), "%lu", i), s);
+	}
+	LogMessage &LogMessage::operator<<(long long i)
+	{
+		char s[32];
+		return *this << (snprintf(s, sizeof(s), "%lld", i), s);
+	}
+	LogMessage &LogMessage::operator<<(unsigned long long i)
+	{
+		char s[32];
+		return *this << (snprintf(s, sizeof(s), "%llu", i), s);
+	}
+	LogMessage &LogMessage::operator<<(double d)
+	{
+		// Same precision as std::ostream
+		char s[32];
+		return *this << (snprintf(s, sizeof(s), "%g", d), s);
+	}
+	LogMessage &LogMessage::operator<<(const void *p)
+	{
+		char s[32];
+		return *this << (snprintf(s, sizeof(s), "%p", p), s);
+	}
+
+	void LogMessage::append(const char *s, unsigned int size)
+	{
+		if (length + size > MAX_LENGTH - 1)
+			size = MAX_LENGTH - 1 - length;
+		memcpy(text + length, s, size);
+		length += size;
+		text[length] = 0;
+	}
+
+	Log &Log::get()
+	{
+		static Log log;
+		return log;
+	}
+	Log::~Log()
+	{
+		destroy();
+		pthread_mutex_destroy(&outputmutex);
+		delete[] ring;
+	}
+
+	bool Log::init()
+	{
+		if (running)
+			return true;
+		stopping = false;
+		running = true;
+		if (pthread_create(&writer, 0, writerMain, this))
+		{
+			running = false;
+			std::cerr << "Could not create log thread." << std::endl;
+			return false;
+		}
+		return true;
+	}
+	void Log::destroy()
+	{
+		if (!running)
+			return;
+		stopping = true;
+		pthread_join(writer, 0);
+		running = false;
+	}
+
+	bool Log::setFile(std::string filename)
+	{
+		// Older messages still go to the old output
+		flush();
+		pthread_mutex_lock(&outputmutex);
+		file.close();
+		file.clear();
+		file.open(filename.c_str());
+		bool opened = file.is_open();
+		pthread_mutex_unlock(&outputmutex);
+		return opened;
+	}
+
+	void Log::setLevel(LogLevel level)
+	{
+		this->level = level;
+	}
+
+	void Log::setRateLimit(unsigned int messages)
+	{
+		ratelimit = messages;
+	}
+
+	void Log::write(LogLevel level, const LogMessage &message)
+	{
+		if (!running)
+		{
+			// No writer thread, write the message directly
+			pthread_mutex_lock(&outputmutex);
+			output(level, message.getText(), message.getLength());
+			pthread_mutex_unlock(&outputmutex);
+			return;
+		}
+		// Reserve an entry in the ring buffer
+		unsigned int position = writeposition;
+		Entry *entry;
+		while (1)
+		{
+			entry = &ring[position % RING_SIZE];
+			int difference = (int)(entry->sequence - position);
+			if (difference == 0)
+			{
+				if (__sync_bool_compare_and_swap(&writeposition, position,
+					position + 1))
+					break;
+			}
+			else if (difference < 0)
+			{
+				// The buffer is full, never block the caller
+				__sync_fetch_and_add(&dropped, 1);
+				return;
+			}
+			position = writeposition;
+		}
+		// Fill the entry and pass it to the writer
+		entry->level = level;
+		entry->length = message.getLength();
+		memcpy(entry->text, message.getText(), entry->length);
+		__sync_synchronize();
+		entry->sequence = position + 1;
+	}
+	bool Log::allow(LogSite &site)
+	{
+		if (ratelimit == 0)
+			return true;
+		uint64_t now = Engine::getTime();
+		if (now - site.window >= 1000000)
+		{
+			site.window = now;
+			site.count = 0;
+		}
+		if (__sync_add_and_fetch(&site.count, 1) <= ratelimit)
+			return true;
+		__sync_fetch_and_add(&site.suppressed, 1);
+		return false;
+	}
+	void Log::write(LogLevel level, const LogMessage &message,
+		LogSite &site)
+	{
+		write(level, message);
+		unsigned int suppressed = __sync_lock_test_and_set(&site.suppressed, 0);
+		if (suppressed > 0)
+		{
+			LogMessage note;
+			note << "(" << suppressed << " similar messages suppressed)";
+			write(level, note);
+		}
+	}
+
+	void Log::flush()
+	{
+		if (!running)
+			return;
+		while (readposition != writeposition)
+			usleep(1000);
+	}
+
+	Log::Log()
+	{
+		ring = new Entry[RING_SIZE];
+		for (unsigned int i = 0; i < RING_SIZE; i++)
+			ring[i].sequence = i;
+		writeposition = 0;
+		readposition = 0;
+		dropped = 0;
+		running = false;
+		stopping = false;
+		pthread_mutex_init(&outputmutex, 0);
+		level = ELL_Info;
+		ratelimit = 20;
+	}
+
+	void *Log::writerMain(void *log)
+	{
+		Log *self = (Log*)log;
+		while (1)
+		{
+			pthread_mutex_lock(&self->outputmutex);
+			unsigned int written = 0;
+			while (self->writeNext())
+				written++;
+			unsigned int dropped = __sync_lock_test_and_set(&self->dropped, 0);
+			if (dropped > 0)
+			{
+				LogMessage note;
+				note << "(" << dropped << " messages dropped)";
+				self->output(ELL_Warning, note.getText(), note.getLength());
+				written++;
+			}
+			if (written > 0)
+			{
+				if (self->file.is_open())
+					self->file.flush();
+				else
+					std::cout.flush();
+			}
+			pthread_mutex_unlock(&self->outputmutex);
+			if (written == 0)
+			{
+				if (self->stopping)
+					break;
+				usleep(5000);
+			}
+		}
+		return 0;
+	}
+	bool Log::writeNext()
+	{
+		Entry &entry = ring[readposition % RING_SIZE];
+		if (entry.sequence != readposition + 1)
+			return false;
+		__sync_synchronize();
+		output(entry.level, entry.text, entry.length);
+		__sync_synchronize();
+		entry.sequence = readposition + RING_SIZE;
+		readposition++;
+		return true;
+	}
+	void Log::output(LogLevel level, const char *text, unsigned int length)
+	{
+		static const char *prefixes[] =
+		{
+			"debug: ",
+			"",
+			"warning: ",
+			"error: "
+		};
+		std::ostream *stream = &std::cout;
+		if (file.is_open())
+			stream = &file;
+		else if (level >= ELL_Warning)
+			stream = &std::cerr;
+		*stream << prefixes[level];
+		stream->write(text, length);
+		*stream << '\n';
+	}
+}
@@ -21,6 +21,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "Map.hpp"
 #include "Engine.hpp"
+#include "Log.hpp"
 #ifdef SERVER
 #include "Game.hpp"
 #endif
@@ -166,6 +167,18 @@ namespace backlot
 		}
 	}
 
+	Vector2F Map::move(Vector2F position, Vector2F speed)
+	{
+		// 50 ticks per second, the entities are 0.7 units large and can
+		// climb 0.5 units
+		Vector2F target = position + speed / 50;
+		float currentheight = getHeight(position);
+		RectangleF area(target.x - 0.35, target.y - 0.35, 0.7, 0.7);
+		if (getMaximumHeight(area) > currentheight + 0.5)
+			return position;
+		return target;
+	}
+
 	bool Map::readHeader(std::ifstream &file)
 	{
 		// Read header
@@ -173,7 +186,7 @@ namespace backlot
 		file.read((char*)&version, 4);
 		if (version != MAP_FORMAT_VERSION)
 		{
-			std::cerr << "Wrong map version (" << version << " vs " << MAP_FORMAT_VERSION << ")." << std::endl;
+			LOG_ERROR("Wrong map version (" << version << " vs " << MAP_FORMAT_VERSION << ").");
 			return false;
 		}
 		file.read((char*)&size.x, 4);
@@ -187,7 +200,7 @@ namespace backlot
 			file.read((char*)&runlength, 2);
 			if (!runlength)
 			{
-				std::cerr << "Error while reading height data." << std::endl;
+				LOG_ERROR("Error while reading height data.");
 				delete[] heightmap;
 				heightmap = 0;
 				return false;
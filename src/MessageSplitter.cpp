@@ -0,0 +1,79 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "MessageSplitter.hpp"
+#include "PacketCompressor.hpp"
+#include "BufferPool.hpp"
+#include "NetworkData.hpp"
+#include "Log.hpp"
+
+#include <cstring>
+
+namespace backlot
+{
+	bool MessageSplitter::split(BufferPointer packet,
+		std::vector<BufferPointer> &messages)
+	{
+		if (packet->getSize() == 0)
+		{
+			LOG_ERROR("Empty packet received.");
+			return false;
+		}
+		packet->setPosition(0);
+		PacketType type = (PacketType)packet->read8();
+		if (type == EPT_Compressed)
+		{
+			BufferPointer uncompressed = PacketCompressor::decompress(packet);
+			if (!uncompressed)
+			{
+				LOG_ERROR("Invalid compressed packet.");
+				return false;
+			}
+			return split(uncompressed, messages);
+		}
+		if (type != EPT_Batch)
+		{
+			packet->setPosition(0);
+			messages.push_back(packet);
+			return true;
+		}
+		// Every message in the batch is prefixed with its size
+		unsigned int position = 1;
+		while (position + 2 <= packet->getSize())
+		{
+			packet->setPosition(position * 8);
+			unsigned int size = packet->read16();
+			position += 2;
+			if (size == 0 || position + size > packet->getSize())
+			{
+				LOG_ERROR("Invalid batch received.");
+				return false;
+			}
+			BufferPointer part = BufferPool::get().allocate(size);
+			part->setSize(size);
+			memcpy(part->getData(), (char*)packet->getData() + position, size);
+			position += size;
+			if (!split(part, messages))
+				return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,235 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "PacketCompressor.hpp"
+#include "NetworkData.hpp"
+
+#include <cstdlib>
+#include <vector>
+
+namespace backlot
+{
+	static const unsigned int PROBABILITY_BITS = 11;
+	static const unsigned int PROBABILITY_ONE = 1 << PROBABILITY_BITS;
+	static const unsigned int ADAPTION_SHIFT = 4;
+	static const uint32_t TOP = 1 << 24;
+
+	/**
+	 * Probabilities of a 0 bit for every node of the bit tree of a byte.
+	 */
+	struct ByteModel
+	{
+		ByteModel()
+		{
+			for (unsigned int i = 0; i < 256; i++)
+				probability[i] = PROBABILITY_ONE / 2;
+		}
+
+		uint16_t probability[256];
+	};
+
+	class RangeEncoder
+	{
+		public:
+			RangeEncoder(std::vector<unsigned char> &output)
+				: output(output), low(0), range(0xFFFFFFFF), cache(0),
+				cachesize(1)
+			{
+			}
+
+			void encodeByte(ByteModel &model, unsigned int value)
+			{
+				unsigned int node = 1;
+				for (int i = 7; i >= 0; i--)
+				{
+					unsigned int bit = (value >> i) & 1;
+					encodeBit(model.probability[node], bit);
+					node = (node << 1) | bit;
+				}
+			}
+			void flush()
+			{
+				for (unsigned int i = 0; i < 5; i++)
+					shiftLow();
+			}
+		private:
+			void encodeBit(uint16_t &probability, unsigned int bit)
+			{
+				uint32_t bound = (range >> PROBABILITY_BITS) * probability;
+				if (!bit)
+				{
+					range = bound;
+					probability += (PROBABILITY_ONE - probability)
+						>> ADAPTION_SHIFT;
+				}
+				else
+				{
+					low += bound;
+					range -= bound;
+					probability -= probability >> ADAPTION_SHIFT;
+				}
+				while (range < TOP)
+				{
+					range <<= 8;
+					shiftLow();
+				}
+			}
+			void shiftLow()
+			{
+				// Bytes are held back as long as a carry might still change
+				// them
+				if ((uint32_t)low < 0xFF000000 || (low >> 32) != 0)
+				{
+					unsigned char carry = low >> 32;
+					unsigned char temp = cache;
+					do
+					{
+						output.push_back(temp + carry);
+						temp = 0xFF;
+					}
+					while (--cachesize != 0);
+					cache = (unsigned char)(low >> 24);
+				}
+				cachesize++;
+				low = (low & 0x00FFFFFF) << 8;
+			}
+
+			std::vector<unsigned char> &output;
+			uint64_t low;
+			uint32_t range;
+			unsigned char cache;
+			unsigned int cachesize;
+	};
+
+	class RangeDecoder
+	{
+		public:
+			RangeDecoder(const unsigned char *input, unsigned int size)
+				: input(input), size(size), position(0), range(0xFFFFFFFF),
+				code(0)
+			{
+				for (unsigned int i = 0; i < 5; i++)
+					code = (code << 8) | next();
+			}
+
+			unsigned int decodeByte(ByteModel &model)
+			{
+				unsigned int node = 1;
+				for (unsigned int i = 0; i < 8; i++)
+					node = (node << 1) | decodeBit(model.probability[node]);
+				return node & 0xFF;
+			}
+			/**
+			 * Returns true if the decoder tried to read past the input.
+			 */
+			bool isOverrun()
+			{
+				return position > size;
+			}
+		private:
+			unsigned int decodeBit(uint16_t &probability)
+			{
+				uint32_t bound = (range >> PROBABILITY_BITS) * probability;
+				unsigned int bit;
+				if (code < bound)
+				{
+					range = bound;
+					probability += (PROBABILITY_ONE - probability)
+						>> ADAPTION_SHIFT;
+					bit = 0;
+				}
+				else
+				{
+					code -= bound;
+					range -= bound;
+					probability -= probability >> ADAPTION_SHIFT;
+					bit = 1;
+				}
+				while (range < TOP)
+				{
+					range <<= 8;
+					code = (code << 8) | next();
+				}
+				return bit;
+			}
+			unsigned char next()
+			{
+				if (position < size)
+					return input[position++];
+				position++;
+				return 0;
+			}
+
+			const unsigned char *input;
+			unsigned int size;
+			unsigned int position;
+			uint32_t range;
+			uint32_t code;
+	};
+
+	BufferPointer PacketCompressor::compress(BufferPointer packet)
+	{
+		unsigned int size = packet->getSize();
+		if (size == 0 || size > 0xFFFF)
+			return 0;
+		const unsigned char *data = (const unsigned char*)packet->getData();
+		std::vector<unsigned char> output;
+		output.reserve(size + 8);
+		output.push_back(EPT_Compressed);
+		output.push_back(size >> 8);
+		output.push_back(size & 0xFF);
+		ByteModel model;
+		RangeEncoder encoder(output);
+		for (unsigned int i = 0; i < size; i++)
+			encoder.encodeByte(model, data[i]);
+		encoder.flush();
+		// The first byte written by the encoder is always 0
+		output.erase(output.begin() + 3);
+		if (output.size() >= size)
+			return 0;
+		return new Buffer(&output[0], output.size(), true);
+	}
+	BufferPointer PacketCompressor::decompress(BufferPointer packet)
+	{
+		unsigned int start = (packet->getPosition() + 7) / 8;
+		if (packet->getSize() < start + 2)
+			return 0;
+		const unsigned char *input = (const unsigned char*)packet->getData()
+			+ start;
+		unsigned int size = (input[0] << 8) | input[1];
+		// Prepend the 0 byte removed by the encoder
+		std::vector<unsigned char> coded(packet->getSize() - start - 1);
+		coded[0] = 0;
+		for (unsigned int i = 1; i < coded.size(); i++)
+			coded[i] = input[i + 1];
+		RangeDecoder decoder(&coded[0], coded.size());
+		ByteModel model;
+		unsigned char *data = (unsigned char*)malloc(size);
+		for (unsigned int i = 0; i < size; i++)
+			data[i] = decoder.decodeByte(model);
+		if (decoder.isOverrun())
+		{
+			free(data);
+			return 0;
+		}
+		return new Buffer(data, size);
+	}
+}
@@ -20,12 +20,38 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
 #include "PathFinder.hpp"
+#include "ThreadLocal.hpp"
 
 namespace backlot
 {
+	static PathFinderContext defaultcontext;
+	static THREAD_LOCAL PathFinderContext *currentcontext = 0;
+
+	PathFinderContext::PathFinderContext()
+		: grid(0), lastgridid(0)
+	{
+	}
+	PathFinderContext::~PathFinderContext()
+	{
+		if (grid)
+			delete[] grid;
+	}
+
+	PathFinderContext *PathFinderContext::getCurrent()
+	{
+		if (currentcontext)
+			return currentcontext;
+		return &defaultcontext;
+	}
+	void PathFinderContext::setCurrent(PathFinderContext *context)
+	{
+		currentcontext = context;
+	}
+
 	PathFinder::PathFinder(MapPointer map) : ReferenceCounted(), map(map)
 	{
 		status = EPFS_Inactive;
+		context = PathFinderContext::getCurrent();
 	}
 	PathFinder::~PathFinder()
 	{
@@ -38,8 +64,8 @@ namespace backlot
 		this->end = end;
 		status = EPFS_Waiting;
 		// Add to job lists
-		pathjobs.push(this);
-		if (pathjobs.size() == 1)
+		context->jobs.push(this);
+		if (context->jobs.size() == 1)
 			startSearch();
 		return true;
 	}
@@ -71,16 +97,17 @@ namespace backlot
 
 	void PathFinder::updateAll()
 	{
-		if (pathjobs.size() > 0)
+		PathFinderContext *context = PathFinderContext::getCurrent();
+		if (context->jobs.size() > 0)
 		{
 			// Continue first path finding job
-			PathFinderPointer pf = pathjobs.front();
+			PathFinderPointer pf = context->jobs.front();
 			if (pf->update())
 			{
-				pathjobs.pop();
+				context->jobs.pop();
 				// Start next path job
-				if (pathjobs.size() > 0)
-					pathjobs.front()->startSearch();
+				if (context->jobs.size() > 0)
+					context->jobs.front()->startSearch();
 			}
 		}
 	}
@@ -97,9 +124,9 @@ namespace backlot
 			// Get the node with the best estimation and continue there
 			OpenNode node = opennodes.top();
 			opennodes.pop();
-			Vector2I position(node.position % gridsize.x,
-				node.position / gridsize.x);
-			PathFinderCell &cell = grid[node.position];
+			Vector2I position(node.position % context->gridsize.x,
+				node.position / context->gridsize.x);
+			PathFinderCell &cell = context->grid[node.position];
 			if (position == end)
 			{
 				// We reached our target
@@ -122,7 +149,7 @@ namespace backlot
 			if (accessible & 0x1)
 				addNode(position + Vector2I(0, -1), cell.cost + 1);
 			// Mark cell as processed
-			cell.state = lastgridid + 1;
+			cell.state = context->lastgridid + 1;
 		}
 		return false;
 	}
@@ -131,17 +158,17 @@ namespace backlot
 	{
 		accessibility = map->getPathFindingInfo();
 		resizeGrid();
-		lastgridid += 2;
-		if (!lastgridid)
+		context->lastgridid += 2;
+		if (!context->lastgridid)
 		{
-			lastgridid += 2;
-			for (int i = 0; i < gridsize.x * gridsize.y; i++)
-				grid[i].state = 0;
+			context->lastgridid += 2;
+			for (int i = 0; i < context->gridsize.x * context->gridsize.y; i++)
+				context->grid[i].state = 0;
 		}
 		// Create initial search node
-		int position = start.y * gridsize.x + start.x;
-		PathFinderCell &startcell = grid[position];
-		startcell.state = lastgridid;
+		int position = start.y * context->gridsize.x + start.x;
+		PathFinderCell &startcell = context->grid[position];
+		startcell.state = context->lastgridid;
 		startcell.cost = 0;
 		startcell.estimation = getEstimation(0, start, end);
 		// Add node to the open list
@@ -151,26 +178,26 @@ namespace backlot
 	{
 		// Check old size
 		Vector2I mapsize = map->getSize();
-		if (mapsize != gridsize)
+		if (mapsize != context->gridsize)
 		{
 			// Recreate grid
-			if (grid)
-				delete[] grid;
-			gridsize = mapsize;
-			grid = new PathFinderCell[mapsize.x * mapsize.y];
-			lastgridid = 0;
+			if (context->grid)
+				delete[] context->grid;
+			context->gridsize = mapsize;
+			context->grid = new PathFinderCell[mapsize.x * mapsize.y];
+			context->lastgridid = 0;
 		}
 	}
 
 	void PathFinder::addNode(Vector2I position, float cost)
 	{
-		int gridindex = position.y * gridsize.x + position.x;
-		PathFinderCell &cell = grid[gridindex];
+		int gridindex = position.y * context->gridsize.x + position.x;
+		PathFinderCell &cell = context->grid[gridindex];
 		// Check whether we have already passed this cell
-		if ((cell.state == lastgridid) || (cell.state == lastgridid + 1))
+		if ((cell.state == context->lastgridid) || (cell.state == context->lastgridid + 1))
 			return;
 		// Mark cell as being processed
-		cell.state = lastgridid;
+		cell.state = context->lastgridid;
 		cell.cost = cost;
 		cell.estimation = getEstimation(cost, position, end);
 		// Add a node to the open list
@@ -190,15 +217,15 @@ namespace backlot
 	Vector2I PathFinder::getPreviousNode(const Vector2I &position)
 	{
 		// Get the current grid tile
-		int gridindex = position.y * gridsize.x + position.x;
-		PathFinderCell &current = grid[gridindex];
+		int gridindex = position.y * context->gridsize.x + position.x;
+		PathFinderCell &current = context->grid[gridindex];
 		Vector2I bestposition = position;
 		float bestcost = current.cost;
 		// Find the node with the least costs until this point
 		if (position.x > 0)
 		{
-			PathFinderCell &prev = grid[gridindex - 1];
-			if (prev.state == lastgridid + 1 && prev.cost < bestcost)
+			PathFinderCell &prev = context->grid[gridindex - 1];
+			if (prev.state == context->lastgridid + 1 && prev.cost < bestcost)
 			{
 				bestcost = prev.cost;
 				bestposition = position + Vector2I(-1, 0);
@@ -206,26 +233,26 @@ namespace backlot
 		}
 		if (position.y > 0)
 		{
-			PathFinderCell &prev = grid[gridindex - gridsize.x];
-			if (prev.state == lastgridid + 1 && prev.cost < bestcost)
+			PathFinderCell &prev = context->grid[gridindex - context->gridsize.x];
+			if (prev.state == context->lastgridid + 1 && prev.cost < bestcost)
 			{
 				bestcost = prev.cost;
 				bestposition = position + Vector2I(0, -1);
 			}
 		}
-		if (position.x < gridsize.x - 1)
+		if (position.x < context->gridsize.x - 1)
 		{
-			PathFinderCell &prev = grid[gridindex + 1];
-			if (prev.state == lastgridid + 1 && prev.cost < bestcost)
+			PathFinderCell &prev = context->grid[gridindex + 1];
+			if (prev.state == context->lastgridid + 1 && prev.cost < bestcost)
 			{
 				bestcost = prev.cost;
 				bestposition = position + Vector2I(1, 0);
 			}
 		}
-		if (position.y < gridsize.y - 1)
+		if (position.y < context->gridsize.y - 1)
 		{
-			PathFinderCell &prev = grid[gridindex + gridsize.x];
-			if (prev.state == lastgridid + 1 && prev.cost < bestcost)
+			PathFinderCell &prev = context->grid[gridindex + context->gridsize.x];
+			if (prev.state == context->lastgridid + 1 && prev.cost < bestcost)
 			{
 				bestcost = prev.cost;
 				bestposition = position + Vector2I(0, 1);
@@ -241,9 +268,4 @@ namespace backlot
 		return cost + way.x + way.y;
 	}
 
-	Vector2I PathFinder::gridsize;
-	PathFinderCell *PathFinder::grid = 0;
-	unsigned int PathFinder::lastgridid = 0;
-
-	std::queue<SharedPointer<PathFinder> > PathFinder::pathjobs;
 }
@@ -22,8 +22,8 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Preferences.hpp"
 #include "Engine.hpp"
 #include "tinyxml.h"
+#include "Log.hpp"
 
-#include <iostream>
 #include <sys/stat.h> 
 
 namespace backlot
@@ -47,7 +47,7 @@ namespace backlot
 		// Load config file
 		struct stat fileinfo;
 		std::string user_path = Engine::get().getGameDirectory() + "/user_config.xml";
-		std::cout << stat(user_path.c_str(), &fileinfo) << std::endl;
+		LOG_DEBUG(stat(user_path.c_str(), &fileinfo));
 		if (!stat(user_path.c_str(), &fileinfo))
 		{
 			setPath(user_path);
@@ -57,11 +57,11 @@ namespace backlot
 			setPath(Engine::get().getGameDirectory() + "/config.xml");
 		}
 		
-		std::cout << "Loading preferences from \"" << path << "\"...\n";
+		LOG_INFO("Loading preferences from \"" << path << "\"...");
 		TiXmlDocument conffile(path.c_str());
 		if (!conffile.LoadFile())
 		{
-			std::cerr << "Unable to load config file \"" << path << "\"!\n";
+			LOG_ERROR("Unable to load config file \"" << path << "\"!");
 			return false;
 		}
 
@@ -71,7 +71,7 @@ namespace backlot
 		node = conffile.FirstChild("config");
 		if (node == NULL)
 		{
-			std::cerr << "Can't find \"config\" in config file " << path << "!\n";
+			LOG_ERROR("Can't find \"config\" in config file " << path << "!");
 			return false;
 		}
 		
@@ -79,24 +79,24 @@ namespace backlot
 		node = node->FirstChild("graphics");
 		if (node == NULL)
 		{
-			std::cerr << "Can't find \"graphics\" in config file " << path << "!\n";
+			LOG_ERROR("Can't find \"graphics\" in config file " << path << "!");
 			return false;
 		}
 		element = node->ToElement();
 
 		if (element->Attribute("width", &screenresolution.x) == NULL)
 		{
-			std::cerr << "Can't find \"width\" in config file " << path << "!\n";
+			LOG_ERROR("Can't find \"width\" in config file " << path << "!");
 			return false;
 		}
 		if (element->Attribute("height", &screenresolution.y) == NULL)
 		{
-			std::cerr << "Can't find \"height\" in config file " << path << "!\n";
+			LOG_ERROR("Can't find \"height\" in config file " << path << "!");
 			return false;
 		}
 		if (element->Attribute("colordepth", &colordepth) == NULL)
 		{
-			std::cerr << "Can't find \"colordepth\" in config file " << path << "!\n";
+			LOG_ERROR("Can't find \"colordepth\" in config file " << path << "!");
 			return false;
 		}
 		if ( ((std::string)"yes").compare(element->Attribute("fullscreen")) == 0)
@@ -105,7 +105,7 @@ namespace backlot
 			fullscreen = false;
 		else
 		{
-			std::cerr << "Error on loading preferences: can't read vaule of attribute \"fullscreen\" in " << path << std::endl;
+			LOG_ERROR("Error on loading preferences: can't read vaule of attribute \"fullscreen\" in " << path);
 			return false;
 		}
 
@@ -114,7 +114,7 @@ namespace backlot
 		node = node->FirstChild("sound");
 		if (node == NULL)
 		{
-			std::cerr << "Can't find \"sound\" in " << path << std::endl;
+			LOG_ERROR("Can't find \"sound\" in " << path);
 			return false;
 		}
 		element = node->ToElement();
@@ -124,29 +124,40 @@ namespace backlot
 			stereo = false;
 		else
 		{
-			std::cerr << "Error on loading preferences: Can't read value of attribute \"stereo\" in " << path << std::endl;
+			LOG_ERROR("Error on loading preferences: Can't read value of attribute \"stereo\" in " << path);
 			return false;
 		}
 		if (element->Attribute("frequency", &frequency) == NULL)
 		{
-			std::cerr << "Can't find Attribute \"frequency\" in " << path << std::endl;
+			LOG_ERROR("Can't find Attribute \"frequency\" in " << path);
 			return false;
 		}
 		if (element->Attribute("bitrate", &bitrate) == NULL)
 		{
-			std::cerr << "Can't find Attribute \"bitrate\"n in " << path << std::endl;
+			LOG_ERROR("Can't find Attribute \"bitrate\"n in " << path);
 			return false;
 		}
+
+		// Load the network preferences, older config files do not have them
+		node = conffile.FirstChild("config");
+		node = node->FirstChild("network");
+		if (node != NULL)
+		{
+			element = node->ToElement();
+			element->Attribute("interpolationdelay", &interpolationdelay);
+			element->Attribute("maxextrapolation", &maxextrapolation);
+		}
 		return true;
 	}
 	bool Preferences::save()
 	{
-		std::cout << "Saving preferences to \"" << path << "\"...\n";
+		LOG_INFO("Saving preferences to \"" << path << "\"...");
 		TiXmlDocument doc;
 		TiXmlDeclaration *declaration = new TiXmlDeclaration("1.0", "UTF-8", "yes");
 		TiXmlElement *config = new TiXmlElement("config");
 		TiXmlElement *graphics = new TiXmlElement("graphics");
 		TiXmlElement *sound = new TiXmlElement("sound");
+		TiXmlElement *network = new TiXmlElement("network");
 		
 		graphics->SetAttribute("width", screenresolution.x);
 		graphics->SetAttribute("height", screenresolution.y);
@@ -162,11 +173,15 @@ namespace backlot
 			sound->SetAttribute("stereo", "no");
 		sound->SetAttribute("frequency", frequency);
 		sound->SetAttribute("bitrate", bitrate);
+
+		network->SetAttribute("interpolationdelay", interpolationdelay);
+		network->SetAttribute("maxextrapolation", maxextrapolation);
 		
 		doc.LinkEndChild(declaration);
 		doc.LinkEndChild(config);
 		config->LinkEndChild(graphics);
 		config->LinkEndChild(sound);
+		config->LinkEndChild(network);
 		
 		setPath(Engine::get().getGameDirectory() + "/user_config.xml");
 		doc.SaveFile(path.c_str());
@@ -236,7 +251,25 @@ namespace backlot
 		this->frequency = frequency;
 	}
 	
-	Preferences::Preferences()
+	int Preferences::getInterpolationDelay() const
+	{
+		return interpolationdelay;
+	}
+	void Preferences::setInterpolationDelay(int delay)
+	{
+		interpolationdelay = delay;
+	}
+	int Preferences::getMaxExtrapolation() const
+	{
+		return maxextrapolation;
+	}
+	void Preferences::setMaxExtrapolation(int extrapolation)
+	{
+		maxextrapolation = extrapolation;
+	}
+	
+	Preferences::Preferences() : interpolationdelay(100),
+		maxextrapolation(100)
 	{
 	}
 }
@@ -20,8 +20,8 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
 #include "Script.hpp"
+#include "Log.hpp"
 
-#include <iostream>
 extern "C"
 {
 	#include "lualib.h"
@@ -54,9 +54,9 @@ namespace backlot
 		}
 		if (error)
 		{
-			std::cerr << "Error while executing string:" << std::endl;
-			std::cerr <<  lua_tostring(state, -1) << std::endl;
-			std::cerr << "Code: \"" << data << "\"" << std::endl;
+			LOG_ERROR("Error while executing string:");
+			LOG_ERROR(lua_tostring(state, -1));
+			LOG_ERROR("Code: \"" << data << "\"");
 			return false;
 		}
 		return true;
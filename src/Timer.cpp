@@ -21,13 +21,17 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "Timer.hpp"
 #include "Engine.hpp"
-
-#include <iostream>
+#include "Log.hpp"
+#include "ThreadLocal.hpp"
 
 namespace backlot
 {
+	static std::vector<Timer*> defaulttimers;
+	static THREAD_LOCAL std::vector<Timer*> *currenttimers = 0;
+
 	Timer::Timer() : ReferenceCounted()
 	{
+		list = 0;
 		time = 0;
 		starttime = 0;
 		running = false;
@@ -67,7 +71,8 @@ namespace backlot
 	{
 		stop();
 		running = true;
-		timers.push_back(this);
+		list = getTimerList();
+		list->push_back(this);
 		starttime = Engine::getTime();
 	}
 	void Timer::stop()
@@ -75,11 +80,11 @@ namespace backlot
 		if (running)
 		{
 			time += (Engine::getTime() - starttime) / 1000;
-			for (unsigned int i = 0; i < timers.size(); i++)
+			for (unsigned int i = 0; i < list->size(); i++)
 			{
-				if (timers[i] == this)
+				if ((*list)[i] == this)
 				{
-					timers.erase(timers.begin() + i);
+					list->erase(list->begin() + i);
 					break;
 				}
 			}
@@ -103,6 +108,7 @@ namespace backlot
 
 	void Timer::callCallbacks()
 	{
+		std::vector<Timer*> &timers = *getTimerList();
 		for (unsigned int i = 0; i < timers.size(); i++)
 		{
 			unsigned int time = timers[i]->getTime();
@@ -117,7 +123,7 @@ namespace backlot
 					if (timers[i]->script->isFunction(timers[i]->function))
 						timers[i]->script->callFunction(timers[i]->function);
 					else
-						std::cout << "Timer: Function not present!" << std::endl;
+						LOG_WARNING("Timer: Function not present!");
 				}
 				// Stop timer
 				if (!timers[i]->periodic)
@@ -131,5 +137,14 @@ namespace backlot
 		}
 	}
 
-	std::vector<Timer*> Timer::timers;
+	void Timer::setTimerList(std::vector<Timer*> *list)
+	{
+		currenttimers = list;
+	}
+	std::vector<Timer*> *Timer::getTimerList()
+	{
+		if (currenttimers)
+			return currenttimers;
+		return &defaulttimers;
+	}
 }
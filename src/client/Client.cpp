@@ -23,14 +23,20 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Engine.hpp"
 #include "NetworkData.hpp"
 #include "Buffer.hpp"
+#include "MessageSplitter.hpp"
 #include "Effect.hpp"
 #include "Game.hpp"
+#include "Log.hpp"
 
-#include <iostream>
 #include <cstring>
 
 namespace backlot
 {
+	static void releasePacket(void *packet)
+	{
+		enet_packet_destroy((ENetPacket*)packet);
+	}
+
 	Client &Client::get()
 	{
 		static Client client;
@@ -46,7 +52,7 @@ namespace backlot
 		host = enet_host_create(NULL, 1, 0, 0);
 		if (host == 0)
 		{
-			std::cerr << "Could not create client socket." << std::endl;
+			LOG_ERROR("Could not create client socket.");
 			return false;
 		}
 		std::string hostname = address.substr(0, address.find(":"));
@@ -57,25 +63,26 @@ namespace backlot
 		if (!peer)
 		{
 			enet_host_destroy(host);
-			std::cerr << "Could not create client peer." << std::endl;
+			LOG_ERROR("Could not create client peer.");
 			return false;
 		}
 		ENetEvent event;
 		if (enet_host_service(host, &event, 5000) > 0
 			&& event.type == ENET_EVENT_TYPE_CONNECT)
 		{
-			std::cout << "Connected to " << address << std::endl;
+			LOG_INFO("Connected to " << address);
 		}
 		else
 		{
 			enet_peer_reset(peer);
 			enet_host_destroy(host);
-			std::cerr << "Connection refused." << std::endl;
+			LOG_ERROR("Connection refused.");
 			return false;
 		}
 		// Receive initial data
 		uint64_t starttime = Engine::get().getTime();
 		std::string mapname;
+		unsigned int features = 0;
 		bool gotdata = 0;
 		while (enet_host_service(host, &event, 1000) > 0)
 		{
@@ -83,23 +90,25 @@ namespace backlot
 			{
 				case ENET_EVENT_TYPE_RECEIVE:
 				{
-					// Copy packet
+					// The buffer frees the packet when it is not needed any more
 					BufferPointer msg = new Buffer(event.packet->data,
-						event.packet->dataLength, true);
-					enet_packet_destroy(event.packet);
+						event.packet->dataLength, releasePacket, event.packet);
 					PacketType type = (PacketType)msg->read8();
 					// Discard everything but the data we need
 					if (type == EPT_InitialData)
 					{
 						mapname = msg->readString();
 						int clientid = msg->read16();
+						// Older servers do not send any features
+						if (msg->getPosition() < msg->getSize() * 8)
+							features = msg->read8();
 						Game::get().load(mapname, clientid);
 						gotdata = true;
 					}
 					break;
 				}
 				case ENET_EVENT_TYPE_DISCONNECT:
-					std::cout << "Server disconnected." << std::endl;
+					LOG_INFO("Server disconnected.");
 					enet_peer_reset(peer);
 					enet_host_destroy(host);
 					return false;
@@ -115,7 +124,7 @@ namespace backlot
 		{
 			enet_peer_reset(peer);
 			enet_host_destroy(host);
-			std::cerr << "Did not receive server info." << std::endl;
+			LOG_ERROR("Did not receive server info.");
 			return false;
 		}
 		// Load map
@@ -124,14 +133,21 @@ namespace backlot
 		{
 			enet_peer_reset(peer);
 			enet_host_destroy(host);
-			std::cerr << "Could not load map." << std::endl;
+			LOG_ERROR("Could not load map.");
 			return false;
 		}
-		std::cout << "Map is ready." << std::endl;
+		LOG_INFO("Map is ready.");
 		map->setVisible(true);
 		// Send message back to the server
 		BufferPointer msg = new Buffer();
 		msg->write8(EPT_Ready);
+		msg->write8(features & ENF_Compression);
+		// Remote entities are drawn between the last two ticks minus the
+		// interpolation delay
+		unsigned int renderdelay = (unsigned int)(Game::get().getInterpolationDelay() + 1.5f);
+		if (renderdelay > 255)
+			renderdelay = 255;
+		msg->write8(renderdelay);
 		send(msg, true);
 		return true;
 	}
@@ -151,7 +167,7 @@ namespace backlot
 					enet_packet_destroy(event.packet);
 					break;
 				case ENET_EVENT_TYPE_DISCONNECT:
-					std::cout << "Disconnected properly." << std::endl;
+					LOG_INFO("Disconnected properly.");
 					disconnected = true;
 					break;
 				default:
@@ -173,7 +189,6 @@ namespace backlot
 	void Client::setAcknowledgedPacket(int time)
 	{
 		lastpacket = time;
-		Game::get().setAcknowledgedPacket(time);
 	}
 	int Client::getAcknowledgedPacket()
 	{
@@ -192,67 +207,35 @@ namespace backlot
 			switch (event.type)
 			{
 				case ENET_EVENT_TYPE_CONNECT:
-					std::cout << "Client connected." << std::endl;
+					LOG_INFO("Client connected.");
 					break;
 				case ENET_EVENT_TYPE_RECEIVE:
 				{
-					// Copy packet
+					// The buffer frees the packet when it is not needed any more
 					BufferPointer msg = new Buffer(event.packet->data,
-						event.packet->dataLength, true);
-					enet_packet_destroy(event.packet);
-					PacketType type = (PacketType)msg->read8();
-					// Parse packet
-					if (type == EPT_EntityCreated)
+						event.packet->dataLength, releasePacket, event.packet);
+					// Corrupt packets are dropped, the messages before the
+					// error are still handled
+					MessageSplitter::split(msg, messages);
+					for (unsigned int i = 0; i < messages.size(); i++)
 					{
-						std::cout << "New entity." << std::endl;
-						int id = msg->read16();
-						int owner = msg->read16();
-						std::string type = msg->readString();
-						// Create entity
-						EntityPointer entity = Game::get().addEntity(type, owner,
-							id, msg);
-						if (!entity)
+						if (!handleMessage(messages[i]))
 						{
-							std::cerr << "Could not create entity." << std::endl;
+							messages.clear();
 							return false;
 						}
-						std::cout << "Created client entity." << std::endl;
-					}
-					else if (type == EPT_EntityDeleted)
-					{
-						std::cout << "Entity deleted." << std::endl;
-						int id = msg->read16();
-						Game::get().removeEntity(id);
-					}
-					else if (type == EPT_Update)
-					{
-						Game::get().injectUpdates(msg);
-					}
-					else if (type == EPT_UpdateReceived)
-					{
-						// Get time info from the server
-						unsigned int time = msg->read32();
-						std::cout << time << " acked." << std::endl;
-						//unsigned int rtt = msg->read16();
-						setAcknowledgedPacket(time);
-						Game::get().setLag(Game::get().getTime() - time);
-					}
-					else
-					{
-						std::cerr << "Unknown packet received." << std::endl;
 					}
+					messages.clear();
 					break;
 				}
 				case ENET_EVENT_TYPE_DISCONNECT:
-					std::cout << "Client disconnected." << std::endl;
+					LOG_INFO("Client disconnected.");
 					break;
 				default:
 					break;
 			}
 		}
-		uint64_t end = Engine::getTime();
-		float updatetime = (float)(end - start) / 20000;
-		std::cout << "Client:" << updatetime << std::endl;
+		LOG_DEBUG("Client:" << (float)(Engine::getTime() - start) / 20000);
 		// Game logic
 		Game::get().update();
 		return true;
@@ -263,11 +246,75 @@ namespace backlot
 		lastpacket = 0;
 	}
 
+	bool Client::handleMessage(BufferPointer msg)
+	{
+		PacketType type = (PacketType)msg->read8();
+		// Parse packet
+		if (type == EPT_EntityCreated)
+		{
+			LOG_DEBUG("New entity.");
+			int id = msg->read16();
+			int owner = msg->read16();
+			std::string type = msg->readString();
+			// Create entity
+			EntityPointer entity = Game::get().addEntity(type, owner,
+				id, msg);
+			if (!entity)
+			{
+				LOG_ERROR("Could not create entity.");
+				return false;
+			}
+			LOG_DEBUG("Created client entity.");
+		}
+		else if (type == EPT_EntityDeleted)
+		{
+			LOG_DEBUG("Entity deleted.");
+			int id = msg->read16();
+			Game::get().removeEntity(id);
+		}
+		else if (type == EPT_ActivateEntity)
+		{
+			int id = msg->read16();
+			EntityPointer entity = Game::get().getEntity(id);
+			if (entity)
+			{
+				// The message contains the complete current state
+				entity->applyUpdate(msg, 0);
+				entity->setActive(true);
+			}
+		}
+		else if (type == EPT_DeactivateEntity)
+		{
+			int id = msg->read16();
+			EntityPointer entity = Game::get().getEntity(id);
+			if (entity)
+				entity->setActive(false);
+		}
+		else if (type == EPT_Update)
+		{
+			Game::get().injectUpdates(msg);
+		}
+		else if (type == EPT_UpdateReceived)
+		{
+			// Get time info from the server
+			unsigned int time = msg->read32();
+			LOG_DEBUG(time << " acked.");
+			//unsigned int rtt = msg->read16();
+			setAcknowledgedPacket(time);
+			Game::get().setLag(Game::get().getTime() - time);
+		}
+		else
+		{
+			LOG_ERROR("Unknown packet received.");
+		}
+		return true;
+	}
+
 	void Client::send(BufferPointer buffer, bool reliable)
 	{
 		ENetPacket *packet = enet_packet_create(buffer->getData(),
 			buffer->getSize(), reliable?ENET_PACKET_FLAG_RELIABLE:0);
-		enet_peer_send(peer, 0, packet);
+		enet_peer_send(peer, reliable ? ENC_Reliable : ENC_Updates, packet);
 	}
 
 	MapPointer Client::getMap()
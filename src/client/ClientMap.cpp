@@ -16,6 +16,7 @@ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 
 #include "ClientMap.hpp"
 #include "Engine.hpp"
+#include "Log.hpp"
 
 #include <iostream>
 #include <fstream>
@@ -62,7 +63,7 @@ namespace backlot
 			std::ifstream::in | std::ifstream::binary);
 		if (!file)
 		{
-			std::cerr << "Could not open map file " << name << ".blc." << std::endl;
+			LOG_ERROR("Could not open map file " << name << ".blc.");
 			return false;
 
 		}
@@ -72,7 +73,7 @@ namespace backlot
 		// Read entities
 		unsigned int entitycount = 0;
 		file.read((char*)&entitycount, 4);
-		std::cout << entitycount << " entities." << std::endl;
+		LOG_INFO(entitycount << " entities.");
 		for (unsigned int i = 0; i < entitycount; i++)
 		{
 			unsigned short namelength = 0;
@@ -81,7 +82,7 @@ namespace backlot
 			file.read(namedata, namelength);
 			namedata[namelength] = 0;
 			std::string entityname = namedata;
-			std::cout << "Entity: \"" << entityname << "\"" << std::endl;
+			LOG_DEBUG("Entity: \"" << entityname << "\"");
 			delete[] namedata;
 			float x;
 			float y;
@@ -92,8 +93,8 @@ namespace backlot
 			EntityTemplatePointer tpl = EntityTemplate::get(entityname);
 			if (!tpl)
 			{
-				std::cout << "Invalid entity type in map: \"" << entityname
-					<< "\"" << std::endl;
+				LOG_WARNING("Invalid entity type in map: \"" << entityname
+					<< "\"");
 				return false;
 			}
 			EntityStatePointer state = new EntityState(tpl);
@@ -20,9 +20,9 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
 #include "Effect.hpp"
+#include "Log.hpp"
 
 #include <GL/gl.h>
-#include <iostream>
 
 namespace backlot
 {
@@ -111,7 +111,7 @@ namespace backlot
 		{
 			if (effects[i] == this)
 			{
-				std::cout << "Erased " << i << std::endl;
+				LOG_DEBUG("Erased " << i);
 				effects.erase(effects.begin() + i);
 				break;
 			}
@@ -33,9 +33,9 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "SplashScreen.hpp"
 #include "PathFinder.hpp"
 #include "support/tinyxml.h"
+#include "Log.hpp"
 
 #include <SDL/SDL.h>
-#include <iostream>
 #include <sys/stat.h> 
 
 #if defined(_MSC_VER) || defined(_WINDOWS_) || defined(_WIN32)
@@ -68,12 +68,13 @@ namespace backlot
 	{
 		stopping = false;
 		directory = path;
+		Log::get().init();
 		
 		//Check to see if the Gamedir exist
 		struct stat fileinfo;
 		if (stat(getGameDirectory().c_str(), &fileinfo))
 		{
-			std::cerr << "Game directory does not exist!" << std::endl;
+			LOG_ERROR("Game directory does not exist!");
 			return false;
 		}
 		
@@ -81,14 +82,14 @@ namespace backlot
 		Preferences::get().setPath(getGameDirectory() + "/config.xml");
 		if (!Preferences::get().load())
 		{
-			std::cerr << "Could not load preferences." << std::endl;
+			LOG_ERROR("Could not load preferences.");
 			return false;
 		}
 		// Show configuration dialog
 		// Start engine
 		if (enet_initialize() != 0)
 		{
-			std::cerr << "Could not initialize networking." << std::endl;
+			LOG_ERROR("Could not initialize networking.");
 			return false;
 		}
 		if (!Graphics::get().init(Preferences::get().getResolution().x,
@@ -96,13 +97,13 @@ namespace backlot
 			Preferences::get().getColorDepth(),
 			Preferences::get().getFullscreen()))
 		{
-			std::cerr << "Could not open render window." << std::endl;
+			LOG_ERROR("Could not open render window.");
 			return false;
 		}
 		if (!Audio::get().init(Preferences::get().getFrequency(),
 			Preferences::get().getStereo()))
 		{
-			std::cerr << "Could not initialize sound." << std::endl;
+			LOG_ERROR("Could not initialize sound.");
 			return false;
 		}
 		// Show splash screens
@@ -112,13 +113,13 @@ namespace backlot
 		TiXmlDocument xml(filename.c_str());
 		if (!xml.LoadFile() || xml.Error())
 		{
-			std::cerr << "Could not load XML file game.xml: " << xml.ErrorDesc() << std::endl;
+			LOG_ERROR("Could not load XML file game.xml: " << xml.ErrorDesc());
 			return false;
 		}
 		TiXmlNode *node = xml.FirstChild("game");
 		if (!node)
 		{
-			std::cerr << "Parser error: <game> not found." << std::endl;
+			LOG_ERROR("Parser error: <game> not found.");
 			return false;
 		}
 		TiXmlElement *root = node->ToElement();
@@ -152,6 +153,10 @@ namespace backlot
 				startserver = false;
 				connect = true;
 			}
+			if (((option == "--debug") || (option == "-d")))
+			{
+				Log::get().setLevel(ELL_Debug);
+			}
 		}
 		if (startserver)
 		{
@@ -168,25 +173,38 @@ namespace backlot
 			}
 		}
 
-		// Main loop
+		// Main loop. The game logic runs with a fixed time step of 20 ms,
+		// rendering happens as often as possible (or with vsync) and
+		// interpolates between the last two ticks.
 		lastframe = getTime();
+		uint64_t accumulator = 0;
 		while (!stopping)
 		{
+			uint64_t currenttime = getTime();
+			accumulator += currenttime - lastframe;
+			lastframe = currenttime;
+			// Do not try to catch up after long stalls
+			if (accumulator > 5 * 20000)
+			{
+				LOG_DEBUG("Skipping " << (accumulator - 20000) / 20000 << " ticks.");
+				accumulator = 20000;
+			}
 			// Input
 			if (!Input::get().update())
 				stopping = true;
 			// Game logic
-			Server::get().update();
-			Client::get().update();
-			PathFinder::updateAll();
+			while (accumulator >= 20000)
+			{
+				Graphics::get().getCamera()->saveState();
+				Server::get().update();
+				Client::get().update();
+				PathFinder::updateAll();
+				accumulator -= 20000;
+			}
+			framealpha = (float)accumulator / 20000;
 			// Render everything
 			if (!Graphics::get().render())
 				stopping = true;
-			// Fixed time step
-			lastframe = lastframe + 20000;
-			uint64_t currenttime = getTime();
-			if (currenttime < lastframe)
-				usleep(lastframe - currenttime);
 		}
 		
 		Client::get().destroy();
@@ -204,12 +222,17 @@ namespace backlot
 		return directory;
 	}
 
+	float Engine::getFrameAlpha()
+	{
+		return framealpha;
+	}
+
 	void Engine::stop()
 	{
 		stopping = true;
 	}
 
-	Engine::Engine()
+	Engine::Engine() : framealpha(0)
 	{
 	}
 }
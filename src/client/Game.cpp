@@ -22,15 +22,45 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Game.hpp"
 #include "Engine.hpp"
 #include "NetworkData.hpp"
+#include "BufferPool.hpp"
 #include "Server.hpp"
 #include "Timer.hpp"
 
 #include "support/tinyxml.h"
+#include "Log.hpp"
+#include "Preferences.hpp"
 
-#include <iostream>
 
 namespace backlot
 {
+	/**
+	 * Share of the difference to the newest server tick by which the render
+	 * clock is corrected every tick, and the difference in ticks at which it
+	 * is reset instead.
+	 */
+	static const float RENDER_CLOCK_CORRECTION = 0.1f;
+	static const float RENDER_CLOCK_RESET = 10;
+
+	/**
+	 * Only accepts entities with a certain template.
+	 */
+	class TypeFilter : public EntityGrid::Filter
+	{
+		public:
+			TypeFilter(EntityTable &entities, const std::string &type)
+				: entities(entities), type(type)
+			{
+			}
+
+			virtual bool accept(int id)
+			{
+				return entities.get(id)->getTemplate()->getName() == type;
+			}
+		private:
+			EntityTable &entities;
+			const std::string &type;
+	};
+
 	Game &Game::get()
 	{
 		static Game game;
@@ -44,47 +74,50 @@ namespace backlot
 	{
 		this->clientid = clientid;
 		this->mapname = mapname;
-		for (int i = 0; i < 65535; i++)
-			entities[i] = 0;
+		entities.clear();
 		time = 0;
 		lag = 0;
-		maxentityid = 0;
+		newestupdate = 0;
+		renderclock = 0;
+		// Convert the network preferences from milliseconds to ticks
+		interpolationdelay = (float)Preferences::get().getInterpolationDelay() / 20;
+		maxextrapolation = (float)Preferences::get().getMaxExtrapolation() / 20;
 		return true;
 	}
 	bool Game::destroy()
 	{
 		// Remove entities
-		for (int i = 0; i < maxentityid + 1; i++)
-		{
-			if (entities[i])
-				entities[i]->destroyScript();
-			entities[i] = 0;
-		}
+		for (unsigned int i = 0; i < entities.getSize(); i++)
+			entities.getEntity(i)->destroyScript();
+		entities.clear();
+		grid.clear();
 		return true;
 	}
 
 	EntityPointer Game::addEntity(std::string type, int owner, int id,
 		BufferPointer state)
 	{
-		std::cout << "addEntity" << std::endl;
+		LOG_DEBUG("addEntity");
 		// Get entity template
 		EntityTemplatePointer tpl = EntityTemplate::get(type);
 		if (tpl.isNull())
 		{
-			std::cerr << "Could not get entity template \"" << type << "\"." << std::endl;
+			LOG_ERROR("Could not get entity template \"" << type << "\".");
 			return 0;
 		}
 		// Create entity
-		if (id > maxentityid)
-			maxentityid = id;
+		if (id < 0 || id >= EntityTable::MAX_ENTITIES)
+			return 0;
+		if (entities.get(id))
+			removeEntity(id);
 		EntityPointer entity = new Entity();
 		entity->setID(id);
 		entity->setOwner(owner);
 		entity->create(tpl, state);
 		// Insert entity into list
-		entities[id] = entity;
-		if (owner == getClientID())
-			localentities.push_back(entity);
+		entities.insert(entity);
+		if (entity->isMovable())
+			grid.update(entity->getID(), entity->getRectangle());
 		return entity;
 	}
 	void Game::removeEntity(EntityPointer entity)
@@ -94,34 +127,17 @@ namespace backlot
 	}
 	void Game::removeEntity(unsigned int id)
 	{
-		if (id >= 65535)
-			return;
-		if (!entities[id])
+		EntityPointer entity = entities.get(id);
+		if (!entity)
 			return;
-		// Delete from local list
-		if (entities[id]->isLocal())
-		{
-			// TODO: Maybe even use a std::vector?
-			std::list<EntityPointer>::iterator it = localentities.begin();
-			while (it != localentities.end())
-			{
-				if ((*it)->getID() == (int)id)
-				{
-					localentities.erase(it);
-					break;
-				}
-				it++;
-			}
-		}
 		// Delete entity
-		entities[id]->destroyScript();
-		entities[id] = 0;
+		entity->destroyScript();
+		grid.remove(id);
+		entities.remove(id);
 	}
 	EntityPointer Game::getEntity(int id)
 	{
-		if (id >= 65535)
-			return 0;
-		return entities[id];
+		return entities.get(id);
 	}
 
 	int Game::getClientID()
@@ -133,13 +149,39 @@ namespace backlot
 	{
 		return time;
 	}
+	float Game::getRenderTime()
+	{
+		// Frames are drawn between the last two ticks
+		return renderclock - 1 + Engine::get().getFrameAlpha()
+			- interpolationdelay;
+	}
+	float Game::getInterpolationDelay()
+	{
+		return interpolationdelay;
+	}
+	float Game::getMaxExtrapolation()
+	{
+		return maxextrapolation;
+	}
 
 	void Game::injectUpdates(BufferPointer buffer)
 	{
 		// Get server time step to which this update belongs to
 		unsigned int updatetime = buffer->read32();
+		// Updates can arrive late or out of order. Older ones would move
+		// the entities and the clock back, and the newer update already
+		// contains their changes unless it was acknowledged.
+		if (updatetime < newestupdate)
+			return;
+		if (newestupdate == 0)
+			renderclock = updatetime;
+		newestupdate = updatetime;
 		lag = buffer->read32();
 		time = updatetime;
+		// Activation messages use the reliable channel and can arrive after
+		// updates for the entity. Such packets are not acknowledged, so the
+		// server keeps sending the changes.
+		bool complete = true;
 		while (1)
 		{
 			// Get entity
@@ -147,31 +189,26 @@ namespace backlot
 			if (!entityid)
 				break;
 			entityid--;
-			if (entities[entityid].isNull())
+			EntityPointer entity = entities.get(entityid);
+			if (entity.isNull())
 			{
-				std::cout << "Entity " << entityid << " not available." << std::endl;
+				LOG_DEBUG("Entity " << entityid << " not available.");
 				return;
 			}
-			EntityPointer entity = entities[entityid];
+			if (!entity->isActive())
+				complete = false;
 			// Apply update
 			entity->applyUpdate(buffer, lag);
 		}
+		if (!complete)
+			return;
 		// Ack updates.
-		BufferPointer received = new Buffer();
+		BufferPointer received = BufferPool::get().allocate();
 		received->write8(EPT_UpdateReceived);
 		received->write32(updatetime);
 		Client::get().send(received);
 	}
 
-	void Game::setAcknowledgedPacket(int time)
-	{
-		// Clean up prediction data
-		for (int i = 0; i < maxentityid + 1; i++)
-		{
-			if (entities[i])
-				entities[i]->dropPredictionData(time);
-		}
-	}
 	void Game::setLag(unsigned int lag)
 	{
 		//this->lag = lag;
@@ -202,18 +239,17 @@ namespace backlot
 	EntityListPointer Game::getEntities(RectangleF area, std::string type)
 	{
 		EntityListPointer list = new EntityList();
-		for (int i = 0; i < maxentityid + 1; i++)
+		grid.query(area, queryresult);
+		for (unsigned int i = 0; i < queryresult.size(); i++)
 		{
-			if (entities[i] && entities[i]->isMovable())
-			{
-				// Check type if necessary
-				if (type != "" &&  entities[i]->getTemplate()->getName() != type)
-					continue;
-				// Check bounding rectangle
-				RectangleF br = entities[i]->getRectangle();
-				if (br.overlapsWith(area))
-					list->addEntity(entities[i]);
-			}
+			EntityPointer entity = entities.get(queryresult[i]);
+			// Check type if necessary
+			if (type != "" &&  entity->getTemplate()->getName() != type)
+				continue;
+			// The grid also returns rectangles which only touch the area
+			RectangleF br = entity->getRectangle();
+			if (br.overlapsWith(area))
+				list->addEntity(entity);
 		}
 		return list;
 	}
@@ -224,46 +260,116 @@ namespace backlot
 	EntityListPointer Game::getEntities(std::string type)
 	{
 		EntityListPointer list = new EntityList();
-		for (int i = 0; i < maxentityid + 1; i++)
+		for (unsigned int i = 0; i < entities.getSize(); i++)
 		{
-			if (entities[i] && entities[i]->getTemplate()->getName() == type)
-			{
-				list->addEntity(entities[i]);
-			}
+			const EntityPointer &entity = entities.getEntity(i);
+			if (entity->getTemplate()->getName() == type)
+				list->addEntity(entity);
+		}
+		return list;
+	}
+	EntityListPointer Game::getEntitiesInRadius(Vector2F center,
+		float radius, std::string type)
+	{
+		EntityListPointer list = new EntityList();
+		grid.queryRadius(center, radius, queryresult);
+		for (unsigned int i = 0; i < queryresult.size(); i++)
+		{
+			EntityPointer entity = entities.get(queryresult[i]);
+			if (type != "" &&  entity->getTemplate()->getName() != type)
+				continue;
+			list->addEntity(entity);
 		}
 		return list;
 	}
+	EntityPointer Game::getNearestEntity(Vector2F position,
+		float maxdistance, std::string type)
+	{
+		if (type == "")
+			return entities.get(grid.getNearest(position, maxdistance));
+		TypeFilter filter(entities, type);
+		return entities.get(grid.getNearest(position, maxdistance, &filter));
+	}
+
+	void Game::onEntityMoved(Entity *entity)
+	{
+		// Entities change their position while they are created, they are
+		// added to the grid once they are in the entity table
+		int id = entity->getID();
+		if (entities.get(id).get() != entity)
+			return;
+		grid.update(id, entity->getRectangle());
+	}
 
 	void Game::update()
 	{
-		// Update entities
-		for (int i = 0; i < maxentityid + 1; i++)
+		// Update entities, inactive ones are out of sight and do not get any
+		// updates from the server. Scripts can remove any entity, which
+		// reorders the entity table, so the list is copied first and removed
+		// entities are skipped.
+		updateentities = entities.getEntities();
+		for (unsigned int i = 0; i < updateentities.size(); i++)
 		{
-			if (entities[i])
-				entities[i]->update();
+			EntityPointer entity = updateentities[i];
+			if (entities.get(entity->getID()).get() != entity.get())
+				continue;
+			if (entity->isActive())
+				entity->update();
 		}
+		updateentities.clear();
 		// Timer callbacks
 		Timer::callCallbacks();
 		// Increase tick counter
 		time++;
+		// The render clock advances steadily and only slowly follows the
+		// server ticks, so that late or bunched updates do not make remote
+		// entities jump. Large differences (e.g. after a stall) are
+		// corrected at once.
+		renderclock += 1;
+		float error = (float)newestupdate + 1 - renderclock;
+		if (error > RENDER_CLOCK_RESET || error < -RENDER_CLOCK_RESET)
+			renderclock += error;
+		else
+			renderclock += error * RENDER_CLOCK_CORRECTION;
+		const std::vector<EntityPointer> &localentities = entities.getOwnedEntities(clientid);
+		// Send the input of the last ticks, so that single lost packets do
+		// not delay any input
+		inputsequence++;
+		BufferPointer input = BufferPool::get().allocate();
+		input->write8(EPT_Keys);
+		input->write32(time);
+		input->write32(inputsequence);
+		bool hasinput = false;
+		for (unsigned int i = 0; i < localentities.size(); i++)
+		{
+			if (!localentities[i]->hasInput())
+				continue;
+			localentities[i]->recordInput();
+			input->write16(localentities[i]->getID() + 1);
+			localentities[i]->getInput(input);
+			hasinput = true;
+		}
+		if (hasinput)
+		{
+			input->write16(0);
+			Client::get().send(input);
+		}
 		// Send updates to the server
 		int from = Client::get().getAcknowledgedPacket();
-		BufferPointer buffer = new Buffer();
+		BufferPointer buffer = BufferPool::get().allocate();
 		buffer->write8(EPT_Update);
 		buffer->write32(time);
 		unsigned int updatecount = 0;
-		// Check all entities
-		std::list<EntityPointer>::iterator it = localentities.begin();
-		while (it != localentities.end())
+		// Check all local entities
+		for (unsigned int i = 0; i < localentities.size(); i++)
 		{
 			// Add update to the packet
-			if ((*it)->hasChanged(from))
+			if (localentities[i]->hasChanged(from))
 			{
 				updatecount++;
-				buffer->write16((*it)->getID() + 1);
-				(*it)->getUpdate(from, buffer);
+				buffer->write16(localentities[i]->getID() + 1);
+				localentities[i]->getUpdate(from, buffer);
 			}
-			it++;
 		}
 		// Send updates
 		if (updatecount > 0)
@@ -272,5 +378,12 @@ namespace backlot
 
 	Game::Game()
 	{
+		time = 0;
+		lag = 0;
+		newestupdate = 0;
+		renderclock = 0;
+		inputsequence = 0;
+		interpolationdelay = 5;
+		maxextrapolation = 5;
 	}
 }
@@ -22,8 +22,8 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "HUD.hpp"
 #include "Engine.hpp"
 #include "tinyxml.h"
+#include "Log.hpp"
 
-#include <iostream>
 #include <string>
 
 namespace backlot
@@ -40,11 +40,11 @@ namespace backlot
 	bool HUD::load()
 	{
 		std::string configfilepath = Engine::get().getGameDirectory() + "/" + "hud.xml";
-		std::cout << "Loading HUD from \"" << configfilepath << "\"\n";
+		LOG_INFO("Loading HUD from \"" << configfilepath << "\"");
 		TiXmlDocument configfile(configfilepath.c_str());
 		if (!configfile.LoadFile())
 		{
-			std::cerr << "Could not load config file for HUD from \"" << configfilepath << "\"\n";
+			LOG_ERROR("Could not load config file for HUD from \"" << configfilepath << "\"");
 			return false;
 		}
 
@@ -53,12 +53,12 @@ namespace backlot
 
 		if ((root = configfile.FirstChild("hud")) == NULL)
 		{
-			std::cerr << "Could not find \"hud\" in \"" << configfilepath << "\"\n";
+			LOG_ERROR("Could not find \"hud\" in \"" << configfilepath << "\"");
 			return false;
 		}
 		if ((node = root->FirstChild("element")) == NULL)
 		{
-			std::cerr << "Could not find \"health\" in \"hud\" in \"" << configfilepath << "\"\n";
+			LOG_ERROR("Could not find \"health\" in \"hud\" in \"" << configfilepath << "\"");
 			return false;
 		}
 
@@ -67,7 +67,7 @@ namespace backlot
 			hudelements.push_back(HUDElement());
 			if (hudelements[i].load(node) == false)
 			{
-				std::cerr << "Error while loading HUD element #" << i << ".\n";
+				LOG_ERROR("Error while loading HUD element #" << i << ".");
 				return false;
 			}
 			node = root->IterateChildren("element", node);
@@ -21,9 +21,9 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "HUDElement.hpp"
 #include "Preferences.hpp"
+#include "Log.hpp"
 
 #include <GL/gl.h>
-#include <iostream>
 #include <cstdio>
 #include <string>
 
@@ -45,7 +45,7 @@ namespace backlot
 		// Get the type of the HUD element.
 		if (xmlelement->Attribute("type") == 0)
 		{
-			std::cerr << "No type information for HUD element given.\n";
+			LOG_ERROR("No type information for HUD element given.");
 			return false;
 		}
 		std::string typestring = xmlelement->Attribute("type");
@@ -55,27 +55,27 @@ namespace backlot
 			type = EHET_Ammo;
 		else
 		{
-			std::cerr << "Unknown HUD element type: \"" << typestring << "\"\n";
+			LOG_ERROR("Unknown HUD element type: \"" << typestring << "\"");
 			return false;
 		}
 
 		if (xmlelement->Attribute("position") == 0)
 		{
-			std::cerr << "No position information for HUD element given.\n";
+			LOG_ERROR("No position information for HUD element given.");
 			return false;
 		}
 		position = xmlelement->Attribute("position");
 
 		if (xmlelement->Attribute("offset") == 0)
 		{
-			std::cerr << "No offset information for HUD element given.\n";
+			LOG_ERROR("No offset information for HUD element given.");
 			return false;
 		}
 		offset = xmlelement->Attribute("offset");
 
 		if (xmlelement->Attribute("size") == 0)
 		{
-			std::cerr << "No size information for HUD element given.\n";
+			LOG_ERROR("No size information for HUD element given.");
 			return false;
 		}
 		size = xmlelement->Attribute("size");
@@ -94,7 +94,7 @@ namespace backlot
 			xmlelement = childnode->ToElement();
  			if (xmlelement->Attribute("name") == 0)
  			{
- 				std::cerr << "No font name for the HUD element given.\n";
+ 				LOG_ERROR("No font name for the HUD element given.");
  				return false;
  			}
 			font = Font::get(xmlelement->Attribute("name"));
@@ -126,13 +126,13 @@ namespace backlot
 			xmlelement = childnode->ToElement();
 			if (xmlelement->Attribute("path") == 0)
 			{
-				std::cerr << "No image path found for HUD element.\n";
+				LOG_ERROR("No image path found for HUD element.");
 				return false;
 			}
  			image->load(xmlelement->Attribute("path"));
 			if (xmlelement->Attribute("size") == 0)
 			{
-				std::cerr << "No image size for HUD element given.\n";
+				LOG_ERROR("No image size for HUD element given.");
 				return false;
 			}
 			imagesize = xmlelement->Attribute("size");
@@ -21,8 +21,8 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "Music.hpp"
 #include "Engine.hpp"
+#include "Log.hpp"
 
-#include <iostream>
 
 namespace backlot
 {
@@ -40,7 +40,7 @@ namespace backlot
 	Music *Music::getCurrentMusic()
 	{
 		if (currentmusic == NULL)
-			std::cerr << "In " << __FILE__ << __LINE__ << ": No music is played. Returning NULL.\n";
+			LOG_ERROR("In " << __FILE__ << __LINE__ << ": No music is played. Returning NULL.");
 		return currentmusic;
 	}
 
@@ -52,7 +52,7 @@ namespace backlot
 		music = Mix_LoadMUS(path.c_str());
 		if (music == NULL)
 		{
-			std::cerr << "Failed to load musicfile \"" << path << "\"\n";
+			LOG_ERROR("Failed to load musicfile \"" << path << "\"");
 			return false;
 		}
 		return true;
@@ -68,7 +68,7 @@ namespace backlot
 			{
 				if (Mix_PlayMusic(music, -1) != 0)
 				{
-					std::cerr << "Failed to play music\n";
+					LOG_ERROR("Failed to play music");
 					return false;
 				}
 				currentmusic = this;
@@ -76,14 +76,14 @@ namespace backlot
 			// If an other music file is played
 			else
 			{
-				std::cerr << "Already playing music. Don't start second playback.\n";
+				LOG_ERROR("Already playing music. Don't start second playback.");
 				return false;
 			}
 		}
 		// If no musicfile was loaded
 		else
 		{
-			std::cerr << "No music file was loaded!\n";
+			LOG_ERROR("No music file was loaded!");
 			return false;
 		}
 		return true;
@@ -101,14 +101,14 @@ namespace backlot
 			// If an other music is played
 			else
 			{
-				std::cerr << "An other music file is played. Stop that one!\n";
+				LOG_ERROR("An other music file is played. Stop that one!");
 				return false;
 			}
 		}
 		// If no music is played
 		else
 		{
-			std::cerr << "No music is played. Can't stop playback (how could I?)\n";
+			LOG_ERROR("No music is played. Can't stop playback (how could I?)");
 			return false;
 		}
 		return true;
@@ -122,14 +122,14 @@ namespace backlot
 			// If another music is playing
 			else
 			{
-				std::cerr << "An other music instance is playing. Pause that one!\n";
+				LOG_ERROR("An other music instance is playing. Pause that one!");
 				return false;
 			}
 		}
 		// If no music is playing
 		else
 		{
-			std::cerr << "No music is played. Can't pause playback.\n";
+			LOG_ERROR("No music is played. Can't pause playback.");
 			return false;
 		}
 		return true;
@@ -143,14 +143,14 @@ namespace backlot
 			// If an other music is paused
 			else
 			{
-				std::cerr << "An other music is paused. Resume that one!\n";
+				LOG_ERROR("An other music is paused. Resume that one!");
 				return false;
 			}
 		}
 		// If no music is paused
 		else
 		{
-			std::cerr << "No music is paused. Can't resume playback.\n";
+			LOG_ERROR("No music is paused. Can't resume playback.");
 			return false;
 		}
 		return true;
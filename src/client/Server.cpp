@@ -21,6 +21,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "Server.hpp"
 #include "Engine.hpp"
+#include "Log.hpp"
 
 #include <iostream>
 #include <cstring>
@@ -59,7 +60,7 @@ namespace backlot
 		if (!CreatePipe(&outread, &outwrite, &secattr, 0)
 			|| !CreatePipe(&inread, &inwrite, &secattr, 0))
 		{
-			std::cerr << "Could not create pipes." << std::endl;
+			LOG_ERROR("Could not create pipes.");
 			return false;
 		}
 		// Don't inherit unused ends
@@ -85,7 +86,7 @@ namespace backlot
 		}
 		else
 		{
-			std::cerr << "Could not start server." << std::endl;
+			LOG_ERROR("Could not start server.");
 			return false;
 		}
 		// Wait for server to be ready
@@ -100,7 +101,7 @@ namespace backlot
 			{
 				if (!ReadFile(inread, line + bytesread, 1, &byteread, NULL) || !byteread)
 				{
-					std::cerr << "Server closed unexpectedly." << std::endl;
+					LOG_ERROR("Server closed unexpectedly.");
 					return false;
 				}
 				if (line[bytesread] == '\n')
@@ -116,7 +117,7 @@ namespace backlot
 				bytesread++;
 			}
 			// Wait for "ready"
-			std::cout << "Server: \"" << line << "\"" << std::endl;
+			LOG_INFO("Server: \"" << line << "\"");
 			if (!strcmp(line, "ready"))
 			{
 				break;
@@ -131,7 +132,7 @@ namespace backlot
 		pid = fork();
 		if (pid == -1)
 		{
-			std::cerr << "Could not fork program." << std::endl;
+			LOG_ERROR("Could not fork program.");
 			return false;
 		}
 		if (pid)
@@ -154,7 +155,7 @@ namespace backlot
 			if (execlp("./server", "./server", Engine::get().getGameDirectory().c_str(),
 				mapname.c_str(), NULL) == -1)
 			{
-				std::cerr << "error: Could not start server.\n" << std::endl;
+				std::cerr << "Could not start server." << std::endl;
 				exit(-1);
 			}
 		}
@@ -171,7 +172,7 @@ namespace backlot
 				break;
 			}
 			msg[strlen(msg) - 1] = 0;
-			std::cout << "Server: \"" << msg << "\"" << std::endl;
+			LOG_INFO("Server: \"" << msg << "\"");
 			if (!strcmp(msg, "ready"))
 			{
 				break;
@@ -179,13 +180,13 @@ namespace backlot
 		}
 		if (!success)
 		{
-			std::cerr << "Error while starting server." << std::endl;
+			LOG_ERROR("Error while starting server.");
 			fclose(infile);
 			close(in);
 			close(out);
 			return false;
 		}
-		std::cout << "Server started." << std::endl;
+		LOG_INFO("Server started.");
 		#endif
 		return true;
 	}
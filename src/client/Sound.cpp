@@ -21,8 +21,8 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "Sound.hpp"
 #include "Engine.hpp"
+#include "Log.hpp"
 
-#include <iostream>
 
 namespace backlot
 {
@@ -44,7 +44,7 @@ namespace backlot
 		sound = Mix_LoadWAV(path.c_str());
 		if (sound == NULL)
 		{
-			std::cerr << "Failed to load soundfile \"" << path << "\"\n";
+			LOG_ERROR("Failed to load soundfile \"" << path << "\"");
 			return false;
 		}
 		return true;
@@ -58,13 +58,13 @@ namespace backlot
 			channel = Mix_PlayChannel(-1, sound, times);
 			if (channel == -1)
 			{
-				std::cerr << "Failed to start sound playback.\n";
+				LOG_ERROR("Failed to start sound playback.");
 				return false;
 			}
 		}
 		else
 		{
-			std::cerr << "No soundfile was loaded.\n";
+			LOG_ERROR("No soundfile was loaded.");
 			return false;
 		}
 		return true;
@@ -24,9 +24,9 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Preferences.hpp"
 
 #include "support/tinyxml.h"
+#include "Log.hpp"
 
 #include <vector>
-#include <iostream>
 #include <GL/gl.h>
 #include <SDL.h>
 
@@ -40,13 +40,13 @@ namespace backlot
 		TiXmlDocument xml(filename.c_str());
 		if (!xml.LoadFile() || xml.Error())
 		{
-			std::cerr << "Could not load XML file game.xml: " << xml.ErrorDesc() << std::endl;
+			LOG_ERROR("Could not load XML file game.xml: " << xml.ErrorDesc());
 			return false;
 		}
 		TiXmlNode *node = xml.FirstChild("game");
 		if (!node)
 		{
-			std::cerr << "Parser error: <game> not found." << std::endl;
+			LOG_ERROR("Parser error: <game> not found.");
 			return false;
 		}
 		TiXmlElement *root = node->ToElement();
@@ -60,7 +60,7 @@ namespace backlot
 				// Attributes
 				if (!splashdata->Attribute("image"))
 				{
-					std::cerr << "No splash screen image!" << std::endl;
+					LOG_ERROR("No splash screen image!");
 					splashnode = node->IterateChildren("splash", splashnode);
 					continue;
 				}
@@ -79,7 +79,7 @@ namespace backlot
 				SplashScreen *screen = new SplashScreen();
 				if (!screen->load(texture, time, input, index))
 				{
-					std::cerr << "Could not load splash screen." << std::endl;
+					LOG_ERROR("Could not load splash screen.");
 					splashnode = node->IterateChildren("splash", splashnode);
 					continue;
 				}
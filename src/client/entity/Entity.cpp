@@ -22,17 +22,27 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "entity/Entity.hpp"
 #include "Game.hpp"
 #include "Engine.hpp"
+#include "BufferPool.hpp"
 
 #include <iostream>
 
 namespace backlot
 {
+	/**
+	 * Prediction errors up to this distance are ignored. The server sends
+	 * positions with a precision of 0.01 units.
+	 */
+	static const float RECONCILE_THRESHOLD = 0.02f;
+
 	Entity::Entity() : ReferenceCounted()
 	{
 		owner = 0;
 		active = true;
 		positionproperty = 0;
 		id = 0;
+		// No tick matches the empty predictions
+		for (unsigned int i = 0; i < PREDICTION_SIZE; i++)
+			predictions[i].tick = -1;
 	}
 	Entity::~Entity()
 	{
@@ -55,6 +65,7 @@ namespace backlot
 			if (properties[i].getName() == "position")
 				positionproperty = &properties[i];
 		}
+		previousposition = getPosition();
 		// Create images
 		const std::vector<EntityImageInfo> &imageinfo = tpl->getImages();
 		for (unsigned int i = 0; i < imageinfo.size(); i++)
@@ -161,9 +172,11 @@ namespace backlot
 	{
 		for (unsigned int i = 0; i < properties.size(); i++)
 		{
-			if (!isLocal() || ((properties[i].getFlags() & EPF_Unlocked) == 0))
+			if (!isLocal() || ((properties[i].getFlags() & EPF_Unlocked) == 0)
+				|| (properties[i].getFlags() & EPF_Input))
 			{
-				// Potential update ignored because of property flags.
+				// Potential update ignored because of property flags. Input
+				// is sent separately, see getInput().
 				buffer->writeUnsignedInt(0, 1);
 				continue;
 			}
@@ -184,6 +197,7 @@ namespace backlot
 	void Entity::applyUpdate(BufferPointer buffer, int timedifference)
 	{
 		// Update all properties.
+		Vector2F predicted = getPosition();
 		bool positionchanged = false;
 		for (unsigned int i = 0; i < properties.size(); i++)
 		{
@@ -195,51 +209,52 @@ namespace backlot
 					positionchanged = true;
 			}
 		}
+		if (!isLocal())
+		{
+			// Remote entities are drawn from the snapshot buffer. Every
+			// update adds a snapshot, so that an entity which stopped gets
+			// two equal snapshots instead of being extrapolated further.
+			addSnapshot(Game::get().getTime(), getPosition());
+			return;
+		}
 		// Client side prediction
-		if (!isLocal() || timedifference <= 0 || !positionchanged)
+		if (timedifference <= 0 || !positionchanged)
 			return;
-		int originaltime = Game::get().getTime() - timedifference;
-		std::deque<SpeedInfo>::reverse_iterator speedinfo = recentspeeds.rbegin();
-		while (speedinfo != recentspeeds.rend())
+		// The server position belongs to the tick the server got the
+		// latest input for. Nothing has to be done if we predicted the same
+		// position for that tick.
+		int now = Game::get().getTime();
+		if (timedifference > (int)PREDICTION_SIZE)
+			timedifference = PREDICTION_SIZE;
+		if (timedifference > now)
+			timedifference = now;
+		int originaltime = now - timedifference;
+		const PredictedState &original = predictions[originaltime % PREDICTION_SIZE];
+		if (original.tick == originaltime
+			&& (original.position - getPosition()).getLengthSquared()
+			< RECONCILE_THRESHOLD * RECONCILE_THRESHOLD)
 		{
-			// Check speedinfo range
-			int start = speedinfo->time;
-			if (start < originaltime)
-				start = originaltime;
-			std::deque<SpeedInfo>::reverse_iterator next = speedinfo;
-			next++;
-			int end = 0;
-			if (next != recentspeeds.rend())
-			{
-				end = next->time;
-			}
-			else
-			{
-				end = Game::get().getTime();
-			}
-			if (end >= start)
+			positionproperty->setVector2F(predicted);
+			return;
+		}
+		// Repeat the movement of the following ticks from the server
+		// position
+		Vector2F position = getPosition();
+		MapPointer map = Client::get().getMap();
+		for (int tick = originaltime + 1; tick <= now; tick++)
+		{
+			PredictedState &state = predictions[tick % PREDICTION_SIZE];
+			if (state.tick != tick)
 			{
-				if (positionproperty && speedinfo->speed != Vector2F(0, 0))
-				{
-					Vector2F position = positionproperty->getVector2F();
-					MapPointer map = Client::get().getMap();
-					// Apply speed
-					for (int i = start; i < end; i++)
-					{
-						float currentheight = map->getHeight(position);
-						position += speedinfo->speed / 50;
-						RectangleF area(position.x - 0.35, position.y - 0.35, 0.7, 0.7);
-						float maxheight = map->getMaximumHeight(area);
-						if (maxheight >= currentheight + 0.5)
-						{
-							position -= speedinfo->speed / 50;
-						}
-					}
-					positionproperty->setVector2F(position);
-				}
+				// Not predicted, e.g. right after the entity was created
+				state.tick = tick;
+				state.speed = speed;
 			}
-			speedinfo++;
+			if (state.speed != Vector2F(0, 0))
+				position = map->move(position, state.speed);
+			state.position = position;
 		}
+		positionproperty->setVector2F(position);
 	}
 	bool Entity::hasChanged(int time)
 	{
@@ -247,7 +262,9 @@ namespace backlot
 			return false;
 		for (unsigned int i = 0; i < properties.size(); i++)
 		{
-			if ((properties[i].getFlags() & EPF_Unlocked) && properties[i].getChangeTime() > time)
+			if ((properties[i].getFlags() & EPF_Unlocked)
+				&& !(properties[i].getFlags() & EPF_Input)
+				&& properties[i].getChangeTime() > time)
 			{
 				return true;
 			}
@@ -292,24 +309,49 @@ namespace backlot
 			return positionproperty->getVector2F();
 		return Vector2F();
 	}
-	void Entity::setSpeed(Vector2F speed, bool ignoreobstacles)
+	Vector2F Entity::getRenderPosition()
 	{
-		if (this->speed == speed)
-			return;
-		// Set speed
-		this->speed = speed;
-		// Insert speed into the recent speeds list
-		int time = Game::get().getTime();
-		std::deque<SpeedInfo>::iterator first = recentspeeds.begin();
-		if (first != recentspeeds.end() && first->time == time)
+		if (isLocal())
 		{
-			first->speed = speed;
-			return;
+			float alpha = Engine::get().getFrameAlpha();
+			return previousposition + (getPosition() - previousposition) * alpha;
+		}
+		if (snapshots.empty())
+			return getPosition();
+		float rendertime = Game::get().getRenderTime();
+		// Too old, we do not have any older positions
+		if (rendertime <= snapshots.front().time)
+			return snapshots.front().position;
+		// Interpolate between the two snapshots around the render time
+		for (unsigned int i = snapshots.size() - 1; i > 0; i--)
+		{
+			const PositionSnapshot &from = snapshots[i - 1];
+			const PositionSnapshot &to = snapshots[i];
+			if (rendertime > to.time)
+				break;
+			if (rendertime < from.time)
+				continue;
+			float t = (rendertime - from.time) / (to.time - from.time);
+			return from.position + (to.position - from.position) * t;
 		}
-		SpeedInfo newentry;
-		newentry.time = time;
-		newentry.speed = speed;
-		recentspeeds.push_front(newentry);
+		// No newer snapshot yet, extrapolate from the last two for a while
+		const PositionSnapshot &last = snapshots.back();
+		if (snapshots.size() < 2)
+			return last.position;
+		const PositionSnapshot &previous = snapshots[snapshots.size() - 2];
+		// Low priority entities can be left out of several updates, so the
+		// entity is held at the limit. Entities which stop are resent by the
+		// server and get two equal snapshots.
+		float ahead = rendertime - last.time;
+		if (ahead > Game::get().getMaxExtrapolation())
+			ahead = Game::get().getMaxExtrapolation();
+		Vector2F velocity = (last.position - previous.position)
+			/ (float)(last.time - previous.time);
+		return last.position + velocity * ahead;
+	}
+	void Entity::setSpeed(Vector2F speed, bool ignoreobstacles)
+	{
+		this->speed = speed;
 	}
 	Vector2F Entity::getSpeed()
 	{
@@ -339,6 +381,9 @@ namespace backlot
 	void Entity::setActive(bool active)
 	{
 		this->active = active;
+		// Do not interpolate across the time the entity was out of sight
+		if (!active)
+			snapshots.clear();
 	}
 	bool Entity::isActive()
 	{
@@ -347,19 +392,24 @@ namespace backlot
 
 	void Entity::update()
 	{
+		previousposition = getPosition();
 		// Move entity
 		if (positionproperty && speed != Vector2F(0, 0))
 		{
 			Vector2F position = positionproperty->getVector2F();
-			MapPointer map = Client::get().getMap();
-			float currentheight = map->getHeight(position);
-			position += speed / 50;
-			RectangleF area(position.x - 0.35, position.y - 0.35, 0.7, 0.7);
-			float maxheight = map->getMaximumHeight(area);
-			if (maxheight <= currentheight + 0.5)
-			{
-				positionproperty->setVector2F(position);
-			}
+			Vector2F moved = Client::get().getMap()->move(position, speed);
+			if (moved != position)
+				positionproperty->setVector2F(moved);
+		}
+		// Remember the prediction for this tick, the tick counter is
+		// increased after the entities have been updated
+		if (positionproperty && isLocal())
+		{
+			int tick = Game::get().getTime() + 1;
+			PredictedState &state = predictions[tick % PREDICTION_SIZE];
+			state.tick = tick;
+			state.position = getPosition();
+			state.speed = speed;
 		}
 		// Call frame callback
 		if (script->isFunction("on_update"))
@@ -371,27 +421,66 @@ namespace backlot
 		return script;
 	}
 
-	void Entity::dropPredictionData(int time)
+	bool Entity::hasInput()
 	{
-		if (recentspeeds.size() == 0)
-			return;
-		// Delete all speed infos which are not used any more
-		while (recentspeeds.rbegin()->time <= time)
+		for (unsigned int i = 0; i < properties.size(); i++)
 		{
-			// Also check for speed infos which started earlier but last longer
-			std::deque<SpeedInfo>::reverse_iterator next = recentspeeds.rbegin();
-			next++;
-			if (next == recentspeeds.rend())
-				break;
-			if (next->time > time)
-				break;
-			recentspeeds.pop_back();
+			if (properties[i].getFlags() & EPF_Input)
+				return true;
+		}
+		return false;
+	}
+	void Entity::recordInput()
+	{
+		// Reuse the buffer of the oldest command
+		BufferPointer command;
+		if (inputhistory.size() == INPUT_HISTORY)
+		{
+			command = inputhistory.front();
+			inputhistory.pop_front();
+			command->setPosition(0);
+		}
+		else
+			command = BufferPool::get().allocate();
+		for (unsigned int i = 0; i < properties.size(); i++)
+		{
+			if (properties[i].getFlags() & EPF_Input)
+				properties[i].write(command);
+		}
+		inputhistory.push_back(command);
+	}
+	void Entity::getInput(BufferPointer buffer)
+	{
+		buffer->write8(inputhistory.size());
+		for (unsigned int i = 0; i < inputhistory.size(); i++)
+			buffer->writeBits(*inputhistory[i].get(),
+				inputhistory[i]->getPosition());
+	}
+
+	void Entity::addSnapshot(int time, const Vector2F &position)
+	{
+		// Updates can arrive out of order, keep the buffer sorted
+		std::deque<PositionSnapshot>::iterator it = snapshots.end();
+		while (it != snapshots.begin() && (it - 1)->time >= time)
+			it--;
+		if (it != snapshots.end() && it->time == time)
+		{
+			it->position = position;
+			return;
 		}
+		PositionSnapshot snapshot;
+		snapshot.time = time;
+		snapshot.position = position;
+		snapshots.insert(it, snapshot);
+		if (snapshots.size() > MAX_SNAPSHOTS)
+			snapshots.pop_front();
 	}
 
 	void Entity::onChange(Property *property)
 	{
 		changed = true;
+		if (property == positionproperty)
+			Game::get().onEntityMoved(this);
 		// Callback
 		if (script->isFunction("on_changed"))
 		{
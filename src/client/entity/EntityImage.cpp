@@ -134,13 +134,13 @@ namespace backlot
 	void EntityImage::render()
 	{
 		// Check whether the image can be rendered
-		if (!texture || !visible)
+		if (!texture || !visible || !entity->isActive())
 			return;
 		// Render the image
 		glMatrixMode(GL_MODELVIEW);
 		glPushMatrix();
 		glLoadIdentity();
-		Vector2F entitypos = entity->getPosition();
+		Vector2F entitypos = entity->getRenderPosition();
 		glTranslatef(entitypos.x, entitypos.y, 0);
 		glTranslatef(position.x, position.y, depth);
 		glRotatef(rotation, 0, 0, 1);
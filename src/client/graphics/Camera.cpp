@@ -22,6 +22,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "graphics/Camera.hpp"
 #include "graphics/Graphics.hpp"
 #include "Preferences.hpp"
+#include "Engine.hpp"
 
 #include <GL/gl.h>
 
@@ -43,8 +44,16 @@ namespace backlot
 		return position;
 	}
 
+	void Camera::saveState()
+	{
+		previousposition = position;
+	}
+
 	void Camera::apply()
 	{
+		float alpha = Engine::get().getFrameAlpha();
+		Vector2F rendered = previousposition
+			+ (position - previousposition) * alpha;
 		// Set orthogonal projection
 		glMatrixMode(GL_PROJECTION);
 		glLoadIdentity();
@@ -53,7 +62,7 @@ namespace backlot
 			-(float)windowsize.y / 32 / 2, (float)windowsize.y / 32 / 2,
 			256, -256);
 		glScalef(1.0, -1.0, -1.0);
-		glTranslatef(-position.x, -position.y, 0);
+		glTranslatef(-rendered.x, -rendered.y, 0);
 		glMatrixMode(GL_MODELVIEW);
 	}
 }
@@ -21,6 +21,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "graphics/Font.hpp"
 #include "Engine.hpp"
+#include "Log.hpp"
 
 #include <iostream>
 #include <fstream>
@@ -64,7 +65,7 @@ namespace backlot
 		texture = new Texture(ETF_Linear);
 		if (!texture->load(std::string("fonts/") + name + ".png"))
 		{
-			std::cerr << "Could not load font texture." << std::endl;
+			LOG_ERROR("Could not load font texture.");
 			texture = 0;
 			return false;
 		}
@@ -74,7 +75,7 @@ namespace backlot
 			std::ios_base::in | std::ios_base::binary);
 		if (!glyphs)
 		{
-			std::cerr << "Could not load glyph info." << std::endl;
+			LOG_ERROR("Could not load glyph info.");
 			texture = 0;
 			return false;
 		}
@@ -29,10 +29,10 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Effect.hpp"
 #include "entity/EntityImage.hpp"
 #include "graphics/Decal.hpp"
+#include "Log.hpp"
 
 #include <GL/glew.h>
 #include <SDL/SDL.h>
-#include <iostream>
 #include <guichan.hpp>
 #include <guichan/opengl/openglgraphics.hpp>
 #include <guichan/opengl/openglimage.hpp>
@@ -54,7 +54,7 @@ namespace backlot
 		// Initialize SDL
 		if (SDL_Init(SDL_INIT_EVERYTHING) < 0)
 		{
-			std::cerr << "Could not initialize SDL." << std::endl;
+			LOG_ERROR("Could not initialize SDL.");
 			return false;
 		}
 		SDL_EnableUNICODE(1);
@@ -65,12 +65,14 @@ namespace backlot
 		SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8);
 		SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8);
 		SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 8);
+		// The frame rate is not limited by the game loop any more
+		SDL_GL_SetAttribute(SDL_GL_SWAP_CONTROL, 1);
 		int flags = SDL_OPENGL;
 		if (fullscreen)
 			flags |= SDL_FULLSCREEN;
 		if (SDL_SetVideoMode(width, height, 0, flags) < 0)
 		{
-			std::cerr << "Could not set video mode." << std::endl;
+			LOG_ERROR("Could not set video mode.");
 			return false;
 		}
 		SDL_WM_SetCaption("Backlot Engine", "Backlot Engine");
@@ -83,13 +85,13 @@ namespace backlot
 		GLenum status = glewInit();
 		if (status != GLEW_OK)
 		{
-			std::cerr << "Could not get OpenGL extensions: "
-				<< glewGetErrorString(status) << std::endl;
+			LOG_ERROR("Could not get OpenGL extensions: "
+				<< glewGetErrorString(status));
 			return false;
 		}
 		if (!GLEW_ARB_vertex_buffer_object)
 		{
-			std::cerr << "No VBO support available." << std::endl;
+			LOG_ERROR("No VBO support available.");
 		}
 		// Create menu system
 		imageloader = new gcn::OpenGLSDLImageLoader();
@@ -98,7 +100,7 @@ namespace backlot
 		FontPointer menufont = Font::get("menu");
 		if (menufont.isNull())
 		{
-			std::cerr << "Could not get menu font." << std::endl;
+			LOG_ERROR("Could not get menu font.");
 			return false;
 		}
 		font = new GuichanFont(menufont);
@@ -118,7 +120,7 @@ namespace backlot
 		camera = new Camera();
 		if (HUD::get().load() == false)
 		{
-			std::cerr << "Error while loading HUD." << std::endl;
+			LOG_ERROR("Error while loading HUD.");
 			return false;
 		}
 		// Initialize post processing framework
@@ -24,8 +24,8 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Preferences.hpp"
 
 #include "support/tinyxml.h"
+#include "Log.hpp"
 
-#include <iostream>
 #include <GL/gl.h>
 
 namespace backlot
@@ -74,13 +74,13 @@ namespace backlot
 		TiXmlDocument xml(filename.c_str());
 		if (!xml.LoadFile() || xml.Error())
 		{
-			std::cerr << "Could not load XML file " << name << ".xml: " << xml.ErrorDesc() << std::endl;
+			LOG_ERROR("Could not load XML file " << name << ".xml: " << xml.ErrorDesc());
 			return false;
 		}
 		TiXmlNode *node = xml.FirstChild("effect");
 		if (!node)
 		{
-			std::cerr << "Parser error: <effect> not found." << std::endl;
+			LOG_ERROR("Parser error: <effect> not found.");
 			return false;
 		}
 		TiXmlElement *root = node->ToElement();
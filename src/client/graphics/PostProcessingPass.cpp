@@ -23,8 +23,8 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Preferences.hpp"
 
 #include "support/tinyxml.h"
+#include "Log.hpp"
 
-#include <iostream>
 #include <GL/glew.h>
 
 namespace backlot
@@ -84,7 +84,7 @@ namespace backlot
 		}
 		if (psversion == ESV_None)
 		{
-			std::cerr << "No usable shader!" << std::endl;
+			LOG_ERROR("No usable shader!");
 			return false;
 		}
 		else if (psversion == ESV_ARBFP10)
@@ -99,14 +99,14 @@ namespace backlot
 			unsigned int error = glGetError();
 			if (error == GL_INVALID_OPERATION)
 			{
-				std::cout << glGetString(GL_PROGRAM_ERROR_STRING_ARB) << std::endl;
-				std::cout << "Code: \"" << pscode << "\"" << std::endl;
+				LOG_ERROR(glGetString(GL_PROGRAM_ERROR_STRING_ARB));
+				LOG_ERROR("Code: \"" << pscode << "\"");
 				return false;
 			}
 		}
 		else
 		{
-			std::cerr << "Unimplemented shader version!" << std::endl;
+			LOG_ERROR("Unimplemented shader version!");
 			return false;
 		}
 		// Load vertex shader
@@ -149,7 +149,7 @@ namespace backlot
 		}
 		if (vsversion == ESV_None)
 		{
-			std::cerr << "No usable shader!" << std::endl;
+			LOG_ERROR("No usable shader!");
 			return false;
 		}
 		else if (vsversion == ESV_ARBVP10)
@@ -164,14 +164,14 @@ namespace backlot
 			unsigned int error = glGetError();
 			if (error == GL_INVALID_OPERATION)
 			{
-				std::cout << glGetString(GL_PROGRAM_ERROR_STRING_ARB) << std::endl;
-				std::cout << "Code: \"" << vscode << "\"" << std::endl;
+				LOG_ERROR(glGetString(GL_PROGRAM_ERROR_STRING_ARB));
+				LOG_ERROR("Code: \"" << vscode << "\"");
 				return false;
 			}
 		}
 		else
 		{
-			std::cerr << "Unimplemented shader version!" << std::endl;
+			LOG_ERROR("Unimplemented shader version!");
 			return false;
 		}
 		return true;
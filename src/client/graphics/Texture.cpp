@@ -21,12 +21,12 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "graphics/Texture.hpp"
 #include "Engine.hpp"
+#include "Log.hpp"
 
 #include <GL/gl.h>
 #include <GL/glu.h>
 #include <SDL/SDL.h>
 #include <SDL/SDL_image.h>
-#include <iostream>
 
 namespace backlot
 {
@@ -115,7 +115,7 @@ namespace backlot
 		SDL_Surface *surface = IMG_Load(path.c_str());
 		if (!surface)
 		{
-			std::cerr << "Can't load image \"" << path <<"\". Does it exist?\n";
+			LOG_ERROR("Can't load image \"" << path <<"\". Does it exist?");
 			return false;
 		}
 		SDL_PixelFormat *format = surface->format;
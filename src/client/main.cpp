@@ -20,8 +20,8 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
 #include "Engine.hpp"
+#include "Log.hpp"
 
-#include <iostream>
 #include <luabind/luabind.hpp>
 #include <guichan/exception.hpp>
 
@@ -30,7 +30,7 @@ int main(int argc, char **argv)
 	// Parse arguments
 	if (argc == 1)
 	{
-		std::cerr << "Error: No game directory given." << std::endl;
+		LOG_ERROR("No game directory given.");
 		return -1;
 	}
 	std::vector<std::string> args;
@@ -41,27 +41,27 @@ int main(int argc, char **argv)
 	{
 		if (!backlot::Engine::get().run(argv[1], args))
 		{
-			std::cerr << "Completed with errors." << std::endl;
+			LOG_ERROR("Completed with errors.");
 			return -1;
 		}
 	}
 	catch (luabind::error &e)
 	{
 		lua_State *state = e.state();
-		std::cerr << "Script exception: " << e.what() << std::endl;
+		LOG_ERROR("Script exception: " << e.what());
 		if (lua_isstring(state, -1))
 		{
-			std::cerr << lua_tostring(state, -1) << std::endl;
+			LOG_ERROR(lua_tostring(state, -1));
 		}
 		else
 		{
-			std::cerr << "No valid error message!" << std::endl;
+			LOG_ERROR("No valid error message!");
 		}
 		return -1;
 	}
 	catch (gcn::Exception &e)
 	{
-		std::cerr << "Guichan exception: " << e.getMessage() << std::endl;
+		LOG_ERROR("Guichan exception: " << e.getMessage());
 		return -1;
 	}
 	return 0;
@@ -28,8 +28,8 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "menu/ListModel.hpp"
 
 #include "support/tinyxml.h"
+#include "Log.hpp"
 
-#include <iostream>
 #include <guichan/widgets/window.hpp>
 #include <guichan/widgets/button.hpp>
 #include <guichan/widgets/tabbedarea.hpp>
@@ -93,20 +93,20 @@ namespace backlot
 		TiXmlDocument xml(filename.c_str());
 		if (!xml.LoadFile() || xml.Error())
 		{
-			std::cerr << "Could not load XML file " << name << ".xml: " << xml.ErrorDesc() << std::endl;
+			LOG_ERROR("Could not load XML file " << name << ".xml: " << xml.ErrorDesc());
 			return false;
 		}
 		TiXmlNode *node = xml.FirstChild("dialog");
 		if (!node)
 		{
-			std::cerr << "Parser error: <dialog> not found." << std::endl;
+			LOG_ERROR("Parser error: <dialog> not found.");
 			return false;
 		}
 		TiXmlElement *root = node->ToElement();
 		// Create window
 		if (!root->Attribute("size") || !root->Attribute("title"))
 		{
-			std::cerr << "No dialog size or title given." << std::endl;
+			LOG_ERROR("No dialog size or title given.");
 			return false;
 		}
 		Vector2I size = root->Attribute("size");
@@ -192,7 +192,7 @@ namespace backlot
 	void Dialog::injectAction(const gcn::ActionEvent &event)
 	{
 		std::string idstr = event.getSource()->getId();
-		std::cout << "\"" << idstr << "\": action received." << std::endl;
+		LOG_INFO("\"" << idstr << "\": action received.");
 		if (idstr == "")
 			return;
 		// Call event handler
@@ -214,7 +214,7 @@ namespace backlot
 				// Check attributes
 				if (!tabctrldata->Attribute("size") || !tabctrldata->Attribute("position"))
 				{
-					std::cerr << "Tab control size or position missing." << std::endl;
+					LOG_ERROR("Tab control size or position missing.");
 					return false;
 				}
 				// Create tab area
@@ -239,12 +239,12 @@ namespace backlot
 				// Check attributes
 				if (!buttondata->Attribute("size") || !buttondata->Attribute("position"))
 				{
-					std::cerr << "Button size or position missing." << std::endl;
+					LOG_ERROR("Button size or position missing.");
 					return false;
 				}
 				if (!buttondata->Attribute("id") || !buttondata->Attribute("label"))
 				{
-					std::cerr << "Button id or label missing." << std::endl;
+					LOG_ERROR("Button id or label missing.");
 					return false;
 				}
 				// Create button
@@ -274,7 +274,7 @@ namespace backlot
 				// Check attributes
 				if (!textfielddata->Attribute("size") || !textfielddata->Attribute("position"))
 				{
-					std::cerr << "Textfield size or position missing." << std::endl;
+					LOG_ERROR("Textfield size or position missing.");
 					return false;
 				}
 				// Create textfield
@@ -300,12 +300,12 @@ namespace backlot
 				// Check attributes
 				if (!labeldata->Attribute("size") || !labeldata->Attribute("position"))
 				{
-					std::cerr << "Label size or position missing." << std::endl;
+					LOG_ERROR("Label size or position missing.");
 					return false;
 				}
 				if (!labeldata->Attribute("text"))
 				{
-					std::cerr << "Label text missing." << std::endl;
+					LOG_ERROR("Label text missing.");
 					return false;
 				}
 				// Create label
@@ -330,12 +330,12 @@ namespace backlot
 				// Check attributes
 				if (!checkboxdata->Attribute("size") || !checkboxdata->Attribute("position"))
 				{
-					std::cerr << "Checkbox size or position missing." << std::endl;
+					LOG_ERROR("Checkbox size or position missing.");
 					return false;
 				}
 				if (!checkboxdata->Attribute("label"))
 				{
-					std::cerr << "Checkbox label missing." << std::endl;
+					LOG_ERROR("Checkbox label missing.");
 					return false;
 				}
 				// Create checkbox
@@ -361,7 +361,7 @@ namespace backlot
 			// Check attributes
 			if (!dropdowndata->Attribute("size") || !dropdowndata->Attribute("position"))
 			{
-				std::cerr << "Drop down size or position missing." << std::endl;
+				LOG_ERROR("Drop down size or position missing.");
 				return false;
 			}
 			// Parse the elements for the drop down menu
@@ -375,7 +375,7 @@ namespace backlot
 					listmodel->addElement(elementdata->Attribute("text"));
 				else
 				{
-					std::cerr << "Element text missing." << std::endl;
+					LOG_ERROR("Element text missing.");
 					return false;
 				}
 				elementnode = dropdownnode->IterateChildren("element", elementnode);
@@ -407,7 +407,7 @@ namespace backlot
 				// Check attributes
 				if (!tabdata->Attribute("label"))
 				{
-					std::cerr << "Tab label missing." << std::endl;
+					LOG_ERROR("Tab label missing.");
 					return false;
 				}
 				// Create tab
@@ -27,9 +27,9 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "menu/InputReceiver.hpp"
 
 #include "support/tinyxml.h"
+#include "Log.hpp"
 
 #include <GL/gl.h>
-#include <iostream>
 #include <guichan/widgets/button.hpp>
 #include <guichan/widgets/container.hpp>
 
@@ -86,13 +86,13 @@ namespace backlot
 		TiXmlDocument xml(filename.c_str());
 		if (!xml.LoadFile() || xml.Error())
 		{
-			std::cerr << "Could not load XML file " << name << ".xml: " << xml.ErrorDesc() << std::endl;
+			LOG_ERROR("Could not load XML file " << name << ".xml: " << xml.ErrorDesc());
 			return false;
 		}
 		TiXmlNode *node = xml.FirstChild("menu");
 		if (!node)
 		{
-			std::cerr << "Parser error: <menu> not found." << std::endl;
+			LOG_ERROR("Parser error: <menu> not found.");
 			return false;
 		}
 		TiXmlElement *root = node->ToElement();
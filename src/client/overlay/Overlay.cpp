@@ -21,8 +21,8 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "overlay/Overlay.hpp"
 #include "Engine.hpp"
+#include "Log.hpp"
 
-#include <iostream>
 #include <guichan/widgets/label.hpp>
 
 namespace backlot
@@ -58,7 +58,7 @@ namespace backlot
 		TiXmlDocument doc(fullpath.c_str());
 		if(!doc.LoadFile())
 		{
-			std::cerr << "Could not find overlay file " << fullpath << std::endl;
+			LOG_ERROR("Could not find overlay file " << fullpath);
 			return false;
 		}
 		TiXmlNode *xmlroot;
@@ -66,13 +66,13 @@ namespace backlot
 		TiXmlElement *xmlelement;
 		if((xmlroot = doc.FirstChild("overlay")))
 		{
-			std::cerr << "Could not find <overlay> in " << fullpath << std::endl;
+			LOG_ERROR("Could not find <overlay> in " << fullpath);
 			return false;
 		}
 		xmlelement = xmlroot->ToElement();
 		if(!xmlelement->Attribute("name"))
 		{
-			std::cerr << "Could not find \"name\" for <overlay> in overlay file " << fullpath << std::endl;
+			LOG_ERROR("Could not find \"name\" for <overlay> in overlay file " << fullpath);
 			return false;
 		}
 		name = xmlelement->Attribute("name");
@@ -85,7 +85,7 @@ namespace backlot
 			{
 				if(!xmlelement->Attribute("name"))
 				{
-					std::cerr << "Could not find \"name\" for <group> in overlay file " << fullpath << std::endl;
+					LOG_ERROR("Could not find \"name\" for <group> in overlay file " << fullpath);
 					return false;
 				}
 				// Instantiate new group
@@ -93,7 +93,7 @@ namespace backlot
 				// Load group from node
 				if(!groups[xmlelement->Attribute("name")]->load(xmlnode))
 				{
-					std::cout << "Error on loading overlay group from " << fullpath << std::endl;
+					LOG_ERROR("Error on loading overlay group from " << fullpath);
 					return false;
 				}
 			}
@@ -21,8 +21,8 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "overlay/OverlayGroup.hpp"
 #include "overlay/OverlayImage.hpp"
+#include "Log.hpp"
 
-#include <iostream>
 
 namespace backlot
 {
@@ -49,17 +49,17 @@ namespace backlot
 				// Check for attributes
 				if(!itemelement->Attribute("name"))
 				{
-					std::cerr << "No \"name\" found in <image>" << std::endl;
+					LOG_ERROR("No \"name\" found in <image>");
 					return false;
 				}
 				if(!itemelement->Attribute("offset") || !itemelement->Attribute("size"))
 				{
-					std::cerr << "No \"offset\" and/or \"size\" found in <image>" << std::endl;
+					LOG_ERROR("No \"offset\" and/or \"size\" found in <image>");
 					return false;
 				}
 				if(!itemelement->Attribute("image-path") || !itemelement->Attribute("texture-size"))
 				{
-					std::cerr << "No \"image-path\" and/or \"texture-size\" found in <image>" << std::endl;
+					LOG_ERROR("No \"image-path\" and/or \"texture-size\" found in <image>");
 					return false;
 				}
 				// Instantiate new OverlayItem object
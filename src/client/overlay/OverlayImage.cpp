@@ -21,8 +21,8 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "overlay/OverlayImage.hpp"
 #include "Preferences.hpp"
+#include "Log.hpp"
 
-#include <iostream>
 #include <GL/gl.h>
 
 namespace backlot
@@ -64,7 +64,7 @@ namespace backlot
 		{
 			if(!texture->load(imagepath))
 			{
-				std::cerr << "Failed to load texture for OverlayImage from " << imagepath << std::endl;
+				LOG_ERROR("Failed to load texture for OverlayImage from " << imagepath);
 				return false;
 			}
 			texturesize = size;
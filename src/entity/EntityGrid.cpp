@@ -0,0 +1,268 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "entity/EntityGrid.hpp"
+
+#include <cmath>
+
+namespace backlot
+{
+	static bool touches(const RectangleF &a, const RectangleF &b)
+	{
+		return a.x <= b.x + b.width && b.x <= a.x + a.width
+			&& a.y <= b.y + b.height && b.y <= a.y + a.height;
+	}
+	static float getDistanceSquared(const Vector2F &point,
+		const RectangleF &rectangle)
+	{
+		float dx = 0;
+		if (point.x < rectangle.x)
+			dx = rectangle.x - point.x;
+		else if (point.x > rectangle.x + rectangle.width)
+			dx = point.x - rectangle.x - rectangle.width;
+		float dy = 0;
+		if (point.y < rectangle.y)
+			dy = rectangle.y - point.y;
+		else if (point.y > rectangle.y + rectangle.height)
+			dy = point.y - rectangle.y - rectangle.height;
+		return dx * dx + dy * dy;
+	}
+
+	EntityGrid::EntityGrid(float cellsize)
+		: cellsize(cellsize), maxextent(0), count(0)
+	{
+	}
+	EntityGrid::~EntityGrid()
+	{
+	}
+
+	void EntityGrid::clear()
+	{
+		for (unsigned int i = 0; i < BUCKET_COUNT; i++)
+			buckets[i].clear();
+		entries.clear();
+		maxextent = 0;
+		count = 0;
+	}
+
+	void EntityGrid::update(int id, const RectangleF &rectangle)
+	{
+		if (id < 0)
+			return;
+		if ((unsigned int)id >= entries.size())
+		{
+			Entry empty;
+			empty.cellx = 0;
+			empty.celly = 0;
+			empty.slot = 0;
+			empty.used = false;
+			entries.resize(id + 1, empty);
+		}
+		if (rectangle.width > maxextent)
+			maxextent = rectangle.width;
+		if (rectangle.height > maxextent)
+			maxextent = rectangle.height;
+		Entry &entry = entries[id];
+		entry.rectangle = rectangle;
+		int cellx = getCell(rectangle.x);
+		int celly = getCell(rectangle.y);
+		if (entry.used)
+		{
+			// Most updates do not leave the cell
+			if (entry.cellx == cellx && entry.celly == celly)
+				return;
+			removeFromBucket(id);
+		}
+		else
+		{
+			entry.used = true;
+			count++;
+		}
+		entry.cellx = cellx;
+		entry.celly = celly;
+		std::vector<int> &bucket = buckets[getBucket(cellx, celly)];
+		entry.slot = bucket.size();
+		bucket.push_back(id);
+	}
+	void EntityGrid::remove(int id)
+	{
+		if (id < 0 || (unsigned int)id >= entries.size())
+			return;
+		if (!entries[id].used)
+			return;
+		removeFromBucket(id);
+		entries[id].used = false;
+		count--;
+	}
+
+	void EntityGrid::query(const RectangleF &area, std::vector<int> &result)
+	{
+		result.clear();
+		if (count == 0)
+			return;
+		int minx = getCell(area.x - maxextent);
+		int miny = getCell(area.y - maxextent);
+		int maxx = getCell(area.x + area.width);
+		int maxy = getCell(area.y + area.height);
+		// Large areas cover every bucket anyway, look at each only once
+		if ((double)(maxx - minx + 1) * (maxy - miny + 1) > BUCKET_COUNT)
+		{
+			for (unsigned int i = 0; i < BUCKET_COUNT; i++)
+			{
+				for (unsigned int j = 0; j < buckets[i].size(); j++)
+				{
+					int id = buckets[i][j];
+					if (touches(entries[id].rectangle, area))
+						result.push_back(id);
+				}
+			}
+			return;
+		}
+		for (int y = miny; y <= maxy; y++)
+		{
+			for (int x = minx; x <= maxx; x++)
+			{
+				const std::vector<int> &bucket = buckets[getBucket(x, y)];
+				for (unsigned int i = 0; i < bucket.size(); i++)
+				{
+					// Other cells can share the bucket, only take the entries
+					// of this cell so that none is returned twice
+					const Entry &entry = entries[bucket[i]];
+					if (entry.cellx != x || entry.celly != y)
+						continue;
+					if (touches(entry.rectangle, area))
+						result.push_back(bucket[i]);
+				}
+			}
+		}
+	}
+	void EntityGrid::queryRadius(const Vector2F &center, float radius,
+		std::vector<int> &result)
+	{
+		query(RectangleF(center.x - radius, center.y - radius,
+			radius * 2, radius * 2), result);
+		float radiussquared = radius * radius;
+		unsigned int kept = 0;
+		for (unsigned int i = 0; i < result.size(); i++)
+		{
+			if (getDistanceSquared(center, entries[result[i]].rectangle)
+				<= radiussquared)
+				result[kept++] = result[i];
+		}
+		result.resize(kept);
+	}
+	int EntityGrid::getNearest(const Vector2F &position, float maxdistance,
+		Filter *filter)
+	{
+		if (count == 0)
+			return -1;
+		int best = -1;
+		float bestdistance = maxdistance * maxdistance;
+		int cellx = getCell(position.x);
+		int celly = getCell(position.y);
+		for (int ring = 0; ; ring++)
+		{
+			// Entries in this ring start at least ring - 1 cells away but
+			// might reach maxextent towards the position
+			float mindistance = (ring - 1) * cellsize - maxextent;
+			if (mindistance > 0 && mindistance * mindistance > bestdistance)
+				break;
+			// Searching too far out, look at everything once instead
+			if ((double)(2 * ring + 1) * (2 * ring + 1) > BUCKET_COUNT)
+			{
+				for (unsigned int i = 0; i < entries.size(); i++)
+				{
+					if (!entries[i].used)
+						continue;
+					float distance = getDistanceSquared(position,
+						entries[i].rectangle);
+					if (distance > bestdistance)
+						continue;
+					if (filter && !filter->accept(i))
+						continue;
+					bestdistance = distance;
+					best = i;
+				}
+				break;
+			}
+			if (ring == 0)
+			{
+				visitNearest(cellx, celly, position, bestdistance, best,
+					filter);
+				continue;
+			}
+			for (int x = cellx - ring; x <= cellx + ring; x++)
+			{
+				visitNearest(x, celly - ring, position, bestdistance, best,
+					filter);
+				visitNearest(x, celly + ring, position, bestdistance, best,
+					filter);
+			}
+			for (int y = celly - ring + 1; y <= celly + ring - 1; y++)
+			{
+				visitNearest(cellx - ring, y, position, bestdistance, best,
+					filter);
+				visitNearest(cellx + ring, y, position, bestdistance, best,
+					filter);
+			}
+		}
+		return best;
+	}
+
+	int EntityGrid::getCell(float coordinate)
+	{
+		float cell = floorf(coordinate / cellsize);
+		// Keep huge query areas from overflowing
+		if (cell < -1000000.0f)
+			return -1000000;
+		if (cell > 1000000.0f)
+			return 1000000;
+		return (int)cell;
+	}
+	void EntityGrid::removeFromBucket(int id)
+	{
+		Entry &entry = entries[id];
+		std::vector<int> &bucket = buckets[getBucket(entry.cellx, entry.celly)];
+		int last = bucket.back();
+		bucket[entry.slot] = last;
+		entries[last].slot = entry.slot;
+		bucket.pop_back();
+	}
+	void EntityGrid::visitNearest(int cellx, int celly,
+		const Vector2F &position, float &bestdistance, int &best,
+		Filter *filter)
+	{
+		const std::vector<int> &bucket = buckets[getBucket(cellx, celly)];
+		for (unsigned int i = 0; i < bucket.size(); i++)
+		{
+			const Entry &entry = entries[bucket[i]];
+			if (entry.cellx != cellx || entry.celly != celly)
+				continue;
+			float distance = getDistanceSquared(position, entry.rectangle);
+			if (distance > bestdistance)
+				continue;
+			if (filter && !filter->accept(bucket[i]))
+				continue;
+			bestdistance = distance;
+			best = bucket[i];
+		}
+	}
+}
@@ -0,0 +1,118 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "entity/EntityTable.hpp"
+
+namespace backlot
+{
+	EntityTable::EntityTable()
+	{
+		nextid = 0;
+	}
+	EntityTable::~EntityTable()
+	{
+	}
+
+	void EntityTable::clear()
+	{
+		for (unsigned int i = 0; i < live.size(); i++)
+			entities[live[i]->getID()] = 0;
+		live.clear();
+		owned.clear();
+		while (!freeids.empty())
+			freeids.pop();
+		nextid = 0;
+	}
+
+	int EntityTable::allocateID()
+	{
+		// Reuse the ID which was released first
+		if (!freeids.empty())
+		{
+			int id = freeids.front();
+			freeids.pop();
+			return id;
+		}
+		if (nextid == MAX_ENTITIES)
+			return -1;
+		return nextid++;
+	}
+	void EntityTable::releaseID(int id)
+	{
+		freeids.push(id);
+	}
+
+	void EntityTable::insert(EntityPointer entity)
+	{
+		int id = entity->getID();
+		if (id < 0 || id >= MAX_ENTITIES)
+			return;
+		if (entities[id])
+			remove(id);
+		entities[id] = entity;
+		// Append to the packed list of live entities
+		liveindex[id] = live.size();
+		live.push_back(entity);
+		// Append to the owner's list
+		std::vector<EntityPointer> &ownerlist = owned[entity->getOwner()];
+		ownerindex[id] = ownerlist.size();
+		ownerlist.push_back(entity);
+	}
+	void EntityTable::remove(int id)
+	{
+		if (id < 0 || id >= MAX_ENTITIES)
+			return;
+		EntityPointer entity = entities[id];
+		if (!entity)
+			return;
+		entities[id] = 0;
+		// Move the last live entity into the free slot
+		unsigned int index = liveindex[id];
+		if (index != live.size() - 1)
+		{
+			live[index] = live.back();
+			liveindex[live[index]->getID()] = index;
+		}
+		live.pop_back();
+		// Same for the owner's list
+		std::map<int, std::vector<EntityPointer> >::iterator it = owned.find(entity->getOwner());
+		std::vector<EntityPointer> &ownerlist = it->second;
+		index = ownerindex[id];
+		if (index != ownerlist.size() - 1)
+		{
+			ownerlist[index] = ownerlist.back();
+			ownerindex[ownerlist[index]->getID()] = index;
+		}
+		ownerlist.pop_back();
+		if (ownerlist.size() == 0)
+			owned.erase(it);
+	}
+
+	const std::vector<EntityPointer> &EntityTable::getOwnedEntities(int owner)
+	{
+		std::map<int, std::vector<EntityPointer> >::iterator it = owned.find(owner);
+		if (it == owned.end())
+			return noentities;
+		return it->second;
+	}
+
+	std::vector<EntityPointer> EntityTable::noentities;
+}
@@ -23,12 +23,16 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Engine.hpp"
 
 #include "support/tinyxml.h"
+#include "Log.hpp"
 
 #include <iostream>
 #include <fstream>
+#include <pthread.h>
 
 namespace backlot
 {
+	static pthread_mutex_t templatemutex = PTHREAD_MUTEX_INITIALIZER;
+
 	EntityTemplate::EntityTemplate() : ReferenceCounted()
 	{
 	}
@@ -37,28 +41,38 @@ namespace backlot
 		if (name != "")
 		{
 			// Remove from loaded templates
+			pthread_mutex_lock(&templatemutex);
 			std::map<std::string, EntityTemplate*>::iterator it = templates.find(name);
 			if (it != templates.end())
 			{
 				templates.erase(it);
 			}
+			pthread_mutex_unlock(&templatemutex);
 		}
 	}
 
 	SharedPointer<EntityTemplate> EntityTemplate::get(std::string name)
 	{
 		// Get already loaded template
+		pthread_mutex_lock(&templatemutex);
 		std::map<std::string, EntityTemplate*>::iterator it = templates.find(name);
 		if (it != templates.end())
 		{
-			return it->second;
+			EntityTemplatePointer tpl = it->second;
+			pthread_mutex_unlock(&templatemutex);
+			return tpl;
 		}
-		// Load map
+		// Load template
 		EntityTemplatePointer tpl = new EntityTemplate();
 		if (!tpl->load(name))
 		{
+			pthread_mutex_unlock(&templatemutex);
 			return 0;
 		}
+		// Templates stay loaded, otherwise one thread could get a template
+		// another one is just deleting
+		tpl->grab();
+		pthread_mutex_unlock(&templatemutex);
 		return tpl;
 	}
 
@@ -69,13 +83,13 @@ namespace backlot
 		TiXmlDocument xml(filename.c_str());
 		if (!xml.LoadFile() || xml.Error())
 		{
-			std::cerr << "Could not load XML file " << name << ".xml: " << xml.ErrorDesc() << std::endl;
+			LOG_ERROR("Could not load XML file " << name << ".xml: " << xml.ErrorDesc());
 			return false;
 		}
 		TiXmlNode *node = xml.FirstChild("entity");
 		if (!node)
 		{
-			std::cerr << "Parser error: <entity> not found." << std::endl;
+			LOG_ERROR("Parser error: <entity> not found.");
 			return false;
 		}
 		TiXmlElement *root = node->ToElement();
@@ -105,7 +119,7 @@ namespace backlot
 		}
 		if (!properties)
 		{
-			std::cerr << "Parser error: <properties> not found." << std::endl;
+			LOG_ERROR("Parser error: <properties> not found.");
 			return false;
 		}
 		TiXmlNode *propertynode = properties->FirstChild();
@@ -120,7 +134,7 @@ namespace backlot
 				const char *typestr = property->Attribute("type");
 				if (!typestr)
 				{
-					std::cerr << "Property " << propname << " does not have any type!" << std::endl;
+					LOG_ERROR("Property " << propname << " does not have any type!");
 					return false;
 				}
 				if (!strcmp(typestr, "int") || !strcmp(typestr, "uint"))
@@ -158,6 +172,11 @@ namespace backlot
 					if (!strcmp(property->Attribute("unlocked"), "yes"))
 						flags |= EPF_Unlocked;
 				}
+				if (property->Attribute("input"))
+				{
+					if (!strcmp(property->Attribute("input"), "yes"))
+						flags |= EPF_Unlocked | EPF_Input;
+				}
 				if (property->Attribute("updatelocally"))
 				{
 					if (strcmp(property->Attribute("updatelocally"), "yes"))
@@ -168,6 +187,53 @@ namespace backlot
 				Property &newprop = this->properties[this->properties.size() - 1];
 				newprop.setSize(size);
 				newprop.setFlags((PropertyFlags)flags);
+				// Variable-length integer encodings
+				if (property->Attribute("encoding"))
+				{
+					const char *encoding = property->Attribute("encoding");
+					int order = 0;
+					if (property->Attribute("order"))
+						property->Attribute("order", &order);
+					if (order < 0 || order > 31)
+						order = 0;
+					if (!strcmp(encoding, "varint"))
+						newprop.setEncoding(EPE_VarInt);
+					else if (!strcmp(encoding, "zigzag"))
+						newprop.setEncoding(EPE_ZigZag);
+					else if (!strcmp(encoding, "gamma"))
+						newprop.setEncoding(EPE_ExpGolomb, 0);
+					else if (!strcmp(encoding, "expgolomb"))
+						newprop.setEncoding(EPE_ExpGolomb, order);
+					else if (strcmp(encoding, "fixed"))
+						LOG_WARNING("Property " << propname
+							<< ": Unknown encoding \"" << encoding << "\".");
+				}
+				// Fixed-point encoding for floats, either with an explicit
+				// precision or with the given number of bits
+				if ((type == EPT_Float || type == EPT_Vector2F)
+					&& property->Attribute("min") && property->Attribute("max"))
+				{
+					double min = 0;
+					double max = 0;
+					property->Attribute("min", &min);
+					property->Attribute("max", &max);
+					unsigned int bits = 0;
+					if (property->Attribute("precision"))
+					{
+						double precision = 0;
+						property->Attribute("precision", &precision);
+						if (precision > 0)
+						{
+							bits = 1;
+							while (bits < 24 && ((1 << bits) - 1) * precision
+								< max - min)
+								bits++;
+						}
+					}
+					else if (property->Attribute("size"))
+						bits = size;
+					newprop.setQuantization(min, max, bits);
+				}
 				if (property->Attribute("default"))
 					newprop.set(property->Attribute("default"));
 			}
@@ -198,8 +264,8 @@ namespace backlot
 					}
 					else
 					{
-						std::cout << "Warning: Script file \"" << filename
-							<< "\" not found." << std::endl;
+						LOG_WARNING("Script file \"" << filename
+							<< "\" not found.");
 					}
 				}
 				else
@@ -274,7 +340,7 @@ namespace backlot
 				// Image name
 				if (!animdata->Attribute("image"))
 				{
-					std::cerr << "Animation without image!" << std::endl;
+					LOG_ERROR("Animation without image!");
 					return false;
 				}
 				std::string animimage = animdata->Attribute("image");
@@ -289,7 +355,7 @@ namespace backlot
 				}
 				if (!imageinfo)
 				{
-					std::cerr << "Image \"" << animimage << "\" not found." << std::endl;
+					LOG_ERROR("Image \"" << animimage << "\" not found.");
 					return false;
 				}
 				imageinfo->animation = true;
@@ -304,7 +370,7 @@ namespace backlot
 					imageinfo->animationrunning = strcmp(animdata->Attribute("stopped"), "yes");
 				if (!animdata->Attribute("size"))
 				{
-					std::cerr << "Animation without size!" << std::endl;
+					LOG_ERROR("Animation without size!");
 					return false;
 				}
 				imageinfo->animationsize = animdata->Attribute("size");
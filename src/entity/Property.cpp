@@ -22,9 +22,9 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "entity/Property.hpp"
 #include "entity/Entity.hpp"
 #include "Game.hpp"
+#include "Log.hpp"
 
 #include <cstring>
-#include <iostream>
 
 namespace backlot
 {
@@ -33,6 +33,11 @@ namespace backlot
 		type = EPT_Integer;
 		flags = EPF_None;
 		size = 32;
+		encoding = EPE_Fixed;
+		encodingorder = 0;
+		minimum = 0;
+		maximum = 0;
+		quantizationbits = 0;
 		memset(data, 0, 8);
 		entity = 0;
 		callbacks = true;
@@ -42,6 +47,11 @@ namespace backlot
 		PropertyFlags flags) : name(name), type(type), flags(flags)
 	{
 		size = 32;
+		encoding = EPE_Fixed;
+		encodingorder = 0;
+		minimum = 0;
+		maximum = 0;
+		quantizationbits = 0;
 		memset(data, 0, 8);
 		entity = 0;
 		callbacks = true;
@@ -53,6 +63,11 @@ namespace backlot
 		type = property.type;
 		flags = property.flags;
 		size = property.size;
+		encoding = property.encoding;
+		encodingorder = property.encodingorder;
+		minimum = property.minimum;
+		maximum = property.maximum;
+		quantizationbits = property.quantizationbits;
 		memcpy(data, property.data, 8);
 		entity = 0;
 		callbacks = true;
@@ -96,6 +111,41 @@ namespace backlot
 	{
 		return size;
 	}
+	void Property::setEncoding(PropertyEncoding encoding, unsigned int order)
+	{
+		this->encoding = encoding;
+		encodingorder = order;
+	}
+	PropertyEncoding Property::getEncoding() const
+	{
+		return encoding;
+	}
+	unsigned int Property::getEncodingOrder() const
+	{
+		return encodingorder;
+	}
+	void Property::setQuantization(float min, float max, unsigned int bits)
+	{
+		if (bits > 24)
+			bits = 24;
+		if (max <= min)
+			bits = 0;
+		minimum = min;
+		maximum = max;
+		quantizationbits = bits;
+	}
+	unsigned int Property::getQuantizationBits() const
+	{
+		return quantizationbits;
+	}
+	float Property::getMinimum() const
+	{
+		return minimum;
+	}
+	float Property::getMaximum() const
+	{
+		return maximum;
+	}
 
 	void Property::setEntity(Entity *entity)
 	{
@@ -122,7 +172,7 @@ namespace backlot
 			onChange();
 		}
 		else
-			std::cerr << "Warning: Wrong property type (" << name << ")." << std::endl;
+			LOG_WARNING("Wrong property type (" << name << ").");
 	}
 	int Property::getInt() const
 	{
@@ -132,7 +182,7 @@ namespace backlot
 		}
 		else
 		{
-			std::cerr << "Warning: Wrong property type (" << name << ")." << std::endl;
+			LOG_WARNING("Wrong property type (" << name << ").");
 			return 0;
 		}
 	}
@@ -144,7 +194,7 @@ namespace backlot
 			onChange();
 		}
 		else
-			std::cerr << "Warning: Wrong property type (" << name << ")." << std::endl;
+			LOG_WARNING("Wrong property type (" << name << ").");
 	}
 	unsigned int Property::getUnsignedInt() const
 	{
@@ -154,7 +204,7 @@ namespace backlot
 		}
 		else
 		{
-			std::cerr << "Warning: Wrong property type (" << name << ")." << std::endl;
+			LOG_WARNING("Wrong property type (" << name << ").");
 			return 0;
 		}
 	}
@@ -166,7 +216,7 @@ namespace backlot
 			onChange();
 		}
 		else
-			std::cerr << "Warning: Wrong property type (" << name << ")." << std::endl;
+			LOG_WARNING("Wrong property type (" << name << ").");
 	}
 	float Property::getFloat() const
 	{
@@ -176,7 +226,7 @@ namespace backlot
 		}
 		else
 		{
-			std::cerr << "Warning: Wrong property type (" << name << ")." << std::endl;
+			LOG_WARNING("Wrong property type (" << name << ").");
 			return 0;
 		}
 	}
@@ -189,7 +239,7 @@ namespace backlot
 			onChange();
 		}
 		else
-			std::cerr << "Warning: Wrong property type (" << name << ")." << std::endl;
+			LOG_WARNING("Wrong property type (" << name << ").");
 	}
 	Vector2F Property::getVector2F() const
 	{
@@ -199,7 +249,7 @@ namespace backlot
 		}
 		else
 		{
-			std::cerr << "Warning: Wrong property type (" << name << ")." << std::endl;
+			LOG_WARNING("Wrong property type (" << name << ").");
 			return Vector2F();
 		}
 	}
@@ -212,7 +262,7 @@ namespace backlot
 			onChange();
 		}
 		else
-			std::cerr << "Warning: Wrong property type (" << name << ")." << std::endl;
+			LOG_WARNING("Wrong property type (" << name << ").");
 	}
 	Vector2I Property::getVector2I() const
 	{
@@ -222,7 +272,7 @@ namespace backlot
 		}
 		else
 		{
-			std::cerr << "Warning: Wrong property type (" << name << ")." << std::endl;
+			LOG_WARNING("Wrong property type (" << name << ").");
 			return Vector2I();
 		}
 	}
@@ -242,7 +292,7 @@ namespace backlot
 			onChange();
 		}
 		else
-			std::cerr << "Warning: Wrong property type (" << name << ")." << std::endl;
+			LOG_WARNING("Wrong property type (" << name << ").");
 	}
 	std::string Property::getString()
 	{
@@ -252,7 +302,7 @@ namespace backlot
 		}
 		else
 		{
-			std::cerr << "Warning: Wrong property type (" << name << ")." << std::endl;
+			LOG_WARNING("Wrong property type (" << name << ").");
 			return "";
 		}
 	}
@@ -265,7 +315,7 @@ namespace backlot
 		}
 		else
 		{
-			std::cerr << "Warning: Wrong property type (" << name << ")." << std::endl;
+			LOG_WARNING("Wrong property type (" << name << ").");
 			return 0;
 		}
 	}
@@ -280,7 +330,7 @@ namespace backlot
 			onChange();
 		}
 		else
-			std::cerr << "Warning: Wrong property type (" << name << ")." << std::endl;
+			LOG_WARNING("Wrong property type (" << name << ").");
 	}
 
 	void Property::set(std::string s)
@@ -311,24 +361,23 @@ namespace backlot
 		switch (type)
 		{
 			case EPT_Integer:
-				// TODO: Unsigned integer
-				buffer->writeInt(getInt(), size);
+				writeInteger(buffer, getInt());
 				break;
 			case EPT_Float:
-				buffer->writeFloat(getFloat());
+				writeFloat(buffer, getFloat());
 				break;
 			case EPT_Vector2F:
 			{
 				Vector2F vector = getVector2F();
-				buffer->writeFloat(vector.x);
-				buffer->writeFloat(vector.y);
+				writeFloat(buffer, vector.x);
+				writeFloat(buffer, vector.y);
 				break;
 			}
 			case EPT_Vector2I:
 			{
 				Vector2I vector = getVector2I();
-				buffer->writeInt(vector.x, size);
-				buffer->writeInt(vector.y, size);
+				writeInteger(buffer, vector.x);
+				writeInteger(buffer, vector.y);
 				break;
 			}
 			case EPT_String:
@@ -341,22 +390,22 @@ namespace backlot
 		switch (type)
 		{
 			case EPT_Integer:
-				setInt(buffer->readInt(size));
+				setInt(readInteger(buffer));
 				break;
 			case EPT_Float:
-				setFloat(buffer->readFloat());
+				setFloat(readFloat(buffer));
 				break;
 			case EPT_Vector2F:
 			{
-				float x = buffer->readFloat();
-				float y = buffer->readFloat();
+				float x = readFloat(buffer);
+				float y = readFloat(buffer);
 				setVector2F(Vector2F(x, y));
 				break;
 			}
 			case EPT_Vector2I:
 			{
-				int x = buffer->readInt(size);
-				int y = buffer->readInt(size);
+				int x = readInteger(buffer);
+				int y = readInteger(buffer);
 				setVector2I(Vector2I(x, y));
 				break;
 			}
@@ -370,6 +419,10 @@ namespace backlot
 	{
 		return changetime;
 	}
+	void Property::touch()
+	{
+		changetime = Game::get().getTime();
+	}
 
 	Property &Property::operator=(const Property &property)
 	{
@@ -379,6 +432,11 @@ namespace backlot
 			type = property.type;
 			flags = property.flags;
 			size = property.size;
+			encoding = property.encoding;
+			encodingorder = property.encodingorder;
+			minimum = property.minimum;
+			maximum = property.maximum;
+			quantizationbits = property.quantizationbits;
 			memcpy(data, property.data, 8);
 		}
 		else if (type == property.type)
@@ -407,6 +465,69 @@ namespace backlot
 		return !(*this == property);
 	}
 
+	void Property::writeFloat(const BufferPointer &buffer, float value) const
+	{
+		if (!quantizationbits)
+		{
+			buffer->writeFloat(value);
+			return;
+		}
+		// Fixed-point encoding, NaN ends up at the minimum as well
+		if (!(value > minimum))
+			value = minimum;
+		if (value > maximum)
+			value = maximum;
+		double steps = (double)((1 << quantizationbits) - 1);
+		double scaled = (value - minimum) / (maximum - minimum) * steps;
+		buffer->writeUnsignedInt((unsigned int)(scaled + 0.5),
+			quantizationbits);
+	}
+	float Property::readFloat(const BufferPointer &buffer) const
+	{
+		if (!quantizationbits)
+			return buffer->readFloat();
+		unsigned int value = buffer->readUnsignedInt(quantizationbits);
+		double steps = (double)((1 << quantizationbits) - 1);
+		return (float)(minimum + value / steps * (maximum - minimum));
+	}
+	void Property::writeInteger(const BufferPointer &buffer, int value) const
+	{
+		switch (encoding)
+		{
+			case EPE_Fixed:
+				// TODO: Unsigned integer
+				buffer->writeInt(value, size);
+				break;
+			case EPE_VarInt:
+				buffer->writeVarInt(value);
+				break;
+			case EPE_ZigZag:
+				buffer->writeZigZag(value);
+				break;
+			case EPE_ExpGolomb:
+				buffer->writeExpGolomb(((uint32_t)value << 1)
+					^ (uint32_t)(value >> 31), encodingorder);
+				break;
+		}
+	}
+	int Property::readInteger(const BufferPointer &buffer) const
+	{
+		switch (encoding)
+		{
+			case EPE_VarInt:
+				return buffer->readVarInt();
+			case EPE_ZigZag:
+				return buffer->readZigZag();
+			case EPE_ExpGolomb:
+			{
+				uint32_t value = buffer->readExpGolomb(encodingorder);
+				return (int)(value >> 1) ^ -(int)(value & 1);
+			}
+			default:
+				return buffer->readInt(size);
+		}
+	}
+
 	void Property::onChange()
 	{
 		if (!callbacks)
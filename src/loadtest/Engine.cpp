@@ -0,0 +1,134 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "Engine.hpp"
+#include "Game.hpp"
+
+#include <iostream>
+#include <cstdlib>
+#include <enet/enet.h>
+#include <sys/stat.h>
+
+namespace backlot
+{
+	Engine &Engine::get()
+	{
+		static Engine engine;
+		return engine;
+	}
+	Engine::~Engine()
+	{
+	}
+
+	bool Engine::run(std::string path, std::vector<std::string> args)
+	{
+		stopping = false;
+		directory = path;
+
+		//Check to see if the Gamedir exist
+		struct stat fileinfo;
+		if (stat(getGameDirectory().c_str(), &fileinfo))
+		{
+			std::cerr << "Game directory does not exist!" << std::endl;
+			return false;
+		}
+		if (enet_initialize() != 0)
+		{
+			std::cerr << "error: Could not initialize networking." << std::endl;
+			return false;
+		}
+
+		std::string address = "localhost:27272";
+		unsigned int clients = 16;
+		unsigned int ramp = 0;
+		unsigned int duration = 60;
+		bool compression = true;
+
+		// Parse command line arguments
+		for (int i = 0; i < int(args.size()); i++)
+		{
+			std::string option = args[i];
+			if ( ( (option == "--server") || (option == "-s") ))
+			{
+				i++;
+				address = args[i];
+			}
+			if ( ( (option == "--clients") || (option == "-c") ))
+			{
+				i++;
+				clients = atoi(args[i].c_str());
+			}
+			if ( ( (option == "--ramp") || (option == "-r") ))
+			{
+				i++;
+				ramp = atoi(args[i].c_str());
+			}
+			if ( ( (option == "--duration") || (option == "-d") ))
+			{
+				i++;
+				duration = atoi(args[i].c_str());
+			}
+			if (option == "--nocompression")
+			{
+				compression = false;
+			}
+		}
+
+		// Connect clients
+		if (!Game::get().init(address, clients, ramp, compression))
+		{
+			enet_deinitialize();
+			return false;
+		}
+		// Main loop
+		lastframe = getTime();
+		uint64_t end = lastframe + (uint64_t)duration * 1000000;
+		while (!stopping)
+		{
+			Game::get().update();
+			if (getTime() >= end)
+				stopping = true;
+			// Fixed time step
+			lastframe = lastframe + 20000;
+			uint64_t currenttime = getTime();
+			if (currenttime < lastframe)
+				usleep(lastframe - currenttime);
+		}
+		// Shut down engine
+		Game::get().destroy();
+		enet_deinitialize();
+		return true;
+	}
+
+	std::string Engine::getGameDirectory()
+	{
+		return directory;
+	}
+
+	void Engine::stop()
+	{
+		stopping = true;
+	}
+
+	Engine::Engine()
+	{
+	}
+}
@@ -0,0 +1,315 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "Game.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cstdlib>
+
+namespace backlot
+{
+	template<typename T> static T getPercentile(const std::vector<T> &sorted,
+		float fraction)
+	{
+		if (sorted.size() == 0)
+			return 0;
+		unsigned int index = (unsigned int)(fraction * sorted.size());
+		if (index >= sorted.size())
+			index = sorted.size() - 1;
+		return sorted[index];
+	}
+	static float getAverage(const std::vector<float> &values)
+	{
+		if (values.size() == 0)
+			return 0;
+		float sum = 0;
+		for (unsigned int i = 0; i < values.size(); i++)
+			sum += values[i];
+		return sum / values.size();
+	}
+
+	Game &Game::get()
+	{
+		static Game game;
+		return game;
+	}
+	Game::~Game()
+	{
+	}
+
+	bool Game::init(std::string address, unsigned int clientcount,
+		unsigned int ramp, bool compression)
+	{
+		this->clientcount = clientcount;
+		this->ramp = ramp;
+		this->compression = compression;
+		host = enet_host_create(NULL, clientcount, 0, 0);
+		if (host == 0)
+		{
+			std::cerr << "Could not create client socket." << std::endl;
+			return false;
+		}
+		std::string hostname = address.substr(0, address.find(":"));
+		enet_address_set_host(&this->address, hostname.c_str());
+		this->address.port = 27272;
+		if (address.find(":") != std::string::npos)
+			this->address.port = atoi(address.substr(address.find(":") + 1).c_str());
+		std::cout << "Connecting " << clientcount << " clients to "
+			<< address << "." << std::endl;
+		return true;
+	}
+	void Game::destroy()
+	{
+		// Print the results of the whole run
+		for (unsigned int i = 0; i < clients.size(); i++)
+		{
+			if (clients[i])
+				total[i].add(clients[i]->collectStatistics());
+		}
+		float averageticktime = 0;
+		if (statisticscount > 0)
+			averageticktime = (float)totalticktime / statisticscount;
+		printStatistics("total", total, averageticktime, totalmaxticktime);
+		// Disconnect properly
+		unsigned int connected = 0;
+		for (unsigned int i = 0; i < clients.size(); i++)
+		{
+			if (!clients[i])
+				continue;
+			enet_peer_disconnect(clients[i]->getPeer(), 0);
+			connected++;
+		}
+		ENetEvent event;
+		while (connected > 0 && enet_host_service(host, &event, 3000) > 0)
+		{
+			switch (event.type)
+			{
+				case ENET_EVENT_TYPE_RECEIVE:
+					enet_packet_destroy(event.packet);
+					break;
+				case ENET_EVENT_TYPE_DISCONNECT:
+					connected--;
+					break;
+				default:
+					break;
+			}
+		}
+		for (unsigned int i = 0; i < clients.size(); i++)
+			delete clients[i];
+		clients.clear();
+		enet_host_destroy(host);
+	}
+
+	void Game::update()
+	{
+		// Increase tick counter
+		time++;
+		// Open new connections
+		unsigned int target = clientcount;
+		if (ramp > 0 && ramp * (time / 50 + 1) < clientcount)
+			target = ramp * (time / 50 + 1);
+		while (clients.size() < target)
+		{
+			if (!connect())
+			{
+				clientcount = clients.size();
+				break;
+			}
+		}
+		// Receive packets
+		ENetEvent event;
+		while (enet_host_service(host, &event, 0) > 0)
+		{
+			switch (event.type)
+			{
+				case ENET_EVENT_TYPE_RECEIVE:
+				{
+					LoadClient *client = (LoadClient*)event.peer->data;
+					if (client)
+					{
+						client->receive(event.packet);
+						if (!client->isValid())
+						{
+							std::cerr << "Invalid data received." << std::endl;
+							enet_peer_disconnect(event.peer, 0);
+						}
+					}
+					enet_packet_destroy(event.packet);
+					break;
+				}
+				case ENET_EVENT_TYPE_DISCONNECT:
+				{
+					LoadClient *client = (LoadClient*)event.peer->data;
+					if (client)
+					{
+						std::cerr << "Client disconnected." << std::endl;
+						removeClient(client);
+					}
+					break;
+				}
+				default:
+					break;
+			}
+		}
+		// Send input
+		for (unsigned int i = 0; i < clients.size(); i++)
+		{
+			if (clients[i])
+				clients[i]->update();
+		}
+		enet_host_flush(host);
+		// Print the statistics once per second
+		if (time % 50 == 0)
+		{
+			collectStatistics();
+			std::ostringstream label;
+			label << "time=" << time / 50 << "s";
+			printStatistics(label.str(), interval, ticktime, maxticktime);
+		}
+	}
+
+	unsigned int Game::getTime()
+	{
+		return time;
+	}
+
+	void Game::setServerStatistics(unsigned int ticktime,
+		unsigned int maxticktime, unsigned int clients)
+	{
+		this->ticktime = ticktime;
+		this->maxticktime = maxticktime;
+		serverclients = clients;
+		newstatistics = true;
+	}
+
+	Game::Game()
+	{
+		host = 0;
+		clientcount = 0;
+		ramp = 0;
+		compression = true;
+		time = 0;
+		ticktime = 0;
+		maxticktime = 0;
+		serverclients = 0;
+		newstatistics = false;
+		totalticktime = 0;
+		totalmaxticktime = 0;
+		statisticscount = 0;
+	}
+
+	bool Game::connect()
+	{
+		ENetPeer *peer = enet_host_connect(host, &address, 2);
+		if (!peer)
+		{
+			std::cerr << "Could not create client peer." << std::endl;
+			return false;
+		}
+		LoadClient *client = new LoadClient(peer, clients.size() + 1,
+			compression);
+		peer->data = client;
+		clients.push_back(client);
+		interval.push_back(TrafficStatistics());
+		total.push_back(TrafficStatistics());
+		return true;
+	}
+	void Game::removeClient(LoadClient *client)
+	{
+		for (unsigned int i = 0; i < clients.size(); i++)
+		{
+			if (clients[i] == client)
+			{
+				total[i].add(client->collectStatistics());
+				client->getPeer()->data = 0;
+				delete client;
+				clients[i] = 0;
+				return;
+			}
+		}
+	}
+	void Game::collectStatistics()
+	{
+		for (unsigned int i = 0; i < clients.size(); i++)
+		{
+			if (clients[i])
+				interval[i] = clients[i]->collectStatistics();
+			else
+				interval[i] = TrafficStatistics();
+			total[i].add(interval[i]);
+		}
+		if (newstatistics)
+		{
+			totalticktime += ticktime;
+			if (maxticktime > totalmaxticktime)
+				totalmaxticktime = maxticktime;
+			statisticscount++;
+			newstatistics = false;
+		}
+	}
+	void Game::printStatistics(std::string label,
+		const std::vector<TrafficStatistics> &statistics, float ticktime,
+		unsigned int maxticktime)
+	{
+		std::vector<float> download;
+		std::vector<float> upload;
+		std::vector<float> loss;
+		std::vector<unsigned int> latency;
+		for (unsigned int i = 0; i < statistics.size(); i++)
+		{
+			const TrafficStatistics &client = statistics[i];
+			if (client.ticks == 0)
+				continue;
+			float seconds = client.ticks * 0.02f;
+			download.push_back(client.received / seconds);
+			upload.push_back(client.sent / seconds);
+			if (client.expectedupdates > 0)
+			{
+				loss.push_back(100.0f * (client.expectedupdates
+					- client.updates) / client.expectedupdates);
+			}
+			latency.insert(latency.end(), client.latency.begin(),
+				client.latency.end());
+		}
+		std::sort(download.begin(), download.end());
+		std::sort(upload.begin(), upload.end());
+		std::sort(loss.begin(), loss.end());
+		std::sort(latency.begin(), latency.end());
+		std::cout << std::fixed << std::setprecision(2) << label
+			<< " clients=" << download.size()
+			<< " server_clients=" << serverclients
+			<< " tick_avg=" << ticktime / 1000 << "ms"
+			<< " tick_max=" << maxticktime / 1000.0f << "ms"
+			<< " down_avg=" << getAverage(download) << "B/s"
+			<< " down_max=" << getPercentile(download, 1.0f) << "B/s"
+			<< " up_avg=" << getAverage(upload) << "B/s"
+			<< " loss_p50=" << getPercentile(loss, 0.5f) << "%"
+			<< " loss_p90=" << getPercentile(loss, 0.9f) << "%"
+			<< " loss_p99=" << getPercentile(loss, 0.99f) << "%"
+			<< " rtt_p50=" << getPercentile(latency, 0.5f) / 1000.0f << "ms"
+			<< " rtt_p90=" << getPercentile(latency, 0.9f) / 1000.0f << "ms"
+			<< " rtt_p99=" << getPercentile(latency, 0.99f) / 1000.0f << "ms"
+			<< std::endl;
+	}
+}
@@ -0,0 +1,342 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "LoadClient.hpp"
+#include "Engine.hpp"
+#include "Game.hpp"
+#include "NetworkData.hpp"
+#include "MessageSplitter.hpp"
+#include "BufferPool.hpp"
+#include "Log.hpp"
+
+
+namespace backlot
+{
+	TrafficStatistics::TrafficStatistics()
+	{
+		ticks = 0;
+		received = 0;
+		sent = 0;
+		updates = 0;
+		expectedupdates = 0;
+	}
+
+	void TrafficStatistics::add(const TrafficStatistics &other)
+	{
+		ticks += other.ticks;
+		received += other.received;
+		sent += other.sent;
+		updates += other.updates;
+		expectedupdates += other.expectedupdates;
+		latency.insert(latency.end(), other.latency.begin(),
+			other.latency.end());
+	}
+
+	LoadClient::LoadClient(ENetPeer *peer, unsigned int seed,
+		bool compression)
+		: peer(peer), seed(seed), compression(compression)
+	{
+		ready = false;
+		valid = true;
+		clientid = -1;
+		time = 0;
+		lastupdate = 0;
+		lastacked = 0;
+		inputsequence = 0;
+		nextkeys = 0;
+		turnspeed = 0;
+	}
+	LoadClient::~LoadClient()
+	{
+	}
+
+	bool LoadClient::isReady()
+	{
+		return ready;
+	}
+	bool LoadClient::isValid()
+	{
+		return valid;
+	}
+
+	void LoadClient::receive(ENetPacket *packet)
+	{
+		statistics.received += packet->dataLength;
+		BufferPointer msg = new Buffer(packet->data, packet->dataLength,
+			true);
+		if (!MessageSplitter::split(msg, messages))
+			valid = false;
+		for (unsigned int i = 0; i < messages.size() && valid; i++)
+		{
+			if (!handleMessage(messages[i]))
+				valid = false;
+		}
+		messages.clear();
+	}
+	void LoadClient::update()
+	{
+		if (!ready || !valid)
+			return;
+		statistics.ticks++;
+		// Increase tick counter
+		time++;
+		// Move the player around
+		std::map<int, EntityPointer>::iterator it;
+		for (it = entities.begin(); it != entities.end(); it++)
+		{
+			if (it->second->getOwner() == clientid
+				&& it->second->hasInput())
+			{
+				updateInput(it->second);
+				break;
+			}
+		}
+		// Send the input of the last ticks like the real client
+		inputsequence++;
+		BufferPointer input = BufferPool::get().allocate();
+		input->write8(EPT_Keys);
+		input->write32(time);
+		input->write32(inputsequence);
+		bool hasinput = false;
+		for (it = entities.begin(); it != entities.end(); it++)
+		{
+			if (it->second->getOwner() != clientid
+				|| !it->second->hasInput())
+				continue;
+			it->second->recordInput();
+			input->write16(it->first + 1);
+			it->second->getInput(input);
+			hasinput = true;
+		}
+		if (hasinput)
+		{
+			input->write16(0);
+			send(input);
+		}
+		// Send updates to the server. Input is not acknowledged, so an
+		// empty update is sent now and then to measure the latency.
+		BufferPointer buffer = BufferPool::get().allocate();
+		buffer->write8(EPT_Update);
+		buffer->write32(time);
+		unsigned int updatecount = 0;
+		for (it = entities.begin(); it != entities.end(); it++)
+		{
+			if (it->second->getOwner() != clientid)
+				continue;
+			if (it->second->hasChanged(lastacked))
+			{
+				updatecount++;
+				buffer->write16(it->first + 1);
+				it->second->getUpdate(lastacked, buffer);
+			}
+		}
+		if (updatecount == 0 && time % LATENCY_INTERVAL != 0)
+			return;
+		send(buffer);
+		// Remember the send time to measure the latency once the server
+		// acknowledges the update
+		if (sentupdates.size() == 0 || sentupdates.back().time < time)
+		{
+			SentUpdate update;
+			update.time = time;
+			update.sent = Engine::getTime();
+			sentupdates.push_back(update);
+		}
+	}
+
+	TrafficStatistics LoadClient::collectStatistics()
+	{
+		TrafficStatistics collected = statistics;
+		statistics = TrafficStatistics();
+		return collected;
+	}
+
+	bool LoadClient::handleMessage(BufferPointer msg)
+	{
+		PacketType type = (PacketType)msg->read8();
+		// Parse packet
+		if (type == EPT_InitialData)
+		{
+			// The map is not needed as all movement happens on the server
+			msg->readString();
+			clientid = msg->read16();
+			unsigned int features = 0;
+			if (msg->getPosition() < msg->getSize() * 8)
+				features = msg->read8();
+			// Enter the game
+			unsigned int wanted = ENF_Statistics;
+			if (compression)
+				wanted |= ENF_Compression;
+			BufferPointer reply = new Buffer();
+			reply->write8(EPT_Ready);
+			reply->write8(features & wanted);
+			send(reply, true);
+			ready = true;
+		}
+		else if (type == EPT_EntityCreated)
+		{
+			int id = msg->read16();
+			int owner = msg->read16();
+			std::string type = msg->readString();
+			EntityTemplatePointer tpl = EntityTemplate::get(type);
+			if (tpl.isNull())
+			{
+				LOG_ERROR("Could not get entity template \"" << type << "\".");
+				return false;
+			}
+			EntityPointer entity = new Entity();
+			entity->create(tpl, owner, msg);
+			entities[id] = entity;
+		}
+		else if (type == EPT_EntityDeleted)
+		{
+			int id = msg->read16();
+			entities.erase(id);
+		}
+		else if (type == EPT_ActivateEntity)
+		{
+			int id = msg->read16();
+			std::map<int, EntityPointer>::iterator it = entities.find(id);
+			if (it != entities.end())
+			{
+				// The message contains the complete current state
+				it->second->applyUpdate(msg);
+				it->second->setActive(true);
+			}
+		}
+		else if (type == EPT_DeactivateEntity)
+		{
+			int id = msg->read16();
+			std::map<int, EntityPointer>::iterator it = entities.find(id);
+			if (it != entities.end())
+				it->second->setActive(false);
+		}
+		else if (type == EPT_Update)
+		{
+			injectUpdates(msg);
+		}
+		else if (type == EPT_UpdateReceived)
+		{
+			unsigned int acked = msg->read32();
+			if (acked > lastacked)
+				lastacked = acked;
+			// Older acknowledgements are dropped by ENet, so all updates up
+			// to this one have either been acknowledged now or never will be
+			uint64_t now = Engine::getTime();
+			while (sentupdates.size() > 0
+				&& sentupdates.front().time <= acked)
+			{
+				const SentUpdate &update = sentupdates.front();
+				if (update.time == acked)
+					statistics.latency.push_back(now - update.sent);
+				sentupdates.pop_front();
+			}
+		}
+		else if (type == EPT_ServerStatistics)
+		{
+			unsigned int ticktime = msg->read32();
+			unsigned int maxticktime = msg->read32();
+			unsigned int clients = msg->read16();
+			Game::get().setServerStatistics(ticktime, maxticktime, clients);
+		}
+		else
+		{
+			LOG_ERROR("Unknown packet received.");
+		}
+		return true;
+	}
+	void LoadClient::injectUpdates(BufferPointer msg)
+	{
+		unsigned int updatetime = msg->read32();
+		msg->read32();
+		// The server sends one update per tick, count the missing ones
+		if (lastupdate == 0)
+			statistics.expectedupdates++;
+		else if (updatetime > lastupdate)
+			statistics.expectedupdates += updatetime - lastupdate;
+		else
+			return;
+		statistics.updates++;
+		lastupdate = updatetime;
+		time = updatetime;
+		// Do not acknowledge updates for entities which have not been
+		// activated yet, like the real client
+		bool complete = true;
+		while (1)
+		{
+			int entityid = msg->read16();
+			if (!entityid)
+				break;
+			entityid--;
+			std::map<int, EntityPointer>::iterator it = entities.find(entityid);
+			if (it == entities.end())
+				return;
+			if (!it->second->isActive())
+				complete = false;
+			it->second->applyUpdate(msg);
+		}
+		if (!complete)
+			return;
+		// Ack updates.
+		BufferPointer received = new Buffer();
+		received->write8(EPT_UpdateReceived);
+		received->write32(updatetime);
+		send(received);
+	}
+	void LoadClient::updateInput(const EntityPointer &entity)
+	{
+		// Change the direction every 0.5 to 2 seconds and shoot now and then
+		Property *keys = entity->getProperty("keys");
+		if (keys && time >= nextkeys)
+		{
+			unsigned int value = getRandom() & EKM_Move;
+			if (getRandom() % 4 == 0)
+				value |= EKM_Shoot;
+			keys->setUnsignedInt(value);
+			nextkeys = time + 25 + getRandom() % 75;
+			turnspeed = (float)(getRandom() % 1000) / 100.0f - 5.0f;
+		}
+		// Keep turning around like a player moving the mouse
+		Property *rotation = entity->getProperty("rotation");
+		if (rotation && turnspeed != 0)
+		{
+			float angle = rotation->getFloat() + turnspeed;
+			if (angle > 180)
+				angle -= 360;
+			if (angle < -180)
+				angle += 360;
+			rotation->setFloat(angle);
+		}
+	}
+	void LoadClient::send(BufferPointer buffer, bool reliable)
+	{
+		statistics.sent += buffer->getSize();
+		ENetPacket *packet = enet_packet_create(buffer->getData(),
+			buffer->getSize(), reliable?ENET_PACKET_FLAG_RELIABLE:0);
+		enet_peer_send(peer, reliable ? ENC_Reliable : ENC_Updates, packet);
+	}
+	unsigned int LoadClient::getRandom()
+	{
+		// Simple LCG, every client gets a reproducible sequence
+		seed = seed * 1103515245 + 12345;
+		return (seed >> 16) & 0x7fff;
+	}
+}
@@ -0,0 +1,174 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "entity/Entity.hpp"
+#include "BufferPool.hpp"
+
+namespace backlot
+{
+	Entity::Entity() : ReferenceCounted()
+	{
+		owner = 0;
+		active = true;
+	}
+	Entity::~Entity()
+	{
+	}
+
+	bool Entity::create(EntityTemplatePointer tpl, int owner,
+		BufferPointer state)
+	{
+		this->tpl = tpl;
+		this->owner = owner;
+		// Get a copy of the properties and their default values
+		properties = tpl->getProperties();
+		changetime.resize(properties.size(), -1);
+		// Apply state
+		setState(state);
+		return true;
+	}
+	EntityTemplatePointer Entity::getTemplate()
+	{
+		return tpl;
+	}
+
+	void Entity::setState(BufferPointer buffer)
+	{
+		if (buffer.isNull())
+			return;
+		for (unsigned int i = 0; i < properties.size(); i++)
+		{
+			int changed = buffer->readUnsignedInt(1);
+			if (changed)
+			{
+				properties[i].read(buffer);
+			}
+		}
+	}
+
+	void Entity::applyUpdate(BufferPointer buffer)
+	{
+		for (unsigned int i = 0; i < properties.size(); i++)
+		{
+			int changed = buffer->readUnsignedInt(1);
+			if (changed)
+			{
+				properties[i].read(buffer);
+			}
+		}
+	}
+	void Entity::getUpdate(int time, BufferPointer buffer)
+	{
+		for (unsigned int i = 0; i < properties.size(); i++)
+		{
+			if ((properties[i].getFlags() & EPF_Unlocked)
+				&& !(properties[i].getFlags() & EPF_Input)
+				&& changetime[i] > time)
+			{
+				// Bit set: Property changed.
+				buffer->writeUnsignedInt(1, 1);
+				// Write the property to the stream.
+				properties[i].write(buffer);
+			}
+			else
+			{
+				// Bit not set: Property remained unchanged.
+				buffer->writeUnsignedInt(0, 1);
+			}
+		}
+	}
+	bool Entity::hasChanged(int time)
+	{
+		for (unsigned int i = 0; i < properties.size(); i++)
+		{
+			if (changetime[i] > time)
+				return true;
+		}
+		return false;
+	}
+
+	int Entity::getOwner()
+	{
+		return owner;
+	}
+
+	void Entity::setActive(bool active)
+	{
+		this->active = active;
+	}
+	bool Entity::isActive()
+	{
+		return active;
+	}
+
+	Property *Entity::getProperty(std::string name)
+	{
+		for (unsigned int i = 0; i < properties.size(); i++)
+		{
+			if (properties[i].getName() == name)
+				return &properties[i];
+		}
+		return 0;
+	}
+	void Entity::setChanged(Property *property, int time)
+	{
+		unsigned int index = property - &properties[0];
+		if (index < properties.size()
+			&& (properties[index].getFlags() & EPF_Unlocked))
+			changetime[index] = time;
+	}
+
+	bool Entity::hasInput()
+	{
+		for (unsigned int i = 0; i < properties.size(); i++)
+		{
+			if (properties[i].getFlags() & EPF_Input)
+				return true;
+		}
+		return false;
+	}
+	void Entity::recordInput()
+	{
+		// Reuse the buffer of the oldest command
+		BufferPointer command;
+		if (inputhistory.size() == INPUT_HISTORY)
+		{
+			command = inputhistory.front();
+			inputhistory.pop_front();
+			command->setPosition(0);
+		}
+		else
+			command = BufferPool::get().allocate();
+		for (unsigned int i = 0; i < properties.size(); i++)
+		{
+			if (properties[i].getFlags() & EPF_Input)
+				properties[i].write(command);
+		}
+		inputhistory.push_back(command);
+	}
+	void Entity::getInput(BufferPointer buffer)
+	{
+		buffer->write8(inputhistory.size());
+		for (unsigned int i = 0; i < inputhistory.size(); i++)
+			buffer->writeBits(*inputhistory[i].get(),
+				inputhistory[i]->getPosition());
+	}
+}
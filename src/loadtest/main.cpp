@@ -0,0 +1,55 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "Engine.hpp"
+
+#include <iostream>
+#include <csignal>
+
+static void onInterrupt(int signal)
+{
+	// Print the results before exiting
+	backlot::Engine::get().stop();
+}
+
+int main(int argc, char **argv)
+{
+	// Parse arguments
+	if (argc == 1)
+	{
+		std::cerr << "Error: No game directory given." << std::endl;
+		std::cerr << "Usage: " << argv[0] << " <gamedir> [--server host:port]"
+			" [--clients n] [--ramp clients/s] [--duration s]"
+			" [--nocompression]" << std::endl;
+		return -1;
+	}
+	std::vector<std::string> args;
+	for (int i = 2; i < argc; i++)
+		args.push_back(argv[i]);
+	signal(SIGINT, onInterrupt);
+	// Run load test
+	if (!backlot::Engine::get().run(argv[1], args))
+	{
+		return -1;
+	}
+
+	return 0;
+}
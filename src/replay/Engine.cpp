@@ -0,0 +1,134 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "Engine.hpp"
+#include "Game.hpp"
+
+#include <iostream>
+#include <cstdlib>
+#include <sys/stat.h>
+
+namespace backlot
+{
+	Engine &Engine::get()
+	{
+		static Engine engine;
+		return engine;
+	}
+	Engine::~Engine()
+	{
+	}
+
+	bool Engine::run(std::string path, std::vector<std::string> args)
+	{
+		stopping = false;
+		directory = path;
+
+		//Check to see if the Gamedir exist
+		struct stat fileinfo;
+		if (stat(getGameDirectory().c_str(), &fileinfo))
+		{
+			std::cerr << "Game directory does not exist!" << std::endl;
+			return false;
+		}
+
+		std::string filename;
+		unsigned int tick = 0;
+		bool seek = false;
+		bool encodings = false;
+
+		// Parse command line arguments
+		for (int i = 0; i < int(args.size()); i++)
+		{
+			std::string option = args[i];
+			if ( ( (option == "--tick") || (option == "-t") ))
+			{
+				i++;
+				tick = atoi(args[i].c_str());
+				seek = true;
+			}
+			else if (option == "--encodings" || option == "-e")
+			{
+				encodings = true;
+			}
+			else
+			{
+				filename = option;
+			}
+		}
+		if (filename == "")
+		{
+			std::cerr << "No replay file given." << std::endl;
+			return false;
+		}
+
+		// Open replay
+		Game &game = Game::get();
+		if (!game.load(filename))
+			return false;
+		std::cout << filename << ": " << game.getKeyframeCount()
+			<< " keyframes, one every " << game.getKeyframeInterval()
+			<< " ticks" << std::endl;
+		bool result;
+		if (encodings)
+		{
+			// Compare the integer encodings on the recorded values
+			game.setSampling(true);
+			while (game.step());
+			game.printEncodings();
+			game.destroy();
+			return true;
+		}
+		if (seek)
+		{
+			uint64_t start = getTime();
+			result = game.seek(tick);
+			std::cout << "Seek took " << (getTime() - start) << " us."
+				<< std::endl;
+		}
+		else
+		{
+			// Play the whole replay to check it
+			unsigned int records = 0;
+			while (game.step())
+				records++;
+			std::cout << records << " records" << std::endl;
+			result = true;
+		}
+		game.print();
+		game.destroy();
+		return result;
+	}
+
+	std::string Engine::getGameDirectory()
+	{
+		return directory;
+	}
+
+	void Engine::stop()
+	{
+		stopping = true;
+	}
+
+	Engine::Engine()
+	{
+	}
+}
@@ -0,0 +1,404 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "Game.hpp"
+#include "Engine.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace backlot
+{
+	Game &Game::get()
+	{
+		static Game game;
+		return game;
+	}
+	Game::~Game()
+	{
+		destroy();
+	}
+
+	bool Game::load(std::string filename)
+	{
+		destroy();
+		// Map the replay file
+		int file = open(filename.c_str(), O_RDONLY);
+		if (file == -1)
+		{
+			std::cerr << "Could not open " << filename << "." << std::endl;
+			return false;
+		}
+		struct stat fileinfo;
+		if (fstat(file, &fileinfo) || fileinfo.st_size < (off_t)REPLAY_HEADER_SIZE)
+		{
+			std::cerr << filename << " is no replay file." << std::endl;
+			close(file);
+			return false;
+		}
+		void *mapped = mmap(0, fileinfo.st_size, PROT_READ, MAP_PRIVATE, file,
+			0);
+		close(file);
+		if (mapped == MAP_FAILED)
+		{
+			std::cerr << "Could not map " << filename << "." << std::endl;
+			return false;
+		}
+		data = (char*)mapped;
+		size = fileinfo.st_size;
+		// Check the header
+		BufferPointer header = new Buffer(data, REPLAY_HEADER_SIZE, true);
+		unsigned int version = 0;
+		if (memcmp(data, REPLAY_MAGIC, 4) == 0)
+		{
+			header->setPosition(32);
+			version = header->read32();
+		}
+		if (version != REPLAY_VERSION)
+		{
+			std::cerr << filename << " is no replay file or has an"
+				" unsupported version." << std::endl;
+			destroy();
+			return false;
+		}
+		ticklength = header->read32();
+		keyframeinterval = header->read32();
+		if (keyframeinterval == 0)
+			keyframeinterval = 1;
+		// Read the keyframe index
+		FILE *index = fopen((filename + ".idx").c_str(), "rb");
+		if (index)
+		{
+			char entrydata[REPLAY_INDEX_ENTRY_SIZE];
+			while (fread(entrydata, REPLAY_INDEX_ENTRY_SIZE, 1, index) == 1)
+			{
+				BufferPointer entry = new Buffer(entrydata,
+					REPLAY_INDEX_ENTRY_SIZE, true);
+				ReplayKeyframe keyframe;
+				keyframe.tick = entry->read32();
+				keyframe.offset = (uint64_t)entry->read32() << 32;
+				keyframe.offset |= entry->read32();
+				if (keyframe.offset >= size)
+					break;
+				keyframes.push_back(keyframe);
+			}
+			fclose(index);
+		}
+		else
+		{
+			// Without index the replay can only be played from the start
+			std::cerr << "Warning: No index found for " << filename << "."
+				<< std::endl;
+		}
+		position = REPLAY_HEADER_SIZE;
+		time = 0;
+		return true;
+	}
+	void Game::destroy()
+	{
+		if (data)
+		{
+			munmap(data, size);
+			data = 0;
+		}
+		size = 0;
+		keyframes.clear();
+		entities.clear();
+	}
+
+	bool Game::seek(unsigned int tick)
+	{
+		// Start at the last keyframe before the tick unless the current
+		// state is closer
+		bool started = position > REPLAY_HEADER_SIZE;
+		int keyframe = findKeyframe(tick);
+		if (keyframe != -1)
+		{
+			if (!started || time > tick || time < keyframes[keyframe].tick)
+			{
+				// Keyframes spread over several records do not remove the
+				// old entities themselves
+				position = keyframes[keyframe].offset;
+				entities.clear();
+			}
+		}
+		else if (started && time > tick)
+		{
+			// No keyframe, replay everything from the start
+			position = REPLAY_HEADER_SIZE;
+			entities.clear();
+			time = 0;
+		}
+		// Apply the records up to the tick
+		unsigned int recordtick;
+		ReplayRecordType type;
+		unsigned int recordsize;
+		while (readRecordHeader(position, recordtick, type, recordsize)
+			&& recordtick <= tick)
+		{
+			if (!step())
+				return false;
+		}
+		return true;
+	}
+	bool Game::step()
+	{
+		unsigned int tick;
+		ReplayRecordType type;
+		unsigned int recordsize;
+		if (!readRecordHeader(position, tick, type, recordsize))
+			return false;
+		BufferPointer record = new Buffer(data + position
+			+ REPLAY_RECORD_HEADER_SIZE, recordsize, true);
+		position += REPLAY_RECORD_HEADER_SIZE + recordsize;
+		time = tick;
+		if (!applyRecord(record, type))
+		{
+			std::cerr << "Invalid record at tick " << tick << "."
+				<< std::endl;
+			// Stop here, the following records depend on this one
+			position = size;
+			return false;
+		}
+		return true;
+	}
+
+	unsigned int Game::getTime()
+	{
+		return time;
+	}
+	unsigned int Game::getKeyframeInterval()
+	{
+		return keyframeinterval;
+	}
+	unsigned int Game::getKeyframeCount()
+	{
+		return keyframes.size();
+	}
+
+	void Game::print()
+	{
+		std::cout << "Tick " << time << " (" << (uint64_t)time * ticklength
+			/ 1000 << " ms), " << entities.size() << " entities" << std::endl;
+		std::map<int, EntityPointer>::iterator it;
+		for (it = entities.begin(); it != entities.end(); it++)
+		{
+			EntityPointer entity = it->second;
+			std::cout << it->first << ": " << entity->getTemplate()->getName()
+				<< " (owner " << entity->getOwner() << ")" << std::endl;
+			std::vector<Property> &properties = entity->getProperties();
+			for (unsigned int i = 0; i < properties.size(); i++)
+			{
+				Property &property = properties[i];
+				std::cout << "\t" << property.getName() << " = ";
+				switch (property.getType())
+				{
+					case EPT_Integer:
+						std::cout << property.getInt();
+						break;
+					case EPT_Float:
+						std::cout << property.getFloat();
+						break;
+					case EPT_Vector2F:
+						std::cout << property.getVector2F().x << "/"
+							<< property.getVector2F().y;
+						break;
+					case EPT_Vector2I:
+						std::cout << property.getVector2I().x << "/"
+							<< property.getVector2I().y;
+						break;
+					case EPT_String:
+						std::cout << "\"" << property.getString() << "\"";
+						break;
+				}
+				std::cout << std::endl;
+			}
+		}
+	}
+
+	void Game::setSampling(bool sampling)
+	{
+		this->sampling = sampling;
+	}
+	void Game::addSample(EntityTemplatePointer tpl, const Property &property)
+	{
+		if (!sampling)
+			return;
+		if (property.getType() != EPT_Integer
+			&& property.getType() != EPT_Vector2I)
+			return;
+		Samples &entry = samples[tpl->getName() + "." + property.getName()];
+		entry.size = property.getSize();
+		if (property.getType() == EPT_Integer)
+			entry.values.push_back(property.getInt());
+		else
+		{
+			entry.values.push_back(property.getVector2I().x);
+			entry.values.push_back(property.getVector2I().y);
+		}
+	}
+	void Game::printEncodings()
+	{
+		// Short streams are encoded several times to get measurable times
+		static const unsigned int MIN_VALUES = 1000000;
+		const char *names[] = {"fixed", "varint", "zigzag", "expgolomb 0",
+			"expgolomb 1", "expgolomb 2", "expgolomb 3"};
+		std::map<std::string, Samples>::iterator it;
+		for (it = samples.begin(); it != samples.end(); it++)
+		{
+			std::vector<int> &values = it->second.values;
+			std::cout << it->first << ": " << values.size() << " values"
+				<< std::endl;
+			unsigned int repeat = MIN_VALUES / values.size() + 1;
+			for (unsigned int i = 0; i < 7; i++)
+			{
+				Property property("", EPT_Integer);
+				property.setSize(it->second.size);
+				if (i == 0)
+					property.setEncoding(EPE_Fixed);
+				else if (i == 1)
+					property.setEncoding(EPE_VarInt);
+				else if (i == 2)
+					property.setEncoding(EPE_ZigZag);
+				else
+					property.setEncoding(EPE_ExpGolomb, i - 3);
+				BufferPointer buffer = new Buffer();
+				uint64_t start = Engine::getTime();
+				for (unsigned int r = 0; r < repeat; r++)
+				{
+					buffer->setPosition(0);
+					for (unsigned int j = 0; j < values.size(); j++)
+					{
+						property.setInt(values[j]);
+						property.write(buffer);
+					}
+				}
+				uint64_t duration = Engine::getTime() - start;
+				std::cout << "\t" << std::setw(12) << std::left << names[i]
+					<< std::right << std::fixed << std::setprecision(2)
+					<< std::setw(6) << (double)buffer->getPosition()
+					/ values.size() << " bits/value" << std::setw(8)
+					<< (double)duration * 1000 / repeat / values.size()
+					<< " ns/value" << std::endl;
+			}
+		}
+	}
+
+	Game::Game()
+	{
+		sampling = false;
+		data = 0;
+		size = 0;
+		position = 0;
+		ticklength = 20000;
+		keyframeinterval = 1;
+		time = 0;
+	}
+
+	int Game::findKeyframe(unsigned int tick)
+	{
+		if (keyframes.size() == 0 || keyframes[0].tick > tick)
+			return -1;
+		int index = tick / keyframeinterval;
+		if (index >= (int)keyframes.size())
+			index = keyframes.size() - 1;
+		while (keyframes[index].tick > tick)
+			index--;
+		while (index + 1 < (int)keyframes.size()
+			&& keyframes[index + 1].tick <= tick)
+			index++;
+		return index;
+	}
+	bool Game::readRecordHeader(uint64_t position, unsigned int &tick,
+		ReplayRecordType &type, unsigned int &size)
+	{
+		if (position + REPLAY_RECORD_HEADER_SIZE > this->size)
+			return false;
+		BufferPointer header = new Buffer(data + position,
+			REPLAY_RECORD_HEADER_SIZE, true);
+		tick = header->read32();
+		type = (ReplayRecordType)header->read8();
+		size = header->read32();
+		// Zeros after the last record if the server did not exit cleanly
+		if (type != ERT_Keyframe && type != ERT_Delta
+			&& type != ERT_KeyframeStart)
+			return false;
+		return position + REPLAY_RECORD_HEADER_SIZE + size <= this->size;
+	}
+	bool Game::applyRecord(BufferPointer record, ReplayRecordType type)
+	{
+		if (type == ERT_Keyframe)
+			entities.clear();
+		while (record->getPosition() < record->getSize() * 8)
+		{
+			ReplayChangeType change = (ReplayChangeType)record->read8();
+			if (change == ERC_End)
+				return true;
+			int id = record->read16();
+			if (change == ERC_Created)
+			{
+				int owner = record->read16();
+				std::string name = record->readString();
+				EntityTemplatePointer tpl = EntityTemplate::get(name);
+				if (tpl.isNull())
+					return false;
+				EntityPointer entity = new Entity();
+				entity->create(tpl, owner, record);
+				entities[id] = entity;
+			}
+			else if (change == ERC_Deleted)
+			{
+				entities.erase(id);
+			}
+			else if (change == ERC_Update)
+			{
+				std::map<int, EntityPointer>::iterator it = entities.find(id);
+				if (it == entities.end())
+					return false;
+				it->second->applyUpdate(record);
+			}
+			else if (change == ERC_PendingUpdate)
+			{
+				// Entities which are not known yet when starting at a
+				// keyframe which is spread over several records
+				unsigned int size = record->read16();
+				unsigned int end = record->getPosition() + size * 8;
+				std::map<int, EntityPointer>::iterator it = entities.find(id);
+				if (it != entities.end())
+					it->second->applyUpdate(record);
+				record->setPosition(end);
+			}
+			else
+			{
+				return false;
+			}
+			record->nextByte();
+		}
+		return false;
+	}
+}
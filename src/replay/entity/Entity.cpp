@@ -0,0 +1,70 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "entity/Entity.hpp"
+#include "Game.hpp"
+
+namespace backlot
+{
+	Entity::Entity() : ReferenceCounted()
+	{
+		owner = 0;
+	}
+	Entity::~Entity()
+	{
+	}
+
+	void Entity::create(EntityTemplatePointer tpl, int owner,
+		BufferPointer state)
+	{
+		this->tpl = tpl;
+		this->owner = owner;
+		// Get a copy of the properties and their default values
+		properties = tpl->getProperties();
+		applyUpdate(state);
+	}
+	EntityTemplatePointer Entity::getTemplate()
+	{
+		return tpl;
+	}
+	int Entity::getOwner()
+	{
+		return owner;
+	}
+
+	void Entity::applyUpdate(BufferPointer buffer)
+	{
+		for (unsigned int i = 0; i < properties.size(); i++)
+		{
+			int changed = buffer->readUnsignedInt(1);
+			if (changed)
+			{
+				properties[i].read(buffer);
+				Game::get().addSample(tpl, properties[i]);
+			}
+		}
+	}
+
+	std::vector<Property> &Entity::getProperties()
+	{
+		return properties;
+	}
+}
@@ -184,7 +184,9 @@ namespace backlot
 				.def("getCollision", &Game::getCollision)
 				.def("getEntities", (EntityListPointer (Game::*)(std::string))&Game::getEntities)
 				.def("getEntities", (EntityListPointer (Game::*)(RectangleF, std::string))&Game::getEntities)
-				.def("getEntities", (EntityListPointer (Game::*)(RectangleF))&Game::getEntities),
+				.def("getEntities", (EntityListPointer (Game::*)(RectangleF))&Game::getEntities)
+				.def("getEntitiesInRadius", &Game::getEntitiesInRadius)
+				.def("getNearestEntity", &Game::getNearestEntity),
 			// Engine
 			luabind::class_<Engine>("Engine")
 				.scope
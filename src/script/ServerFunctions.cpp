@@ -55,7 +55,10 @@ namespace backlot
 				.def("getProperty", &Entity::getProperty)
 				.def("getScript", &Entity::getScript)
 				.def("getRectangle", &Entity::getRectangle)
-				.def("getID", &Entity::getID),
+				.def("setPriority", &Entity::setPriority)
+				.def("getPriority", &Entity::getPriority)
+				.def("getID", &Entity::getID)
+				.def("getOwner", &Entity::getOwner),
 			// EntityState
 			luabind::class_<EntityState, ReferenceCounted, SharedPointer<EntityState> >("EntityState")
 				.scope
@@ -82,11 +85,18 @@ namespace backlot
 				.def("addEntity", &Game::addEntityWithState)
 				.def("removeEntity", &Game::removeEntity)
 				.def("getEntity", &Game::getEntity)
-				.def("getCollision", &Game::getCollision)
+				.def("getTime", &Game::getTime)
+				.def("getLagCompensatedTime", &Game::getLagCompensatedTime)
+				.def("getCollision", (CollisionInfo (Game::*)(Vector2F, Vector2F, float))&Game::getCollision)
+				.def("getCollision", (CollisionInfo (Game::*)(Vector2F, Vector2F, float, unsigned int))&Game::getCollision)
+				.def("getCollision", (CollisionInfo (Game::*)(Vector2F, Vector2F, float, unsigned int, const std::string&, int))&Game::getCollision)
 				.def("registerForDeletion", &Game::registerForDeletion)
 				.def("getEntities", (EntityListPointer (Game::*)(std::string))&Game::getEntities)
 				.def("getEntities", (EntityListPointer (Game::*)(RectangleF, std::string))&Game::getEntities)
-				.def("getEntities", (EntityListPointer (Game::*)(RectangleF))&Game::getEntities),
+				.def("getEntities", (EntityListPointer (Game::*)(RectangleF))&Game::getEntities)
+				.def("getEntities", (EntityListPointer (Game::*)(RectangleF, const std::string&, unsigned int))&Game::getEntities)
+				.def("getEntitiesInRadius", &Game::getEntitiesInRadius)
+				.def("getNearestEntity", &Game::getNearestEntity),
 			// Engine
 			luabind::class_<Engine>("Engine")
 				.scope
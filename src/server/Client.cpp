@@ -20,17 +20,160 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
 #include "Client.hpp"
+#include "PacketCompressor.hpp"
+#include "BufferPool.hpp"
+#include "NetworkData.hpp"
 
 namespace backlot
 {
+	/**
+	 * Limits for the update budget in bytes per tick. The upper limit keeps
+	 * packets below the usual MTU so that ENet never has to fragment them.
+	 */
+	static const float MIN_BUDGET = 128;
+	static const float MAX_BUDGET = 1200;
+	static const float INITIAL_BUDGET = 400;
+	/**
+	 * Additive increase per tick and multiplicative decrease on congestion.
+	 */
+	static const float BUDGET_INCREASE = 8;
+	static const float BUDGET_DECREASE = 0.75f;
+	/**
+	 * Number of sent packets which are remembered. Older packets are
+	 * considered lost.
+	 */
+	static const unsigned int MAX_SENT_UPDATES = 100;
+	/**
+	 * Maximum render delay in ticks a client may claim in EPT_Ready, so that
+	 * clients cannot make the server rewind further than a sensible
+	 * interpolation delay would need.
+	 */
+	static const unsigned int MAX_RENDER_DELAY = 10;
+	/**
+	 * Maximum size of a batch of reliable messages, small enough to fit
+	 * into one UDP packet together with the ENet headers.
+	 */
+	static const unsigned int MAX_BATCH_SIZE = 1200;
+
+	/**
+	 * Drops the reference which an ENet packet holds to its buffer.
+	 */
+	static void releaseBuffer(ENetPacket *packet)
+	{
+		((Buffer*)packet->userData)->drop();
+	}
+
+	/**
+	 * Maximum number of unused packets kept for reuse.
+	 */
+	static const unsigned int MAX_FREE_PACKETS = 4096;
+
+	/**
+	 * Packets are created by the room and worker threads and dropped by the
+	 * network thread, so the free list is shared. It is never destroyed as
+	 * packets might be dropped during shutdown.
+	 */
+	static pthread_mutex_t freepacketmutex = PTHREAD_MUTEX_INITIALIZER;
+	static std::vector<OutgoingPacket*> &getFreePackets()
+	{
+		static std::vector<OutgoingPacket*> *packets =
+			new std::vector<OutgoingPacket*>();
+		return *packets;
+	}
+
+	OutgoingPacketPointer OutgoingPacket::create(BufferPointer buffer,
+		bool reliable)
+	{
+		OutgoingPacket *packet = 0;
+		std::vector<OutgoingPacket*> &freepackets = getFreePackets();
+		pthread_mutex_lock(&freepacketmutex);
+		if (freepackets.size() > 0)
+		{
+			packet = freepackets.back();
+			freepackets.pop_back();
+		}
+		pthread_mutex_unlock(&freepacketmutex);
+		if (!packet)
+			packet = new OutgoingPacket();
+		packet->buffer = buffer;
+		packet->reliable = reliable;
+		return packet;
+	}
+	OutgoingPacket::OutgoingPacket() : reliable(false), packet(0)
+	{
+	}
+	OutgoingPacket::~OutgoingPacket()
+	{
+	}
+
+	bool OutgoingPacket::send(ENetPeer *peer)
+	{
+		bool created = false;
+		if (!packet)
+		{
+			packet = enet_packet_create(buffer->getData(), buffer->getSize(),
+				ENET_PACKET_FLAG_NO_ALLOCATE
+				| (reliable ? ENET_PACKET_FLAG_RELIABLE : 0));
+			buffer->grab();
+			packet->userData = buffer.get();
+			packet->freeCallback = releaseBuffer;
+			packet->referenceCount++;
+			created = true;
+		}
+		enet_peer_send(peer, reliable ? ENC_Reliable : ENC_Updates, packet);
+		return created;
+	}
+	void OutgoingPacket::release()
+	{
+		packet->referenceCount--;
+		if (packet->referenceCount == 0)
+			enet_packet_destroy(packet);
+		packet = 0;
+	}
+
+	void OutgoingPacket::dispose() const
+	{
+		// Return the buffer to its pool right away
+		OutgoingPacket *unused = const_cast<OutgoingPacket*>(this);
+		unused->buffer = 0;
+		std::vector<OutgoingPacket*> &freepackets = getFreePackets();
+		pthread_mutex_lock(&freepacketmutex);
+		if (freepackets.size() < MAX_FREE_PACKETS)
+		{
+			freepackets.push_back(unused);
+			pthread_mutex_unlock(&freepacketmutex);
+			return;
+		}
+		pthread_mutex_unlock(&freepacketmutex);
+		delete this;
+	}
+
 	Client::Client(ENetPeer *peer) : peer(peer)
 	{
+		pthread_mutex_init(&sendmutex, 0);
+		disconnecting = false;
+		room = 0;
 		status = ECS_Connecting;
 		lastreceived = 0;
 		lag = 0;
+		renderdelay = 0;
+		compression = false;
+		statistics = false;
+		for (int i = 0; i < 65535; i++)
+		{
+			active[i] = false;
+			baseline[i] = 0;
+			priority[i] = 0;
+		}
+		budget = INITIAL_BUDGET;
+		minrtt = 0xFFFFFFFF;
+		roundtriptime = peer->roundTripTime;
+		packetloss = peer->packetLoss;
+		backoff = 0;
 	}
 	Client::~Client()
 	{
+		pthread_mutex_destroy(&sendmutex);
 	}
 
 	void Client::setStatus(ClientStatus status)
@@ -44,14 +187,141 @@ namespace backlot
 
 	void Client::send(BufferPointer buffer, bool reliable)
 	{
-		ENetPacket *packet = enet_packet_create(buffer->getData(),
-			buffer->getSize(), reliable?ENET_PACKET_FLAG_RELIABLE:0);
-		enet_peer_send(peer, 0, packet);
+		if (compression)
+		{
+			BufferPointer compressed = PacketCompressor::compress(buffer);
+			if (compressed)
+				buffer = compressed;
+		}
+		sendRaw(buffer, reliable);
+	}
+	void Client::queueReliable(BufferPointer buffer)
+	{
+		outbox.push_back(buffer);
+	}
+	void Client::flushReliable()
+	{
+		unsigned int first = 0;
+		while (first < outbox.size())
+		{
+			// Collect as many messages as fit into one packet
+			unsigned int size = 1;
+			unsigned int last = first;
+			while (last < outbox.size() && (last == first
+				|| size + 2 + outbox[last]->getSize() <= MAX_BATCH_SIZE))
+			{
+				size += 2 + outbox[last]->getSize();
+				last++;
+			}
+			if (last == first + 1)
+			{
+				// A single message does not need the batch header
+				send(outbox[first], true);
+				first = last;
+				continue;
+			}
+			BufferPointer batch = BufferPool::get().allocate();
+			batch->write8(EPT_Batch);
+			for (unsigned int i = first; i < last; i++)
+			{
+				batch->write16(outbox[i]->getSize());
+				batch->writeBits(*outbox[i].get(), outbox[i]->getSize() * 8);
+			}
+			send(batch, true);
+			first = last;
+		}
+		outbox.clear();
+	}
+	void Client::sendRaw(BufferPointer buffer, bool reliable)
+	{
+		sendPacket(OutgoingPacket::create(buffer, reliable));
+	}
+	void Client::sendPacket(OutgoingPacketPointer packet)
+	{
+		pthread_mutex_lock(&sendmutex);
+		sendqueue.push_back(packet);
+		pthread_mutex_unlock(&sendmutex);
+	}
+	void Client::flushSendQueue(std::vector<OutgoingPacketPointer> &created)
+	{
+		pthread_mutex_lock(&sendmutex);
+		for (unsigned int i = 0; i < sendqueue.size(); i++)
+		{
+			if (sendqueue[i]->send(peer))
+				created.push_back(sendqueue[i]);
+		}
+		sendqueue.clear();
+		// ENet updates the statistics while servicing the host, the room
+		// thread only reads these copies
+		roundtriptime = peer->roundTripTime;
+		packetloss = peer->packetLoss;
+		if (disconnecting)
+		{
+			enet_peer_disconnect_later(peer, 0);
+			disconnecting = false;
+		}
+		pthread_mutex_unlock(&sendmutex);
+	}
+	void Client::disconnect()
+	{
+		pthread_mutex_lock(&sendmutex);
+		disconnecting = true;
+		pthread_mutex_unlock(&sendmutex);
+	}
+
+	void Client::setRoom(Room *room)
+	{
+		this->room = room;
+	}
+	Room *Client::getRoom()
+	{
+		return room;
+	}
+
+	void Client::setCompression(bool compression)
+	{
+		this->compression = compression;
+	}
+	bool Client::getCompression()
+	{
+		return compression;
+	}
+	void Client::setStatistics(bool statistics)
+	{
+		this->statistics = statistics;
+	}
+	bool Client::getStatistics()
+	{
+		return statistics;
 	}
 
 	void Client::setAcknowledgedPacket(int time)
 	{
 		lastreceived = time;
+		// Acks are sent unreliably, older packets without an ack might have
+		// been lost
+		while (sentupdates.size() > 0
+			&& (int)sentupdates.front().time < time)
+			sentupdates.pop_front();
+		if (sentupdates.size() == 0 || (int)sentupdates.front().time != time)
+			return;
+		// The client got all entities in this packet up to this time
+		const std::vector<int> &entities = sentupdates.front().entities;
+		for (unsigned int i = 0; i < entities.size(); i++)
+		{
+			if (baseline[entities[i]] < time)
+				baseline[entities[i]] = time;
+		}
+		sentupdates.pop_front();
+	}
+	void Client::addSentUpdate(unsigned int time,
+		const std::vector<int> &entities)
+	{
+		sentupdates.push_back(SentUpdate());
+		sentupdates.back().time = time;
+		sentupdates.back().entities = entities;
+		if (sentupdates.size() > MAX_SENT_UPDATES)
+			sentupdates.pop_front();
 	}
 	int Client::getAcknowledgedPacket()
 	{
@@ -65,6 +335,16 @@ namespace backlot
 	{
 		return lag;
 	}
+	void Client::setRenderDelay(unsigned int delay)
+	{
+		if (delay > MAX_RENDER_DELAY)
+			delay = MAX_RENDER_DELAY;
+		renderdelay = delay;
+	}
+	unsigned int Client::getRenderDelay()
+	{
+		return renderdelay;
+	}
 	void Client::setEntityActive(int entity, bool active)
 	{
 		this->active[entity] = active;
@@ -73,6 +353,55 @@ namespace backlot
 	{
 		return active[entity];
 	}
+	void Client::setEntityBaseline(int entity, int time)
+	{
+		baseline[entity] = time;
+	}
+	int Client::getEntityBaseline(int entity)
+	{
+		return baseline[entity];
+	}
+	float Client::accumulatePriority(int entity, float priority)
+	{
+		this->priority[entity] += priority;
+		return this->priority[entity];
+	}
+	void Client::clearPriority(int entity)
+	{
+		priority[entity] = 0;
+	}
+
+	void Client::updateBudget()
+	{
+		pthread_mutex_lock(&sendmutex);
+		unsigned int rtt = roundtriptime;
+		float loss = (float)packetloss / ENET_PEER_PACKET_LOSS_SCALE;
+		pthread_mutex_unlock(&sendmutex);
+		if (rtt < minrtt)
+			minrtt = rtt;
+		// Packet loss or a growing round trip time mean that we are sending
+		// more than the connection can handle
+		bool congested = loss > 0.02f || rtt > minrtt * 2 + 50;
+		if (backoff > 0)
+			backoff--;
+		if (!congested)
+			budget += BUDGET_INCREASE;
+		else if (backoff == 0)
+		{
+			budget *= BUDGET_DECREASE;
+			// Give the connection one round trip to react before cutting
+			// the budget again
+			backoff = rtt / 20 + 1;
+		}
+		if (budget < MIN_BUDGET)
+			budget = MIN_BUDGET;
+		if (budget > MAX_BUDGET)
+			budget = MAX_BUDGET;
+	}
+	unsigned int Client::getBudget()
+	{
+		return (unsigned int)budget;
+	}
 	void Client::setID(int id)
 	{
 		this->id = id;
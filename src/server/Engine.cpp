@@ -22,10 +22,10 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Engine.hpp"
 #include "Preferences.hpp"
 #include "Server.hpp"
-#include "PathFinder.hpp"
+#include "TickScheduler.hpp"
+#include "Log.hpp"
 
 #include <iostream>
-#include <fstream>
 #include <enet/enet.h>
 #include <sys/stat.h> 
 
@@ -44,12 +44,13 @@ namespace backlot
 	{
 		stopping = false;
 		directory = path;
+		Log::get().init();
 
 		//Check to see if the Gamedir exist
 		struct stat fileinfo;
 		if (stat(getGameDirectory().c_str(), &fileinfo))
 		{
-			std::cerr << "Game directory does not exist!" << std::endl;
+			LOG_ERROR("Game directory does not exist!");
 			return false;
 		}
 		
@@ -57,19 +58,23 @@ namespace backlot
 		Preferences::get().setPath(getGameDirectory() + "/config.xml");
 		if (!Preferences::get().load())
 		{
-			std::cerr << "error: Could not load preferences." << std::endl;
+			LOG_ERROR("Could not load preferences.");
 			return false;
 		}
 		// Show configuration dialog
 		// Start engine
 		if (enet_initialize() != 0)
 		{
-			std::cerr << "error: Could not initialize networking." << std::endl;
+			LOG_ERROR("Could not initialize networking.");
 			return false;
 		}
 		
 		int port = 27272;
 		std::string mapname = "test";
+		unsigned int threads = 0;
+		int maxclients = 32;
+		unsigned int rooms = 1;
+		std::string replay;
 		
 		// Parse command line arguments
 		for (int i = 0; i < int(args.size()); i++)
@@ -85,35 +90,73 @@ namespace backlot
 				i++;
 				port = atoi(args[i].c_str());
 			}
+			if ( ( (option == "--threads") || (option == "-t") ))
+			{
+				i++;
+				threads = atoi(args[i].c_str());
+			}
+			if ( ( (option == "--clients") || (option == "-c") ))
+			{
+				i++;
+				maxclients = atoi(args[i].c_str());
+			}
+			if ( ( (option == "--rooms") || (option == "-r") ))
+			{
+				i++;
+				rooms = atoi(args[i].c_str());
+			}
+			if ( ( (option == "--record") || (option == "-R") ))
+			{
+				i++;
+				replay = args[i];
+			}
+			if ( ( (option == "--debug") || (option == "-d") ))
+			{
+				Log::get().setLevel(ELL_Debug);
+			}
 		}
 		
 		// Start server
-		if (!Server::get().init(port, mapname))
+		if (rooms == 0)
+			rooms = 1;
+		if (!Server::get().init(port, mapname, maxclients, rooms, threads,
+			replay))
 		{
 			return false;
 		}
 		// Main loop
+		Log::get().flush();
 		std::cout << "ready" << std::endl;
-		static std::ofstream fout;
-		fout.open("./server.log");
-		std::cout.rdbuf(fout.rdbuf());
-		std::cerr.rdbuf(fout.rdbuf());
-		std::cout << "Server started." << std::endl;
-		lastframe = getTime();
+		// Nobody reads stdout after this, so everything goes to the log file
+		Log::get().setFile("./server.log");
+		LOG_INFO("Server started.");
+		if (!TickScheduler::get().init(Server::get().getSocket(), 20000))
+		{
+			return false;
+		}
+		// The games run in the threads of the rooms, this thread only
+		// handles the network
 		while (!stopping)
 		{
-			// Game logic
-			if (!Server::get().update())
-				stopping = true;
-			PathFinder::updateAll();
-			// Input handling
-			// TODO
-			// Fixed time step
-			lastframe = lastframe + 20000;
-			uint64_t currenttime = getTime();
-			if (currenttime < lastframe)
-				usleep(lastframe - currenttime);
+			switch (TickScheduler::get().wait())
+			{
+				case ETE_Receive:
+					// Packets are read immediately and passed to the rooms
+					Server::get().receive();
+					TickScheduler::get().onReceived();
+					break;
+				case ETE_Notify:
+					// A room has finished its tick
+					Server::get().flush();
+					break;
+				case ETE_Tick:
+					if (!Server::get().update())
+						stopping = true;
+					break;
+			}
 		}
+		Server::get().destroy();
+		TickScheduler::get().destroy();
 		// Shut down engine
 		enet_deinitialize();
 		return true;
@@ -22,42 +22,82 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "Game.hpp"
 #include "Engine.hpp"
 #include "NetworkData.hpp"
-#include "Server.hpp"
 #include "Timer.hpp"
+#include "TickProfiler.hpp"
 #include "support/tinyxml.h"
+#include "Log.hpp"
+#include "PacketCompressor.hpp"
+#include "BufferPool.hpp"
+#include "ThreadLocal.hpp"
 
-#include <iostream>
+#include <algorithm>
+#include <cmath>
 
 namespace backlot
 {
+	/**
+	 * Only accepts entities with a certain template.
+	 */
+	class TypeFilter : public EntityGrid::Filter
+	{
+		public:
+			TypeFilter(EntityTable &entities, const std::string &type)
+				: entities(entities), type(type)
+			{
+			}
+
+			virtual bool accept(int id)
+			{
+				return entities.get(id)->getTemplate()->getName() == type;
+			}
+		private:
+			EntityTable &entities;
+			const std::string &type;
+	};
+
+	static THREAD_LOCAL Game *currentgame = 0;
+
 	Game &Game::get()
 	{
+		if (currentgame)
+			return *currentgame;
 		static Game game;
 		return game;
 	}
+	void Game::setCurrent(Game *game)
+	{
+		currentgame = game;
+	}
 	Game::~Game()
 	{
+		workers.destroy();
+		pthread_mutex_destroy(&updatecachemutex);
 	}
 
 	bool Game::load(std::string mapname, std::string mode)
 	{
 		lastclientid = 0;
 		this->mapname = mapname;
-		for (int i = 0; i < 65535; i++)
-			entities[i] = 0;
-		maxentityid = 0;
+		entities.clear();
+		// Load map
+		map = ServerMap::get(mapname);
+		if (map.isNull())
+		{
+			LOG_ERROR("Could not load map.");
+			return false;
+		}
 		// Open XML file
 		std::string filename = Engine::get().getGameDirectory() + "/modes/" + mode + ".xml";
 		TiXmlDocument xml(filename.c_str());
 		if (!xml.LoadFile() || xml.Error())
 		{
-			std::cerr << "Could not load XML file " << mode << ".xml: " << xml.ErrorDesc() << std::endl;
+			LOG_ERROR("Could not load XML file " << mode << ".xml: " << xml.ErrorDesc());
 			return false;
 		}
 		TiXmlNode *node = xml.FirstChild("mode");
 		if (!node)
 		{
-			std::cerr << "Parser error: <mode> not found." << std::endl;
+			LOG_ERROR("Parser error: <mode> not found.");
 			return false;
 		}
 		TiXmlElement *root = node->ToElement();
@@ -76,7 +116,7 @@ namespace backlot
 		}
 		if (!playerinfo)
 		{
-			std::cerr << "No player info found!" << std::endl;
+			LOG_ERROR("No player info found!");
 			return false;
 		}
 		double speed = 1.0;
@@ -90,6 +130,18 @@ namespace backlot
 		{
 			playerinfo->Attribute("weaponslots", &weaponslots);
 		}
+		// Read network settings
+		double viewradius = 20.0;
+		double viewhysteresis = 4.0;
+		TiXmlNode *networknode = root->FirstChild("network");
+		if (networknode && networknode->ToElement())
+		{
+			TiXmlElement *network = networknode->ToElement();
+			network->Attribute("viewradius", &viewradius);
+			network->Attribute("hysteresis", &viewhysteresis);
+		}
+		this->viewradius = viewradius;
+		this->viewhysteresis = viewhysteresis;
 		// Load script
 		script = new Script();
 		script->addCoreFunctions();
@@ -118,15 +170,85 @@ namespace backlot
 		}
 		this->mode = mode;
 		time = 0;
+		maxmovement = 0;
+		// Load map entities
+		map->loadEntities();
 		return true;
 	}
 	bool Game::destroy()
 	{
+		stopRecording();
 		clients.clear();
+		// Entities call on_destroy() which might still access the game
+		entities.clear();
+		grid.clear();
 		script = 0;
+		map = 0;
 		return false;
 	}
 
+	MapPointer Game::getMap()
+	{
+		return map.get();
+	}
+
+	void Game::sendToAll(BufferPointer buffer, bool reliable)
+	{
+		std::map<int, Client*>::iterator it;
+		if (reliable)
+		{
+			for (it = clients.begin(); it != clients.end(); it++)
+				it->second->queueReliable(buffer);
+			return;
+		}
+		// Compress the packet only once for all clients which want it, and
+		// share the packets between the clients
+		OutgoingPacketPointer packet;
+		OutgoingPacketPointer compressedpacket;
+		bool triedcompression = false;
+		for (it = clients.begin(); it != clients.end(); it++)
+		{
+			Client *client = it->second;
+			if (client->getCompression())
+			{
+				if (!triedcompression)
+				{
+					BufferPointer compressed;
+					compressed = PacketCompressor::compress(buffer);
+					if (compressed)
+						compressedpacket = OutgoingPacket::create(compressed,
+							false);
+					triedcompression = true;
+				}
+				if (compressedpacket)
+				{
+					client->sendPacket(compressedpacket);
+					continue;
+				}
+			}
+			if (!packet)
+				packet = OutgoingPacket::create(buffer, false);
+			client->sendPacket(packet);
+		}
+	}
+
+	bool Game::setWorkerThreads(unsigned int threads)
+	{
+		return workers.init(threads);
+	}
+
+	bool Game::startRecording(std::string filename)
+	{
+		return recorder.open(filename);
+	}
+	void Game::stopRecording()
+	{
+		if (!recorder.isOpen())
+			return;
+		recorder.writeTick(time, entities);
+		recorder.close();
+	}
+
 	int Game::getTeamCount()
 	{
 		return teamcount;
@@ -147,31 +269,21 @@ namespace backlot
 	EntityPointer Game::addEntityWithState(std::string type, int owner,
 		BufferPointer state)
 	{
-		std::cout << "addEntity" << std::endl;
+		LOG_DEBUG("addEntity");
 		// Get entity template
 		EntityTemplatePointer tpl = EntityTemplate::get(type);
 		if (tpl.isNull())
 		{
-			std::cerr << "Could not get entity template \"" << type << "\"." << std::endl;
+			LOG_ERROR("Could not get entity template \"" << type << "\".");
 			return 0;
 		}
 		// Get new entity id
-		int newindex = 65535;
-		for (int id = 0; id < 65535; id++)
+		int newindex = entities.allocateID();
+		if (newindex == -1)
 		{
-			if (entities[id].isNull())
-			{
-				newindex = id;
-				break;
-			}
-		}
-		if (newindex == 65535)
-		{
-			std::cerr << "Too many entities." << std::endl;
+			LOG_ERROR("Too many entities.");
 			return 0;
 		}
-		if (newindex > maxentityid)
-			maxentityid = newindex;
 		// Create entity
 		EntityPointer entity = new Entity();
 		entity->setID(newindex);
@@ -180,47 +292,51 @@ namespace backlot
 		// Set owner
 		// TODO
 		// Insert entity into list
-		entities[newindex] = entity;
+		entities.insert(entity);
+		if (entity->isMovable())
+			grid.update(entity->getID(), entity->getRectangle());
 		// Send entity to all connected clients
-		BufferPointer buffer = new Buffer();
+		BufferPointer buffer = BufferPool::get().allocate();
 		buffer->write8(EPT_EntityCreated);
 		buffer->write16(newindex);
 		buffer->write16(owner);
 		buffer->writeString(type);
 		entity->getState(buffer);
-		Server::get().sendToAll(buffer, true);
-		// Set to active on all clients
+		sendToAll(buffer, true);
+		recorder.addCreated(entity);
+		// Set to active on all clients. Changes made in this tick after the
+		// state was written are sent with the next update.
 		std::map<int, Client*>::iterator it = clients.begin();
 		while (it != clients.end())
 		{
 			it->second->setEntityActive(newindex, true);
+			it->second->setEntityBaseline(newindex, time - 1);
+			it->second->clearPriority(newindex);
 			it++;
 		}
 		return entity;
 	}
 	void Game::removeEntity(EntityPointer entity)
 	{
-		// Look for entity to delete
-		for (int i = 0; i < maxentityid + 1; i++)
-		{
-			if (entities[i] == entity)
-			{
-				// Send message to all connected clients
-				BufferPointer buffer = new Buffer();
-				buffer->write8(EPT_EntityDeleted);
-				buffer->write16(i);
-				Server::get().sendToAll(buffer, true);
-				// Delete entity
-				entities[i] = 0;
-				break;
-			}
-		}
+		if (entity.isNull())
+			return;
+		int id = entity->getID();
+		if (!(entities.get(id) == entity))
+			return;
+		// Send message to all connected clients
+		BufferPointer buffer = BufferPool::get().allocate();
+		buffer->write8(EPT_EntityDeleted);
+		buffer->write16(id);
+		sendToAll(buffer, true);
+		recorder.addDeleted(id);
+		// Delete entity
+		grid.remove(id);
+		entities.remove(id);
+		entities.releaseID(id);
 	}
 	EntityPointer Game::getEntity(int id)
 	{
-		if (id >= 65535)
-			return 0;
-		return entities[id];
+		return entities.get(id);
 	}
 	void Game::registerForDeletion(int id)
 	{
@@ -238,28 +354,31 @@ namespace backlot
 		int id = ++lastclientid;
 		msg->write16(id);
 		client->setID(id);
+		// Supported protocol features
+		msg->write8(ENF_Compression | ENF_Statistics);
 		// Send packet
 		client->send(msg, true);
 		return true;
 	}
 	void Game::addClient(Client *client)
 	{
-		std::cout << "New client." << std::endl;
+		LOG_INFO("New client.");
 		// Add to client list
 		clients.insert(std::pair<int, Client*>(client->getID(), client));
 		// Send entities
-		for (int i = 0; i < maxentityid + 1; i++)
+		for (unsigned int i = 0; i < entities.getSize(); i++)
 		{
-			if (entities[i])
-			{
-				BufferPointer buffer = new Buffer();
-				buffer->write8(EPT_EntityCreated);
-				buffer->write16(i);
-				buffer->write16(entities[i]->getOwner());
-				buffer->writeString(entities[i]->getTemplate()->getName());
-				entities[i]->getState(buffer);
-				client->send(buffer, true);
-			}
+			EntityPointer entity = entities.getEntity(i);
+			BufferPointer buffer = new Buffer();
+			buffer->write8(EPT_EntityCreated);
+			buffer->write16(entity->getID());
+			buffer->write16(entity->getOwner());
+			buffer->writeString(entity->getTemplate()->getName());
+			entity->getState(buffer);
+			client->queueReliable(buffer);
+			client->setEntityActive(entity->getID(), true);
+			client->setEntityBaseline(entity->getID(), time - 1);
+			client->clearPriority(entity->getID());
 		}
 		// Script callback
 		if (script->isFunction("on_new_client"))
@@ -285,25 +404,35 @@ namespace backlot
 		if (clientid == -1)
 			return;
 		// Remove entities
-		for (int i = 0; i < maxentityid + 1; i++)
-		{
-			if (entities[i] && entities[i]->getOwner() == clientid)
-			{
-				removeEntity(entities[i]);
-			}
-		}
+		std::vector<EntityPointer> owned = entities.getOwnedEntities(clientid);
+		for (unsigned int i = 0; i < owned.size(); i++)
+			removeEntity(owned[i]);
 	}
 
 	unsigned int Game::getTime()
 	{
 		return time;
 	}
+	unsigned int Game::getLagCompensatedTime(int client)
+	{
+		std::map<int, Client*>::iterator it = clients.find(client);
+		if (it == clients.end())
+			return time;
+		// The client saw the other entities later than its own input by
+		// the interpolation delay
+		int rewind = it->second->getLag() + it->second->getRenderDelay();
+		if (rewind <= 0)
+			return time;
+		if ((unsigned int)rewind > time)
+			return clampHistoryTick(0);
+		return clampHistoryTick(time - rewind);
+	}
 
 	void Game::injectUpdates(Client *client, BufferPointer buffer)
 	{
 		// Get client time step to which this update belongs to
 		unsigned int updatetime = buffer->read32();
-		std::cout << "Client update: " << updatetime << std::endl;
+		LOG_DEBUG("Client update: " << updatetime);
 		while (1)
 		{
 			// Get entity
@@ -311,27 +440,48 @@ namespace backlot
 			if (!entityid)
 				break;
 			entityid--;
-			if (entities[entityid].isNull())
+			EntityPointer entity = entities.get(entityid);
+			if (entity.isNull())
 			{
-				std::cout << "Entity " << entityid << " not available." << std::endl;
+				LOG_DEBUG("Entity " << entityid << " not available.");
 				return;
 			}
-			EntityPointer entity = entities[entityid];
 			if (entity->getOwner() != client->getID())
 				return;
 			// Apply update
-			std::cout << "Updating entity." << std::endl;
+			LOG_DEBUG("Updating entity.");
 			entity->applyUpdate(buffer);
 			break;
 		}
 		// Ack updates.
-		BufferPointer received = new Buffer();
+		BufferPointer received = BufferPool::get().allocate();
 		received->write8(EPT_UpdateReceived);
 		received->write32(updatetime);
 		received->write16(time - updatetime);
 		client->send(received);
 		client->setLag(time - updatetime);
 	}
+	void Game::injectInput(Client *client, BufferPointer buffer)
+	{
+		unsigned int clienttime = buffer->read32();
+		unsigned int sequence = buffer->read32();
+		// Input is not acknowledged, so the lag is measured here as well
+		client->setLag(time - clienttime);
+		while (1)
+		{
+			int entityid = buffer->read16();
+			if (!entityid)
+				break;
+			entityid--;
+			// The commands cannot be parsed without the entity
+			EntityPointer entity = entities.get(entityid);
+			if (entity.isNull() || entity->getOwner() != client->getID())
+				return;
+			unsigned int count = buffer->read8();
+			for (unsigned int i = 0; i < count; i++)
+				entity->queueInput(sequence - count + 1 + i, buffer);
+		}
+	}
 
 	CollisionInfo Game::getCollision(Vector2F from, Vector2F to,
 		float maxheight)
@@ -342,28 +492,91 @@ namespace backlot
 		collision.entity = 0;
 		collision.point = Vector2F();
 		// Check map collision
-		if (!Server::get().getMap()->isAccessible(from, to, maxheight,
+		if (!map->isAccessible(from, to, maxheight,
 			&collision.point))
 		{
 			collision.collision = true;
 		}
 		return collision;
 	}
-	EntityListPointer Game::getEntities(RectangleF area, std::string type)
+	CollisionInfo Game::getCollision(Vector2F from, Vector2F to,
+		float maxheight, unsigned int tick)
 	{
-		EntityListPointer list = new EntityList();
-		for (int i = 0; i < maxentityid + 1; i++)
+		return getCollision(from, to, maxheight, tick, "", -1);
+	}
+	CollisionInfo Game::getCollision(Vector2F from, Vector2F to,
+		float maxheight, unsigned int tick, const std::string &type,
+		int ignore)
+	{
+		CollisionInfo collision = getCollision(from, to, maxheight);
+		// Entities behind the map collision cannot be hit
+		Vector2F end = collision.collision ? collision.point : to;
+		tick = clampHistoryTick(tick);
+		RectangleF line(from, Vector2F());
+		line.insertPoint(end);
+		grid.query(getHistorySearchArea(line, tick), queryresult);
+		float nearest = (end - from).getLengthSquared();
+		for (unsigned int i = 0; i < queryresult.size(); i++)
 		{
-			if (entities[i] && entities[i]->isMovable())
+			if (queryresult[i] == ignore)
+				continue;
+			const EntityPointer &entity = entities.get(queryresult[i]);
+			if (type != "" && entity->getTemplate()->getName() != type)
+				continue;
+			RectangleF rectangle;
+			if (!entity->getPastRectangle(tick, rectangle))
+				continue;
+			Vector2F point = from;
+			if (!rectangle.contains(from))
 			{
-				// Check type if necessary
-				if (type != "" &&  entities[i]->getTemplate()->getName() != type)
+				Vector2F exit;
+				if (!rectangle.getIntersections(Line(from, end), point, exit))
 					continue;
-				// Check bounding rectangle
-				RectangleF br = entities[i]->getRectangle();
-				if (br.overlapsWith(area))
-					list->addEntity(entities[i]);
 			}
+			float distance = (point - from).getLengthSquared();
+			if (distance > nearest)
+				continue;
+			nearest = distance;
+			collision.collision = true;
+			collision.entitycollision = true;
+			collision.entity = entity;
+			collision.point = point;
+		}
+		return collision;
+	}
+	EntityListPointer Game::getEntities(RectangleF area, std::string type)
+	{
+		EntityListPointer list = new EntityList();
+		grid.query(area, queryresult);
+		for (unsigned int i = 0; i < queryresult.size(); i++)
+		{
+			EntityPointer entity = entities.get(queryresult[i]);
+			// Check type if necessary
+			if (type != "" &&  entity->getTemplate()->getName() != type)
+				continue;
+			// The grid also returns rectangles which only touch the area
+			RectangleF br = entity->getRectangle();
+			if (br.overlapsWith(area))
+				list->addEntity(entity);
+		}
+		return list;
+	}
+	EntityListPointer Game::getEntities(RectangleF area,
+		const std::string &type, unsigned int tick)
+	{
+		EntityListPointer list = new EntityList();
+		tick = clampHistoryTick(tick);
+		grid.query(getHistorySearchArea(area, tick), queryresult);
+		for (unsigned int i = 0; i < queryresult.size(); i++)
+		{
+			const EntityPointer &entity = entities.get(queryresult[i]);
+			if (type != "" &&  entity->getTemplate()->getName() != type)
+				continue;
+			RectangleF rectangle;
+			if (!entity->getPastRectangle(tick, rectangle))
+				continue;
+			if (rectangle.overlapsWith(area))
+				list->addEntity(entity);
 		}
 		return list;
 	}
@@ -374,84 +587,343 @@ namespace backlot
 	EntityListPointer Game::getEntities(std::string type)
 	{
 		EntityListPointer list = new EntityList();
-		for (int i = 0; i < maxentityid + 1; i++)
+		for (unsigned int i = 0; i < entities.getSize(); i++)
 		{
-			if (entities[i] && entities[i]->getTemplate()->getName() == type)
-			{
-				list->addEntity(entities[i]);
-			}
+			const EntityPointer &entity = entities.getEntity(i);
+			if (entity->getTemplate()->getName() == type)
+				list->addEntity(entity);
+		}
+		return list;
+	}
+	EntityListPointer Game::getEntitiesInRadius(Vector2F center,
+		float radius, std::string type)
+	{
+		EntityListPointer list = new EntityList();
+		grid.queryRadius(center, radius, queryresult);
+		for (unsigned int i = 0; i < queryresult.size(); i++)
+		{
+			EntityPointer entity = entities.get(queryresult[i]);
+			if (type != "" &&  entity->getTemplate()->getName() != type)
+				continue;
+			list->addEntity(entity);
 		}
 		return list;
 	}
+	EntityPointer Game::getNearestEntity(Vector2F position,
+		float maxdistance, std::string type)
+	{
+		if (type == "")
+			return entities.get(grid.getNearest(position, maxdistance));
+		TypeFilter filter(entities, type);
+		return entities.get(grid.getNearest(position, maxdistance, &filter));
+	}
+
+	void Game::onEntityMoved(Entity *entity)
+	{
+		// Entities change their position while they are created, they are
+		// added to the grid once they are in the entity table
+		int id = entity->getID();
+		if (entities.get(id).get() != entity)
+			return;
+		grid.update(id, entity->getRectangle());
+	}
 
 	void Game::update()
 	{
+		// Record the last tick. This is done here and not at the end of the
+		// last update as the client packets handled in between change the
+		// entities with the time of the last tick.
+		TickProfiler &profiler = TickProfiler::get();
+		if (recorder.isOpen())
+		{
+			uint64_t recordstart = Engine::getTime();
+			if (recorder.writeTick(time, entities))
+				profiler.markKeyframe();
+			profiler.addTime(ETP_Replay, recordstart);
+		}
 		// Increase tick counter
 		time++;
-		// Update entities
-		for (int i = 0; i < maxentityid + 1; i++)
+		// Apply the input of the clients. The scripts might create or
+		// delete entities, so the list is copied first.
+		std::map<int, Client*>::iterator it;
+		for (it = clients.begin(); it != clients.end(); it++)
 		{
-			if (entities[i])
-				entities[i]->update();
+			inputentities = entities.getOwnedEntities(it->first);
+			for (unsigned int i = 0; i < inputentities.size(); i++)
+				inputentities[i]->applyInput();
 		}
+		inputentities.clear();
+		// Update entities. Scripts can remove any entity, which reorders the
+		// entity table, so the list is copied as well. Entities removed by
+		// an earlier update are skipped.
+		updateentities = entities.getEntities();
+		for (unsigned int i = 0; i < updateentities.size(); i++)
+		{
+			EntityPointer entity = updateentities[i];
+			if (entities.get(entity->getID()).get() != entity.get())
+				continue;
+			entity->update();
+		}
+		updateentities.clear();
 		// Delete entities in the deletion queue
+		uint64_t start = Engine::getTime();
 		while (deletionqueue.size() > 0)
 		{
 			int id = deletionqueue.front();
 			deletionqueue.pop();
 			removeEntity(getEntity(id));
 		}
+		start = profiler.addTime(ETP_Entities, start);
 		// Timer callbacks
 		Timer::callCallbacks();
-		// Send updates to all clients
-		std::map<int, Client*>::iterator it = clients.begin();
-		while (it != clients.end())
+		start = profiler.addTime(ETP_Timers, start);
+		// Remember where the entities were at the end of this tick for lag
+		// compensation. Jumps like respawns do not count as movement.
+		for (unsigned int i = 0; i < entities.getSize(); i++)
 		{
-			Client *client = it->second;
-			int from = client->getAcknowledgedPacket();
-			std::cerr << "Time: " << from << " (currently: " << time << ")." << std::endl;
-			BufferPointer buffer = new Buffer();
-			buffer->write8(EPT_Update);
-			buffer->write32(time);
-			buffer->write32(client->getLag());
-			// Check all entities
-			for (int i = 0; i < maxentityid + 1; i++)
+			const EntityPointer &entity = entities.getEntity(i);
+			if (!entity->isMovable())
+				continue;
+			float movement = entity->recordHistory(time);
+			if (movement > maxmovement && movement < 1.0f)
+				maxmovement = movement;
+		}
+		start = profiler.addTime(ETP_Entities, start);
+		// Encode the updates for all clients, possibly in parallel
+		if (updatecache.size() < entities.getSize())
+			updatecache.resize(entities.getSize());
+		for (unsigned int i = 0; i < updatecache.size(); i++)
+			updatecache[i].clear();
+		clientupdates.resize(clients.size());
+		unsigned int index = 0;
+		for (std::map<int, Client*>::iterator it = clients.begin();
+			it != clients.end(); it++, index++)
+			clientupdates[index].client = it->second;
+		workers.run(encodeUpdateTask, this, clientupdates.size());
+		// Send the packets, ENet may only be used from this thread
+		for (unsigned int i = 0; i < clientupdates.size(); i++)
+		{
+			clientupdates[i].client->send(clientupdates[i].packet);
+			clientupdates[i].packet = 0;
+		}
+		profiler.addTime(ETP_Encode, start);
+	}
+
+	void Game::encodeUpdateTask(unsigned int index, void *game)
+	{
+		Game *self = (Game*)game;
+		self->encodeUpdate(self->clientupdates[index]);
+	}
+	void Game::encodeUpdate(ClientUpdate &update)
+	{
+		Client *client = update.client;
+		int clientid = client->getID();
+		client->updateBudget();
+		// The budget limits the packet size, so the buffer never has to grow
+		BufferPointer buffer;
+		buffer = BufferPool::get().allocate(client->getBudget());
+		buffer->write8(EPT_Update);
+		buffer->write32(time);
+		buffer->write32(client->getLag());
+		// Collect the positions the client is looking from
+		update.viewpoints.clear();
+		const std::vector<EntityPointer> &owned = entities.getOwnedEntities(clientid);
+		for (unsigned int i = 0; i < owned.size(); i++)
+		{
+			if (owned[i]->isMovable())
+				update.viewpoints.push_back(owned[i]->getPosition());
+		}
+		// Check all entities
+		update.candidates.clear();
+		for (unsigned int index = 0; index < entities.getSize(); index++)
+		{
+			const EntityPointer &entity = entities.getEntity(index);
+			int i = entity->getID();
+			bool currentlyactive = client->isEntityActive(i);
+			float distance = getViewDistance(update, entity);
+			bool active = isRelevant(update, entity, distance,
+				currentlyactive);
+			if (active)
 			{
-				if (entities[i].isNull())
+				if (!currentlyactive)
+				{
+					// Activate object, the client gets the complete
+					// current state as it missed all changes in between
+					BufferPointer activate = BufferPool::get().allocate();
+					activate->write8(EPT_ActivateEntity);
+					activate->write16(i);
+					BufferPointer state = getEncodedUpdate(index, -1,
+						clientid);
+					activate->writeBits(*state.get(), state->getPosition());
+					client->queueReliable(activate);
+					client->setEntityActive(i, true);
+					client->setEntityBaseline(i, time);
+					client->clearPriority(i);
 					continue;
-				bool currentlyactive = client->isEntityActive(i);
-				// TODO
-				bool active = true;
-				if (active)
+				}
+				// Queue all changes the client has not acknowledged yet
+				if (entity->hasChanged(client->getEntityBaseline(i)))
 				{
-					if (!currentlyactive)
-					{
-						// Activate object
-						// TODO
-					}
-					// Add update to the packet
-					if (entities[i]->hasChanged(from))
-					{
-						buffer->write16(i + 1);
-						entities[i]->getUpdate(from, buffer, it->first);
-					}
+					UpdateCandidate candidate;
+					candidate.index = index;
+					candidate.priority = client->accumulatePriority(i,
+						getUpdatePriority(client, entity, distance));
+					update.candidates.push_back(candidate);
 				}
-				else
+			}
+			else
+			{
+				if (currentlyactive)
 				{
-					if (currentlyactive)
-					{
-						// Deactivate object
-						// TODO
-					}
+					// Deactivate object
+					BufferPointer deactivate = BufferPool::get().allocate();
+					deactivate->write8(EPT_DeactivateEntity);
+					deactivate->write16(i);
+					client->queueReliable(deactivate);
+					client->setEntityActive(i, false);
 				}
 			}
-			// Send updates
-			client->send(buffer);
-			it++;
 		}
+		// Add the most important updates which fit into the budget. The
+		// others keep their accumulated priority and are sent in one of
+		// the next ticks.
+		std::sort(update.candidates.begin(), update.candidates.end());
+		unsigned int budget = client->getBudget() * 8;
+		update.sententities.clear();
+		for (unsigned int c = 0; c < update.candidates.size(); c++)
+		{
+			unsigned int index = update.candidates[c].index;
+			int i = entities.getEntity(index)->getID();
+			BufferPointer encoded = getEncodedUpdate(index,
+				client->getEntityBaseline(i), clientid);
+			if (update.sententities.size() > 0 && buffer->getPosition() + 16
+				+ encoded->getPosition() > budget)
+				continue;
+			buffer->write16(i + 1);
+			buffer->writeBits(*encoded.get(), encoded->getPosition());
+			client->clearPriority(i);
+			update.sententities.push_back(i);
+		}
+		client->addSentUpdate(time, update.sententities);
+		update.packet = buffer;
+	}
+
+	bool Game::isRelevant(ClientUpdate &update,
+		const EntityPointer &entity, float distance, bool currentlyactive)
+	{
+		// Own entities and entities without any position are always sent
+		if (entity->getOwner() == update.client->getID()
+			|| !entity->isMovable())
+			return true;
+		// Clients without any entities (spectators) see the whole world
+		if (update.viewpoints.size() == 0 || viewradius <= 0)
+			return true;
+		float radius = viewradius;
+		if (currentlyactive)
+			radius += viewhysteresis;
+		return distance <= radius;
+	}
+	float Game::getViewDistance(ClientUpdate &update,
+		const EntityPointer &entity)
+	{
+		const std::vector<Vector2F> &viewpoints = update.viewpoints;
+		if (!entity->isMovable() || viewpoints.size() == 0)
+			return 0;
+		Vector2F position = entity->getPosition();
+		float mindistance = (position - viewpoints[0]).getLengthSquared();
+		for (unsigned int i = 1; i < viewpoints.size(); i++)
+		{
+			float distance = (position - viewpoints[i]).getLengthSquared();
+			if (distance < mindistance)
+				mindistance = distance;
+		}
+		return sqrt(mindistance);
+	}
+	float Game::getUpdatePriority(Client *client, const EntityPointer &entity,
+		float distance)
+	{
+		float priority = entity->getPriority();
+		if (entity->getOwner() == client->getID())
+			return priority * 4;
+		// Halve the priority at the view radius
+		if (viewradius > 0)
+			priority *= viewradius / (viewradius + distance);
+		return priority;
+	}
+
+	/**
+	 * Returns the index of the cached update with the given baseline or -1.
+	 */
+	static int findCachedUpdate(const std::vector<UpdateCacheEntry> &cached,
+		int from, bool local)
+	{
+		for (unsigned int i = 0; i < cached.size(); i++)
+		{
+			if (cached[i].from == from && cached[i].local == local)
+				return i;
+		}
+		return -1;
+	}
+
+	BufferPointer Game::getEncodedUpdate(unsigned int index, int from,
+		int client)
+	{
+		const EntityPointer &entity = entities.getEntity(index);
+		bool local = entity->getOwner() == client;
+		// Usually there are only a few different baselines per entity, so
+		// the list is searched linearly
+		std::vector<UpdateCacheEntry> &cached = updatecache[index];
+		pthread_mutex_lock(&updatecachemutex);
+		int found = findCachedUpdate(cached, from, local);
+		if (found != -1)
+		{
+			BufferPointer update = cached[found].update;
+			pthread_mutex_unlock(&updatecachemutex);
+			return update;
+		}
+		pthread_mutex_unlock(&updatecachemutex);
+		// Encode the update once for all clients with this baseline. Two
+		// threads might do this at the same time, then the first one wins.
+		BufferPointer update = BufferPool::get().allocate();
+		entity->getUpdate(from, update, client);
+		pthread_mutex_lock(&updatecachemutex);
+		found = findCachedUpdate(cached, from, local);
+		if (found != -1)
+			update = cached[found].update;
+		else
+		{
+			UpdateCacheEntry entry;
+			entry.from = from;
+			entry.local = local;
+			entry.update = update;
+			cached.push_back(entry);
+		}
+		pthread_mutex_unlock(&updatecachemutex);
+		return update;
+	}
+
+	unsigned int Game::clampHistoryTick(unsigned int tick)
+	{
+		if (tick > time)
+			return time;
+		if (time - tick >= Entity::HISTORY_SIZE)
+			return time - Entity::HISTORY_SIZE + 1;
+		return tick;
+	}
+	RectangleF Game::getHistorySearchArea(const RectangleF &area,
+		unsigned int tick)
+	{
+		// The grid only knows the current positions, so search everywhere
+		// the entities might have moved since then
+		float margin = maxmovement * (time - tick);
+		return RectangleF(area.x - margin, area.y - margin,
+			area.width + 2 * margin, area.height + 2 * margin);
 	}
 
 	Game::Game()
 	{
+		time = 0;
+		maxmovement = 0;
+		pthread_mutex_init(&updatecachemutex, 0);
 	}
 }
@@ -0,0 +1,357 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "ReplayRecorder.hpp"
+#include "Engine.hpp"
+#include "Log.hpp"
+
+#include <cstring>
+
+#if !defined(_MSC_VER) && !defined(_WINDOWS_) && !defined(_WIN32)
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace backlot
+{
+	ReplayRecorder::ReplayRecorder()
+	{
+		file = -1;
+		index = 0;
+		window = 0;
+		windowoffset = 0;
+		windowsize = 0;
+		length = 0;
+		keyframeinterval = 250;
+		changed = false;
+		budget = 400;
+		keyframeposition = 0;
+		keyframeoffset = 0;
+	}
+	ReplayRecorder::~ReplayRecorder()
+	{
+		close();
+	}
+
+	bool ReplayRecorder::open(std::string filename,
+		unsigned int keyframeinterval)
+	{
+		close();
+		#if !defined(_MSC_VER) && !defined(_WINDOWS_) && !defined(_WIN32)
+		if (keyframeinterval == 0)
+			keyframeinterval = 1;
+		this->keyframeinterval = keyframeinterval;
+		file = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (file == -1)
+		{
+			LOG_ERROR("Could not create replay file " << filename << ".");
+			return false;
+		}
+		index = fopen((filename + ".idx").c_str(), "wb");
+		if (!index)
+		{
+			LOG_ERROR("Could not create replay index " << filename << ".idx.");
+			close();
+			return false;
+		}
+		length = 0;
+		// Write file header
+		BufferPointer header = new Buffer();
+		for (unsigned int i = 0; i < 4; i++)
+			header->write8(REPLAY_MAGIC[i]);
+		header->write32(REPLAY_VERSION);
+		header->write32(20000);
+		header->write32(keyframeinterval);
+		if (!append(header->getData(), REPLAY_HEADER_SIZE))
+		{
+			close();
+			return false;
+		}
+		record = new Buffer();
+		record->setSize(REPLAY_RECORD_HEADER_SIZE);
+		clearRecord();
+		keyframeentities.clear();
+		keyframeposition = 0;
+		keyframepending.assign(EntityTable::MAX_ENTITIES, false);
+		LOG_INFO("Recording replay to " << filename << ".");
+		return true;
+		#else
+		LOG_ERROR("Replays are not supported on this platform.");
+		return false;
+		#endif
+	}
+	void ReplayRecorder::close()
+	{
+		#if !defined(_MSC_VER) && !defined(_WINDOWS_) && !defined(_WIN32)
+		if (window)
+		{
+			munmap(window, windowsize);
+			window = 0;
+		}
+		windowoffset = 0;
+		windowsize = 0;
+		if (file != -1)
+		{
+			// Remove the unused part of the last window
+			if (ftruncate(file, length))
+				LOG_WARNING("Could not truncate the replay file.");
+			::close(file);
+			file = -1;
+		}
+		#endif
+		if (index)
+		{
+			fclose(index);
+			index = 0;
+		}
+		record = 0;
+		keyframeentities.clear();
+		keyframeposition = 0;
+	}
+	bool ReplayRecorder::isOpen()
+	{
+		return file != -1;
+	}
+
+	void ReplayRecorder::setBudget(unsigned int budget)
+	{
+		this->budget = budget;
+	}
+
+	void ReplayRecorder::addCreated(const EntityPointer &entity)
+	{
+		if (file == -1)
+			return;
+		writeCreated(entity);
+	}
+	void ReplayRecorder::addDeleted(int id)
+	{
+		if (file == -1)
+			return;
+		record->write8(ERC_Deleted);
+		record->write16(id);
+		changed = true;
+		// The ID can be reused before the keyframe reaches it
+		keyframepending[id] = false;
+	}
+	bool ReplayRecorder::writeTick(unsigned int tick, EntityTable &entities)
+	{
+		if (file == -1)
+			return false;
+		uint64_t start = Engine::getTime();
+		bool keyframe = keyframeposition < keyframeentities.size();
+		// A new keyframe is only started once the last one is complete
+		if (!keyframe && tick % keyframeinterval == 0)
+		{
+			// The record already contains the creations and deletions of
+			// this tick
+			uint64_t offset = length;
+			unsigned int changes = record->getPosition() / 8;
+			startKeyframe(entities);
+			if (writeKeyframe(entities, start))
+			{
+				// The keyframe replaces the changes of the tick
+				char *data = (char*)record->getData();
+				unsigned int size = record->getPosition() / 8 - changes;
+				memmove(data + REPLAY_RECORD_HEADER_SIZE, data + changes,
+					size);
+				record->setPosition((REPLAY_RECORD_HEADER_SIZE + size) * 8);
+				// The index is only written once the keyframe is in the file
+				if (writeRecord(tick, ERT_Keyframe))
+					writeIndex(tick, offset);
+				return true;
+			}
+			// The other entities follow in the next ticks, so the record
+			// also has to contain the changes like a delta
+			keyframeoffset = offset;
+			writeUpdates(tick, entities);
+			writeRecord(tick, ERT_KeyframeStart);
+			return true;
+		}
+		writeUpdates(tick, entities);
+		bool complete = keyframe && writeKeyframe(entities, start);
+		// Ticks without any changes are left out
+		if (!changed)
+			return keyframe;
+		if (writeRecord(tick, ERT_Delta) && complete)
+			writeIndex(tick, keyframeoffset);
+		return keyframe;
+	}
+
+	void ReplayRecorder::startKeyframe(EntityTable &entities)
+	{
+		keyframeentities.clear();
+		for (unsigned int i = 0; i < entities.getSize(); i++)
+		{
+			int id = entities.getEntity(i)->getID();
+			keyframeentities.push_back(id);
+			keyframepending[id] = true;
+		}
+		keyframeposition = 0;
+	}
+	bool ReplayRecorder::writeKeyframe(EntityTable &entities, uint64_t start)
+	{
+		// The keyframe has to be complete after half of the interval even if
+		// the deltas alone already take longer than the budget
+		unsigned int minimum = keyframeentities.size() * 2 / keyframeinterval
+			+ 1;
+		unsigned int written = 0;
+		while (keyframeposition < keyframeentities.size())
+		{
+			int id = keyframeentities[keyframeposition];
+			keyframeposition++;
+			// Entities deleted in the meantime are skipped
+			if (!keyframepending[id])
+				continue;
+			keyframepending[id] = false;
+			writeCreated(entities.get(id));
+			written++;
+			if (written >= minimum && Engine::getTime() - start > budget)
+				break;
+		}
+		return keyframeposition == keyframeentities.size();
+	}
+	void ReplayRecorder::writeUpdates(unsigned int tick,
+		EntityTable &entities)
+	{
+		// Properties changed in this tick
+		for (unsigned int i = 0; i < entities.getSize(); i++)
+		{
+			const EntityPointer &entity = entities.getEntity(i);
+			if (!entity->hasChanged((int)tick - 1))
+				continue;
+			int id = entity->getID();
+			if (!keyframepending[id])
+			{
+				record->write8(ERC_Update);
+				record->write16(id);
+				// -1 is no client, so all properties are written
+				entity->getUpdate((int)tick - 1, record, -1);
+				record->nextByte();
+			}
+			else
+			{
+				// The size is filled in afterwards so that readers which do
+				// not know the entity yet can skip the update
+				record->write8(ERC_PendingUpdate);
+				record->write16(id);
+				unsigned int sizeposition = record->getPosition();
+				record->write16(0);
+				entity->getUpdate((int)tick - 1, record, -1);
+				record->nextByte();
+				unsigned int end = record->getPosition();
+				record->setPosition(sizeposition);
+				record->write16((end - sizeposition) / 8 - 2);
+				record->setPosition(end);
+			}
+			changed = true;
+		}
+	}
+	void ReplayRecorder::writeCreated(const EntityPointer &entity)
+	{
+		record->write8(ERC_Created);
+		record->write16(entity->getID());
+		record->write16(entity->getOwner());
+		record->writeString(entity->getTemplate()->getName());
+		entity->getState(record);
+		record->nextByte();
+		changed = true;
+	}
+	void ReplayRecorder::writeIndex(unsigned int tick, uint64_t offset)
+	{
+		BufferPointer entry = new Buffer();
+		entry->write32(tick);
+		entry->write32(offset >> 32);
+		entry->write32(offset & 0xFFFFFFFF);
+		fwrite(entry->getData(), REPLAY_INDEX_ENTRY_SIZE, 1, index);
+		fflush(index);
+	}
+	bool ReplayRecorder::writeRecord(unsigned int tick, ReplayRecordType type)
+	{
+		record->write8(ERC_End);
+		unsigned int size = record->getPosition() / 8;
+		record->setPosition(0);
+		record->write32(tick);
+		record->write8(type);
+		record->write32(size - REPLAY_RECORD_HEADER_SIZE);
+		bool result = append(record->getData(), size);
+		clearRecord();
+		if (!result)
+		{
+			LOG_ERROR("Could not write to the replay file, stopping.");
+			close();
+		}
+		return result;
+	}
+	void ReplayRecorder::clearRecord()
+	{
+		record->setPosition(REPLAY_RECORD_HEADER_SIZE * 8);
+		changed = false;
+	}
+	bool ReplayRecorder::append(const void *data, unsigned int size)
+	{
+		if (length + size > windowoffset + windowsize)
+		{
+			if (!mapWindow(length, size))
+				return false;
+		}
+		memcpy(window + (length - windowoffset), data, size);
+		length += size;
+		return true;
+	}
+	bool ReplayRecorder::mapWindow(uint64_t offset, unsigned int size)
+	{
+		#if !defined(_MSC_VER) && !defined(_WINDOWS_) && !defined(_WIN32)
+		if (window)
+		{
+			munmap(window, windowsize);
+			window = 0;
+		}
+		// The window has to start at a page boundary
+		uint64_t pagesize = sysconf(_SC_PAGESIZE);
+		uint64_t start = offset - offset % pagesize;
+		unsigned int mapsize = WINDOW_SIZE;
+		while (start + mapsize < offset + size)
+			mapsize *= 2;
+		if (ftruncate(file, start + mapsize))
+		{
+			LOG_ERROR("Could not grow the replay file.");
+			return false;
+		}
+		void *mapped = mmap(0, mapsize, PROT_READ | PROT_WRITE, MAP_SHARED,
+			file, start);
+		if (mapped == MAP_FAILED)
+		{
+			LOG_ERROR("Could not map the replay file.");
+			return false;
+		}
+		window = (char*)mapped;
+		windowoffset = start;
+		windowsize = mapsize;
+		return true;
+		#else
+		return false;
+		#endif
+	}
+}
@@ -0,0 +1,310 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "Room.hpp"
+#include "Server.hpp"
+#include "Engine.hpp"
+#include "NetworkData.hpp"
+#include "BufferPool.hpp"
+#include "Log.hpp"
+
+namespace backlot
+{
+	Room::Room(int id) : id(id)
+	{
+		workerthreads = 0;
+		running = false;
+		stopping = false;
+		loaded = false;
+		loadresult = false;
+		pthread_mutex_init(&eventmutex, 0);
+		pthread_cond_init(&loadedcond, 0);
+		clientcount = 0;
+		ticktime = 0;
+		maxticktime = 0;
+		tickcount = 0;
+		profiler.setRoom(id);
+		scheduler.setRoom(id);
+	}
+	Room::~Room()
+	{
+		destroy();
+		pthread_cond_destroy(&loadedcond);
+		pthread_mutex_destroy(&eventmutex);
+	}
+
+	bool Room::init(std::string mapname, std::string mode,
+		unsigned int threads, std::string replay)
+	{
+		this->mapname = mapname;
+		this->mode = mode;
+		workerthreads = threads;
+		this->replay = replay;
+		stopping = false;
+		loaded = false;
+		if (pthread_create(&thread, 0, roomMain, this))
+		{
+			LOG_ERROR("Could not create the thread for room " << id << ".");
+			return false;
+		}
+		running = true;
+		// Wait until the game has been loaded in the room thread
+		pthread_mutex_lock(&eventmutex);
+		while (!loaded)
+			pthread_cond_wait(&loadedcond, &eventmutex);
+		pthread_mutex_unlock(&eventmutex);
+		if (!loadresult)
+		{
+			destroy();
+			return false;
+		}
+		LOG_INFO("Room " << id << " started.");
+		return true;
+	}
+	void Room::destroy()
+	{
+		if (!running)
+			return;
+		stopping = true;
+		pthread_join(thread, 0);
+		running = false;
+	}
+
+	int Room::getID()
+	{
+		return id;
+	}
+	unsigned int Room::getClientCount()
+	{
+		return clientcount;
+	}
+
+	void Room::onConnect(Client *client)
+	{
+		clientcount++;
+		client->setRoom(this);
+		RoomEvent event;
+		event.type = ERE_Connect;
+		event.arrival = 0;
+		event.client = client;
+		pthread_mutex_lock(&eventmutex);
+		events.push_back(event);
+		pthread_mutex_unlock(&eventmutex);
+	}
+	void Room::onPacket(Client *client, BufferPointer packet,
+		uint64_t arrival)
+	{
+		RoomEvent event;
+		event.type = ERE_Packet;
+		event.client = client;
+		event.packet = packet;
+		event.arrival = arrival;
+		pthread_mutex_lock(&eventmutex);
+		events.push_back(event);
+		pthread_mutex_unlock(&eventmutex);
+	}
+	void Room::onDisconnect(Client *client)
+	{
+		clientcount--;
+		RoomEvent event;
+		event.type = ERE_Disconnect;
+		event.arrival = 0;
+		event.client = client;
+		pthread_mutex_lock(&eventmutex);
+		events.push_back(event);
+		pthread_mutex_unlock(&eventmutex);
+	}
+
+	void *Room::roomMain(void *room)
+	{
+		((Room*)room)->run();
+		return 0;
+	}
+	void Room::run()
+	{
+		makeCurrent();
+		bool result = game.setWorkerThreads(workerthreads)
+			&& game.load(mapname, mode) && scheduler.init(-1, 20000);
+		if (result && replay != "")
+			result = game.startRecording(replay);
+		pthread_mutex_lock(&eventmutex);
+		loadresult = result;
+		loaded = true;
+		pthread_cond_signal(&loadedcond);
+		pthread_mutex_unlock(&eventmutex);
+		if (result)
+		{
+			while (!stopping)
+			{
+				scheduler.wait();
+				tick();
+			}
+		}
+		// Clean up while the game is still current for the scripts
+		handleEvents();
+		for (unsigned int i = 0; i < clients.size(); i++)
+			delete clients[i];
+		clients.clear();
+		game.destroy();
+		scheduler.destroy();
+		Game::setCurrent(0);
+		TickProfiler::setCurrent(0);
+		PathFinderContext::setCurrent(0);
+		Timer::setTimerList(0);
+	}
+	void Room::makeCurrent()
+	{
+		Game::setCurrent(&game);
+		TickProfiler::setCurrent(&profiler);
+		PathFinderContext::setCurrent(&pathfinder);
+		Timer::setTimerList(&timers);
+	}
+
+	void Room::tick()
+	{
+		profiler.beginTick(game.getTime() + 1);
+		uint64_t start = Engine::getTime();
+		// Packets received since the last tick
+		handleEvents();
+		profiler.addTime(ETP_Receive, start);
+		// Game logic
+		game.update();
+		// Send all reliable messages of this tick
+		uint64_t flushstart = Engine::getTime();
+		for (unsigned int i = 0; i < clients.size(); i++)
+			clients[i]->flushReliable();
+		// Let the network thread pass the packets to ENet
+		Server::get().notify();
+		profiler.addTime(ETP_Flush, flushstart);
+		// Measure the tick time, the statistics are sent once per second
+		uint64_t duration = Engine::getTime() - start;
+		ticktime += duration;
+		if (duration > maxticktime)
+			maxticktime = duration;
+		tickcount++;
+		if (tickcount == 50)
+			sendStatistics();
+		uint64_t pathstart = Engine::getTime();
+		PathFinder::updateAll();
+		profiler.addTime(ETP_PathFinding, pathstart);
+		profiler.endTick();
+	}
+	void Room::handleEvents()
+	{
+		pthread_mutex_lock(&eventmutex);
+		handledevents.swap(events);
+		pthread_mutex_unlock(&eventmutex);
+		for (unsigned int i = 0; i < handledevents.size(); i++)
+		{
+			RoomEvent &event = handledevents[i];
+			switch (event.type)
+			{
+				case ERE_Connect:
+					clients.push_back(event.client);
+					event.client->setStatus(ECS_Connecting);
+					// Send world info
+					if (!game.onClientConnecting(event.client))
+					{
+						// Client was not accepted
+						event.client->disconnect();
+					}
+					break;
+				case ERE_Packet:
+					// Input latency including the wait for this tick
+					scheduler.getLatency().add(TickScheduler::getMonotonicTime()
+						- event.arrival);
+					handlePacket(event.client, event.packet);
+					break;
+				case ERE_Disconnect:
+					removeClient(event.client);
+					break;
+			}
+		}
+		handledevents.clear();
+	}
+	void Room::handlePacket(Client *client, BufferPointer msg)
+	{
+		PacketType type = (PacketType)msg->read8();
+		if (type == EPT_Ready)
+		{
+			// Older clients do not send any features
+			unsigned int features = 0;
+			if (msg->getPosition() < msg->getSize() * 8)
+				features = msg->read8();
+			client->setCompression(features & ENF_Compression);
+			client->setStatistics(features & ENF_Statistics);
+			if (msg->getPosition() < msg->getSize() * 8)
+				client->setRenderDelay(msg->read8());
+			// Insert client into the game
+			game.addClient(client);
+		}
+		else if (type == EPT_UpdateReceived)
+		{
+			unsigned int time = msg->read32();
+			client->setAcknowledgedPacket(time);
+		}
+		else if (type == EPT_Update)
+		{
+			// Client update
+			game.injectUpdates(client, msg);
+		}
+		else if (type == EPT_Keys)
+		{
+			game.injectInput(client, msg);
+		}
+		else
+		{
+			// Invalid packet, disconnect client
+			client->disconnect();
+		}
+	}
+	void Room::removeClient(Client *client)
+	{
+		for (unsigned int i = 0; i < clients.size(); i++)
+		{
+			if (clients[i] == client)
+			{
+				clients.erase(clients.begin() + i);
+				break;
+			}
+		}
+		// Remove client from the game
+		game.removeClient(client);
+		delete client;
+	}
+
+	void Room::sendStatistics()
+	{
+		BufferPointer msg = BufferPool::get().allocate();
+		msg->write8(EPT_ServerStatistics);
+		msg->write32(ticktime / tickcount);
+		msg->write32(maxticktime);
+		msg->write16(clients.size());
+		for (unsigned int i = 0; i < clients.size(); i++)
+		{
+			if (clients[i]->getStatistics())
+				clients[i]->send(msg);
+		}
+		ticktime = 0;
+		maxticktime = 0;
+		tickcount = 0;
+	}
+}
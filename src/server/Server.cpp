@@ -21,13 +21,25 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "Server.hpp"
 #include "Buffer.hpp"
-#include "NetworkData.hpp"
+#include "Room.hpp"
 #include "Game.hpp"
+#include "TickScheduler.hpp"
+#include "Log.hpp"
 
-#include <iostream>
+#include <sstream>
 
 namespace backlot
 {
+	/**
+	 * Frees a received packet once the room is done with it. Received
+	 * packets are not referenced by ENet any more, so this is safe outside of
+	 * the network thread.
+	 */
+	static void releasePacket(void *packet)
+	{
+		enet_packet_destroy((ENetPacket*)packet);
+	}
+
 	Server &Server::get()
 	{
 		static Server server;
@@ -37,106 +49,89 @@ namespace backlot
 	{
 	}
 
-	bool Server::init(int port, std::string mapname, int maxclients)
+	bool Server::init(int port, std::string mapname, int maxclients,
+		unsigned int rooms, unsigned int threads, std::string replay)
 	{
-		this->mapname = mapname;
-		// Load map
-		map = ServerMap::get(mapname);
-		if (map.isNull())
-		{
-			std::cerr << "Could not load map." << std::endl;
-			return false;
-		}
-		std::cout << "Map is ready." << std::endl;
 		// Create network socket
 		ENetAddress address;
 		address.host = ENET_HOST_ANY;
 		address.port = port;
-		host = enet_host_create(&address, 32, 0, 0);
+		host = enet_host_create(&address, maxclients, 0, 0);
 		if (host == 0)
 		{
-			std::cerr << "Could not create server socket." << std::endl;
+			LOG_ERROR("Could not create server socket.");
 			return false;
 		}
-		// Load game mode
-		Game::get().load(mapname, "ffa");
-		// Load map entities
-		map->loadEntities();
+		// Start the games
+		for (unsigned int i = 0; i < rooms; i++)
+		{
+			Room *room = new Room(i);
+			std::string replayfile;
+			if (replay != "")
+			{
+				std::ostringstream filename;
+				filename << replay << "." << i << ".rec";
+				replayfile = filename.str();
+			}
+			if (!room->init(mapname, "ffa", threads, replayfile))
+			{
+				delete room;
+				destroy();
+				return false;
+			}
+			this->rooms.push_back(room);
+		}
+		LOG_INFO("Map is ready.");
 		return true;
 	}
 	bool Server::destroy()
 	{
+		// The rooms delete their clients
+		for (unsigned int i = 0; i < rooms.size(); i++)
+			delete rooms[i];
+		rooms.clear();
+		clients.clear();
 		enet_host_destroy(host);
-		map = 0;
+		host = 0;
 		return false;
 	}
 
-	void Server::sendToAll(BufferPointer buffer, bool reliable)
+	MapPointer Server::getMap()
 	{
-		for (unsigned int i = 0; i < clients.size(); i++)
-		{
-			clients[i]->send(buffer, reliable);
-		}
+		return Game::get().getMap();
 	}
 
-	bool Server::update()
+	void Server::receive()
 	{
-		// Receive packets
 		ENetEvent event;
+		uint64_t arrival = TickScheduler::get().getArrivalTime();
 		while (enet_host_service(host, &event, 0) > 0)
 		{
 			switch (event.type)
 			{
 				case ENET_EVENT_TYPE_CONNECT:
 				{
-					std::cout << "Client connected." << std::endl;
+					LOG_INFO("Client connected.");
 					// Add to connected clients
 					Client *newclient = new Client(event.peer);
 					clients.push_back(newclient);
-					newclient->setStatus(ECS_Connecting);
 					event.peer->data = newclient;
-					// Send world info
-					if (!Game::get().onClientConnecting(newclient))
-					{
-						// Client was not accepted
-						enet_peer_disconnect(event.peer, 0);
-					}
+					selectRoom()->onConnect(newclient);
 					break;
 				}
 				case ENET_EVENT_TYPE_RECEIVE:
 				{
-					// Copy packet
+					// The buffer keeps the packet until the message is handled
 					BufferPointer msg = new Buffer(event.packet->data,
-						event.packet->dataLength, true);
-					enet_packet_destroy(event.packet);
-					PacketType type = (PacketType)msg->read8();
+						event.packet->dataLength, releasePacket, event.packet);
 					Client *client = (Client*)event.peer->data;
-					// Parse packet
-					if (type == EPT_Ready)
-					{
-						// Insert client into the game
-						Game::get().addClient(client);
-					}
-					else if (type == EPT_UpdateReceived)
-					{
-						unsigned int time = msg->read32();
-						client->setAcknowledgedPacket(time);
-					}
-					else if (type == EPT_Update)
-					{
-						// Client update
-						Game::get().injectUpdates(client, msg);
-					}
-					else
-					{
-						// Invalid packet, disconnect client
-						enet_peer_disconnect(event.peer, 0);
-					}
+					if (client)
+						client->getRoom()->onPacket(client, msg, arrival);
 					break;
 				}
 				case ENET_EVENT_TYPE_DISCONNECT:
 				{
-					std::cout << "Client disconnected." << std::endl;
+					LOG_INFO("Client disconnected.");
 					// Remove client from client list
 					Client *client = 0;
 					for (unsigned int i = 0; i < clients.size(); i++)
@@ -148,26 +143,55 @@ namespace backlot
 							break;
 						}
 					}
+					event.peer->data = 0;
+					// The room removes the client from the game and deletes it
 					if (client)
-					{
-						// Remove client from the game
-						Game::get().removeClient(client);
-						delete client;
-					}
+						client->getRoom()->onDisconnect(client);
 					break;
 				}
 				default:
 					break;
 			}
 		}
-		// Game logic
-		Game::get().update();
-		// Flush socket
+	}
+	void Server::flush()
+	{
+		for (unsigned int i = 0; i < clients.size(); i++)
+			clients[i]->flushSendQueue(created);
+		for (unsigned int i = 0; i < created.size(); i++)
+			created[i]->release();
+		created.clear();
 		enet_host_flush(host);
+	}
+	bool Server::update()
+	{
+		receive();
+		flush();
 		return true;
 	}
+	void Server::notify()
+	{
+		TickScheduler::get().notify();
+	}
+
+	int Server::getSocket()
+	{
+		return host->socket;
+	}
 
 	Server::Server()
 	{
+		host = 0;
+	}
+
+	Room *Server::selectRoom()
+	{
+		Room *best = rooms[0];
+		for (unsigned int i = 1; i < rooms.size(); i++)
+		{
+			if (rooms[i]->getClientCount() < best->getClientCount())
+				best = rooms[i];
+		}
+		return best;
 	}
 }
@@ -17,23 +17,29 @@ OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
 #include "ServerMap.hpp"
 #include "Engine.hpp"
 #include "Game.hpp"
+#include "Log.hpp"
 
 #include <iostream>
 #include <fstream>
+#include <pthread.h>
 
 namespace backlot
 {
+	static pthread_mutex_t mapmutex = PTHREAD_MUTEX_INITIALIZER;
+
 	ServerMap::ServerMap() : Map()
 	{
 	}
 	ServerMap::~ServerMap()
 	{
 		// Remove from loaded maps
+		pthread_mutex_lock(&mapmutex);
 		std::map<std::string, ServerMap*>::iterator it = maps.find(name);
 		if (it != maps.end())
 		{
 			maps.erase(it);
 		}
+		pthread_mutex_unlock(&mapmutex);
 		// Remove entity states
 		entities.clear();
 	}
@@ -41,17 +47,25 @@ namespace backlot
 	SharedPointer<ServerMap> ServerMap::get(std::string name)
 	{
 		// Get already loaded map
+		pthread_mutex_lock(&mapmutex);
 		std::map<std::string, ServerMap*>::iterator it = maps.find(name);
 		if (it != maps.end())
 		{
-			return it->second;
+			ServerMapPointer map = it->second;
+			pthread_mutex_unlock(&mapmutex);
+			return map;
 		}
 		// Load map
 		ServerMapPointer map = new ServerMap();
 		if (!map->load(name))
 		{
+			pthread_mutex_unlock(&mapmutex);
 			return 0;
 		}
+		// Maps are shared between all rooms and stay loaded, otherwise one
+		// thread could get a map another one is just deleting
+		map->grab();
+		pthread_mutex_unlock(&mapmutex);
 		return map;
 	}
 
@@ -62,7 +76,7 @@ namespace backlot
 			std::ifstream::in | std::ifstream::binary);
 		if (!file)
 		{
-			std::cerr << "Could not open map file " << name << ".blc." << std::endl;
+			LOG_ERROR("Could not open map file " << name << ".blc.");
 			return false;
 
 		}
@@ -72,7 +86,7 @@ namespace backlot
 		// Read entities
 		unsigned int entitycount = 0;
 		file.read((char*)&entitycount, 4);
-		std::cout << entitycount << " entities." << std::endl;
+		LOG_INFO(entitycount << " entities.");
 		for (unsigned int i = 0; i < entitycount; i++)
 		{
 			unsigned short namelength = 0;
@@ -81,7 +95,7 @@ namespace backlot
 			file.read(namedata, namelength);
 			namedata[namelength] = 0;
 			std::string entityname = namedata;
-			std::cout << "Entity: \"" << entityname << "\"" << std::endl;
+			LOG_DEBUG("Entity: \"" << entityname << "\"");
 			delete[] namedata;
 			float x;
 			float y;
@@ -91,8 +105,8 @@ namespace backlot
 			EntityTemplatePointer tpl = EntityTemplate::get(entityname);
 			if (!tpl)
 			{
-				std::cout << "Invalid entity type in map: \"" << entityname
-					<< "\"" << std::endl;
+				LOG_WARNING("Invalid entity type in map: \"" << entityname
+					<< "\"");
 				return false;
 			}
 			EntityStatePointer state = new EntityState(tpl);
@@ -0,0 +1,234 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "TickProfiler.hpp"
+#include "Engine.hpp"
+#include "Log.hpp"
+#include "ThreadLocal.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+
+namespace backlot
+{
+	static const char *phasenames[ETP_Count] =
+	{
+		"receive",
+		"entities",
+		"scripts",
+		"timers",
+		"encode",
+		"flush",
+		"pathfinding",
+		"replay"
+	};
+
+	static THREAD_LOCAL TickProfiler *currentprofiler = 0;
+
+	TickProfiler &TickProfiler::get()
+	{
+		if (currentprofiler)
+			return *currentprofiler;
+		static TickProfiler profiler;
+		return profiler;
+	}
+	void TickProfiler::setCurrent(TickProfiler *profiler)
+	{
+		currentprofiler = profiler;
+	}
+	TickProfiler::~TickProfiler()
+	{
+	}
+
+	void TickProfiler::setBudget(unsigned int budget)
+	{
+		this->budget = budget;
+	}
+	void TickProfiler::setReportCount(unsigned int count)
+	{
+		reportcount = count;
+	}
+	void TickProfiler::setRoom(int room)
+	{
+		this->room = room;
+	}
+
+	void TickProfiler::beginTick(unsigned int tick)
+	{
+		this->tick = tick;
+		for (unsigned int i = 0; i < ETP_Count; i++)
+			phases[i] = 0;
+		entitytimes.clear();
+		keyframe = false;
+		tickstart = Engine::getTime();
+	}
+	void TickProfiler::endTick()
+	{
+		unsigned int total = Engine::getTime() - tickstart;
+		if (total > budget)
+		{
+			writeOverrun(total);
+			summaryoverruns++;
+		}
+		// Collect the data for the summary
+		for (unsigned int i = 0; i < ETP_Count; i++)
+			summaryphases[i] += phases[i];
+		summarytotal += total;
+		if (total > summarymax)
+			summarymax = total;
+		summaryticks++;
+		if (keyframe)
+		{
+			summarykeyframetime += phases[ETP_Replay];
+			if (phases[ETP_Replay] > summarykeyframemax)
+				summarykeyframemax = phases[ETP_Replay];
+			summarykeyframes++;
+		}
+		if (summaryticks == 50)
+			writeSummary();
+		// Do not keep any templates alive
+		entitytimes.clear();
+	}
+
+	uint64_t TickProfiler::addTime(TickPhase phase, uint64_t start)
+	{
+		uint64_t now = Engine::getTime();
+		phases[phase] += now - start;
+		return now;
+	}
+	void TickProfiler::addEntityTime(int id, const EntityTemplatePointer &tpl,
+		unsigned int time)
+	{
+		EntityTime entitytime;
+		entitytime.id = id;
+		entitytime.tpl = tpl;
+		entitytime.time = time;
+		entitytimes.push_back(entitytime);
+	}
+	void TickProfiler::markKeyframe()
+	{
+		keyframe = true;
+	}
+
+	TickProfiler::TickProfiler()
+	{
+		budget = 20000;
+		reportcount = 5;
+		room = -1;
+		tick = 0;
+		tickstart = 0;
+		keyframe = false;
+		for (unsigned int i = 0; i < ETP_Count; i++)
+		{
+			phases[i] = 0;
+			summaryphases[i] = 0;
+		}
+		summarytotal = 0;
+		summarymax = 0;
+		summaryticks = 0;
+		summaryoverruns = 0;
+		summarykeyframetime = 0;
+		summarykeyframemax = 0;
+		summarykeyframes = 0;
+	}
+
+	void TickProfiler::writeOverrun(unsigned int total)
+	{
+		LogMessage message;
+		message << "tick_overrun";
+		if (room != -1)
+			message << " room=" << room;
+		message << " tick=" << tick << " total_us=" << total;
+		for (unsigned int i = 0; i < ETP_Count; i++)
+			message << " " << phasenames[i] << "_us=" << phases[i];
+		// Slowest entities
+		unsigned int count = std::min<unsigned int>(reportcount,
+			entitytimes.size());
+		std::partial_sort(entitytimes.begin(), entitytimes.begin() + count,
+			entitytimes.end());
+		message << " top_entities=";
+		for (unsigned int i = 0; i < count; i++)
+		{
+			if (i > 0)
+				message << ",";
+			message << entitytimes[i].id << ":"
+				<< entitytimes[i].tpl->getName() << ":"
+				<< entitytimes[i].time;
+		}
+		// Slowest templates
+		std::map<std::string, unsigned int> templates;
+		for (unsigned int i = 0; i < entitytimes.size(); i++)
+			templates[entitytimes[i].tpl->getName()] += entitytimes[i].time;
+		std::vector<std::pair<unsigned int, std::string> > sorted;
+		std::map<std::string, unsigned int>::iterator it;
+		for (it = templates.begin(); it != templates.end(); it++)
+			sorted.push_back(std::make_pair(it->second, it->first));
+		count = std::min<unsigned int>(reportcount, sorted.size());
+		std::partial_sort(sorted.begin(), sorted.begin() + count,
+			sorted.end(),
+			std::greater<std::pair<unsigned int, std::string> >());
+		message << " top_templates=";
+		for (unsigned int i = 0; i < count; i++)
+		{
+			if (i > 0)
+				message << ",";
+			message << sorted[i].second << ":" << sorted[i].first;
+		}
+		Log::get().write(ELL_Info, message);
+	}
+	void TickProfiler::writeSummary()
+	{
+		LogMessage message;
+		message << "tick_summary";
+		if (room != -1)
+			message << " room=" << room;
+		message << " tick=" << tick << " ticks=" << summaryticks
+			<< " overruns=" << summaryoverruns
+			<< " avg_us=" << summarytotal / summaryticks
+			<< " max_us=" << summarymax
+			<< " replay_pct=" << (double)summaryphases[ETP_Replay] * 100
+			/ summaryticks / budget;
+		if (summarykeyframes > 0)
+		{
+			message << " keyframe_ticks=" << summarykeyframes
+				<< " keyframe_replay_avg_us="
+				<< summarykeyframetime / summarykeyframes
+				<< " keyframe_replay_max_us=" << summarykeyframemax
+				<< " keyframe_replay_pct=" << (double)summarykeyframetime
+				* 100 / summarykeyframes / budget;
+		}
+		for (unsigned int i = 0; i < ETP_Count; i++)
+		{
+			message << " " << phasenames[i] << "_avg_us="
+				<< summaryphases[i] / summaryticks;
+			summaryphases[i] = 0;
+		}
+		Log::get().write(ELL_Info, message);
+		summarytotal = 0;
+		summarymax = 0;
+		summaryticks = 0;
+		summaryoverruns = 0;
+		summarykeyframetime = 0;
+		summarykeyframemax = 0;
+		summarykeyframes = 0;
+	}
+}
@@ -0,0 +1,409 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "TickScheduler.hpp"
+#include "Engine.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <errno.h>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+#if !defined(_MSC_VER) && !defined(_WINDOWS_) && !defined(_WIN32)
+#include <sys/select.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+namespace backlot
+{
+	static const unsigned int bucketlimits[Histogram::BUCKETS] =
+	{
+		50, 100, 250, 500, 1000, 2000, 5000, 10000, 20000, 40000, 0
+	};
+
+	uint64_t TickScheduler::getMonotonicTime()
+	{
+		#if defined(_MSC_VER) || defined(_WINDOWS_) || defined(_WIN32)
+		return Engine::getTime();
+		#else
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+		#endif
+	}
+
+	Histogram::Histogram()
+	{
+		clear();
+	}
+
+	void Histogram::add(unsigned int value)
+	{
+		unsigned int bucket = 0;
+		while (bucket < BUCKETS - 1 && value > bucketlimits[bucket])
+			bucket++;
+		buckets[bucket]++;
+		count++;
+		if (value > maximum)
+			maximum = value;
+	}
+	void Histogram::clear()
+	{
+		for (unsigned int i = 0; i < BUCKETS; i++)
+			buckets[i] = 0;
+		count = 0;
+		maximum = 0;
+	}
+
+	unsigned int Histogram::getCount()
+	{
+		return count;
+	}
+	unsigned int Histogram::getMaximum()
+	{
+		return maximum;
+	}
+	unsigned int Histogram::getBucket(unsigned int bucket)
+	{
+		return buckets[bucket];
+	}
+	unsigned int Histogram::getBucketLimit(unsigned int bucket)
+	{
+		return bucketlimits[bucket];
+	}
+
+	void Histogram::write(LogMessage &message, const char *name)
+	{
+		message << " " << name << "=";
+		for (unsigned int i = 0; i < BUCKETS; i++)
+		{
+			if (i > 0)
+				message << ",";
+			if (bucketlimits[i])
+				message << bucketlimits[i];
+			else
+				message << "inf";
+			message << ":" << buckets[i];
+		}
+		message << " " << name << "_max=" << maximum;
+	}
+
+	TickScheduler &TickScheduler::get()
+	{
+		static TickScheduler scheduler;
+		return scheduler;
+	}
+	TickScheduler::~TickScheduler()
+	{
+		destroy();
+	}
+
+	bool TickScheduler::init(int socket, unsigned int interval)
+	{
+		this->socket = socket;
+		this->interval = interval;
+		deadline = getMonotonicTime() + interval;
+		nexttick = deadline;
+		pendingticks = 0;
+		readable = false;
+		notified = false;
+		handledfortick = false;
+		#if !defined(_MSC_VER) && !defined(_WINDOWS_) && !defined(_WIN32)
+		if (pipe(notifypipe) == -1)
+		{
+			LOG_ERROR("Could not create the notification pipe.");
+			return false;
+		}
+		fcntl(notifypipe[0], F_SETFL, O_NONBLOCK);
+		fcntl(notifypipe[1], F_SETFL, O_NONBLOCK);
+		#endif
+		#if defined(__linux__)
+		// Absolute timer, late wakeups do not delay the following ticks
+		timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+		epollfd = epoll_create(2);
+		if (timerfd == -1 || epollfd == -1)
+		{
+			LOG_WARNING("Could not create the tick timer, using select().");
+			closeTimer();
+			return true;
+		}
+		struct itimerspec spec;
+		spec.it_value.tv_sec = deadline / 1000000;
+		spec.it_value.tv_nsec = (deadline % 1000000) * 1000;
+		spec.it_interval.tv_sec = interval / 1000000;
+		spec.it_interval.tv_nsec = (interval % 1000000) * 1000;
+		if (timerfd_settime(timerfd, TFD_TIMER_ABSTIME, &spec, 0) == -1)
+		{
+			LOG_WARNING("Could not start the tick timer, using select().");
+			closeTimer();
+			return true;
+		}
+		struct epoll_event event;
+		memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN;
+		event.data.fd = timerfd;
+		epoll_ctl(epollfd, EPOLL_CTL_ADD, timerfd, &event);
+		event.data.fd = notifypipe[0];
+		epoll_ctl(epollfd, EPOLL_CTL_ADD, notifypipe[0], &event);
+		if (socket != -1)
+		{
+			event.data.fd = socket;
+			if (epoll_ctl(epollfd, EPOLL_CTL_ADD, socket, &event) == -1)
+			{
+				LOG_ERROR("Could not watch the socket: " << strerror(errno));
+				destroy();
+				return false;
+			}
+		}
+		#endif
+		return true;
+	}
+	void TickScheduler::destroy()
+	{
+		closeTimer();
+		closePipe();
+	}
+	void TickScheduler::closeTimer()
+	{
+		#if defined(__linux__)
+		if (epollfd != -1)
+			close(epollfd);
+		if (timerfd != -1)
+			close(timerfd);
+		epollfd = -1;
+		timerfd = -1;
+		#endif
+	}
+	void TickScheduler::closePipe()
+	{
+		#if !defined(_MSC_VER) && !defined(_WINDOWS_) && !defined(_WIN32)
+		if (notifypipe[0] != -1)
+		{
+			close(notifypipe[0]);
+			close(notifypipe[1]);
+		}
+		notifypipe[0] = -1;
+		notifypipe[1] = -1;
+		#endif
+	}
+
+	TickEvent TickScheduler::wait()
+	{
+		// Late ticks are run without sleeping
+		waitForEvents(pendingticks == 0);
+		// Read new data first, but only once before every late tick so that
+		// a flood of packets cannot delay the game
+		if (pendingticks == 0 || !handledfortick)
+		{
+			if (readable)
+			{
+				handledfortick = pendingticks > 0;
+				return ETE_Receive;
+			}
+			if (notified)
+			{
+				handledfortick = pendingticks > 0;
+				notified = false;
+				return ETE_Notify;
+			}
+		}
+		handledfortick = false;
+		startTick();
+		return ETE_Tick;
+	}
+	uint64_t TickScheduler::getArrivalTime()
+	{
+		return readabletime;
+	}
+	void TickScheduler::onReceived()
+	{
+		readable = false;
+	}
+
+	void TickScheduler::notify()
+	{
+		#if !defined(_MSC_VER) && !defined(_WINDOWS_) && !defined(_WIN32)
+		char data = 0;
+		if (notifypipe[1] != -1)
+			write(notifypipe[1], &data, 1);
+		#endif
+	}
+
+	void TickScheduler::setRoom(int room)
+	{
+		this->room = room;
+	}
+
+	Histogram &TickScheduler::getJitter()
+	{
+		return jitter;
+	}
+	unsigned int TickScheduler::getMissed()
+	{
+		return missed;
+	}
+	Histogram &TickScheduler::getLatency()
+	{
+		return latency;
+	}
+
+	TickScheduler::TickScheduler()
+	{
+		socket = -1;
+		interval = 20000;
+		deadline = 0;
+		nexttick = 0;
+		pendingticks = 0;
+		readable = false;
+		notified = false;
+		handledfortick = false;
+		notifypipe[0] = -1;
+		notifypipe[1] = -1;
+		room = -1;
+		readabletime = 0;
+		#if defined(__linux__)
+		epollfd = -1;
+		timerfd = -1;
+		#endif
+		ticks = 0;
+		missed = 0;
+	}
+
+	void TickScheduler::waitForEvents(bool block)
+	{
+		#if defined(__linux__)
+		if (epollfd != -1)
+		{
+			struct epoll_event events[3];
+			while (1)
+			{
+				int count = epoll_wait(epollfd, events, 3, block ? -1 : 0);
+				if (count == -1 && errno == EINTR)
+					continue;
+				for (int i = 0; i < count; i++)
+				{
+					if (events[i].data.fd == timerfd)
+					{
+						uint64_t expirations = 0;
+						if (read(timerfd, &expirations, 8) == 8)
+							pendingticks += expirations;
+					}
+					else if (events[i].data.fd == notifypipe[0])
+						drainPipe();
+					else if (!readable)
+					{
+						readable = true;
+						readabletime = getMonotonicTime();
+					}
+				}
+				if (!block || readable || notified || pendingticks > 0)
+					return;
+			}
+		}
+		#endif
+		while (1)
+		{
+			uint64_t now = getMonotonicTime();
+			if (now >= deadline)
+			{
+				unsigned int expirations = (now - deadline) / interval + 1;
+				pendingticks += expirations;
+				deadline += (uint64_t)expirations * interval;
+			}
+			if (pendingticks > 0)
+				block = false;
+			uint64_t timeout = block ? deadline - now : 0;
+			int maxfd = std::max(socket, notifypipe[0]);
+			if (maxfd == -1)
+			{
+				if (!block)
+					return;
+				usleep(timeout);
+				continue;
+			}
+			fd_set readfds;
+			FD_ZERO(&readfds);
+			if (socket != -1)
+				FD_SET(socket, &readfds);
+			if (notifypipe[0] != -1)
+				FD_SET(notifypipe[0], &readfds);
+			struct timeval tv;
+			tv.tv_sec = timeout / 1000000;
+			tv.tv_usec = timeout % 1000000;
+			if (select(maxfd + 1, &readfds, 0, 0, &tv) > 0)
+			{
+				if (socket != -1 && FD_ISSET(socket, &readfds) && !readable)
+				{
+					readable = true;
+					readabletime = getMonotonicTime();
+				}
+				if (notifypipe[0] != -1 && FD_ISSET(notifypipe[0], &readfds))
+					drainPipe();
+			}
+			if (!block || readable || notified)
+				return;
+		}
+	}
+	void TickScheduler::drainPipe()
+	{
+		#if !defined(_MSC_VER) && !defined(_WINDOWS_) && !defined(_WIN32)
+		char data[64];
+		while (read(notifypipe[0], data, sizeof(data)) > 0)
+		{
+		}
+		#endif
+		notified = true;
+	}
+	void TickScheduler::startTick()
+	{
+		uint64_t now = getMonotonicTime();
+		unsigned int delay = now > nexttick ? now - nexttick : 0;
+		jitter.add(delay);
+		if (delay >= interval)
+			missed++;
+		nexttick += interval;
+		pendingticks--;
+		ticks++;
+		if (ticks % 500 == 0)
+			writeReport();
+	}
+	void TickScheduler::writeReport()
+	{
+		LogMessage message;
+		message << "tick_schedule";
+		if (room != -1)
+			message << " room=" << room;
+		message << " ticks=" << ticks;
+		jitter.write(message, "jitter_us");
+		latency.write(message, "latency_us");
+		message << " missed=" << missed;
+		Log::get().write(ELL_Info, message);
+		jitter.clear();
+		latency.clear();
+		missed = 0;
+	}
+}
@@ -0,0 +1,146 @@
+/*
+Copyright (C) 2009  Mathias Gottschlag
+
+Permission is hereby granted, free of charge, to any person obtaining a copy of
+this software and associated documentation files (the "Software"), to deal in the
+Software without restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the
+Software, and to permit persons to whom the Software is furnished to do so,
+subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+*/
+
+#include "WorkerPool.hpp"
+#include "Log.hpp"
+
+
+namespace backlot
+{
+	WorkerPool::WorkerPool()
+	{
+		pthread_mutex_init(&mutex, 0);
+		pthread_cond_init(&startcond, 0);
+		pthread_cond_init(&donecond, 0);
+		task = 0;
+		data = 0;
+		count = 0;
+		next = 0;
+		active = 0;
+		generation = 0;
+		stopping = false;
+	}
+	WorkerPool::~WorkerPool()
+	{
+		destroy();
+		pthread_cond_destroy(&donecond);
+		pthread_cond_destroy(&startcond);
+		pthread_mutex_destroy(&mutex);
+	}
+
+	bool WorkerPool::init(unsigned int threads)
+	{
+		destroy();
+		// New threads start waiting for generation 1
+		stopping = false;
+		generation = 0;
+		for (unsigned int i = 0; i < threads; i++)
+		{
+			pthread_t thread;
+			if (pthread_create(&thread, 0, workerMain, this))
+			{
+				LOG_ERROR("Could not create worker thread.");
+				destroy();
+				return false;
+			}
+			this->threads.push_back(thread);
+		}
+		return true;
+	}
+	void WorkerPool::destroy()
+	{
+		if (threads.size() == 0)
+			return;
+		pthread_mutex_lock(&mutex);
+		stopping = true;
+		pthread_cond_broadcast(&startcond);
+		pthread_mutex_unlock(&mutex);
+		for (unsigned int i = 0; i < threads.size(); i++)
+			pthread_join(threads[i], 0);
+		threads.clear();
+	}
+
+	unsigned int WorkerPool::getThreadCount()
+	{
+		return threads.size();
+	}
+
+	void WorkerPool::run(Task task, void *data, unsigned int count)
+	{
+		if (threads.size() == 0)
+		{
+			for (unsigned int i = 0; i < count; i++)
+				task(i, data);
+			return;
+		}
+		// Wake up all workers
+		pthread_mutex_lock(&mutex);
+		this->task = task;
+		this->data = data;
+		this->count = count;
+		next = 0;
+		active = threads.size();
+		generation++;
+		pthread_cond_broadcast(&startcond);
+		pthread_mutex_unlock(&mutex);
+		// Help with the work ourselves
+		process();
+		// Wait until every worker has finished, only then a new task can be
+		// started safely
+		pthread_mutex_lock(&mutex);
+		while (active > 0)
+			pthread_cond_wait(&donecond, &mutex);
+		pthread_mutex_unlock(&mutex);
+	}
+
+	void *WorkerPool::workerMain(void *pool)
+	{
+		WorkerPool *workers = (WorkerPool*)pool;
+		unsigned int seen = 0;
+		pthread_mutex_lock(&workers->mutex);
+		while (true)
+		{
+			while (!workers->stopping && workers->generation == seen)
+				pthread_cond_wait(&workers->startcond, &workers->mutex);
+			if (workers->stopping)
+				break;
+			seen = workers->generation;
+			pthread_mutex_unlock(&workers->mutex);
+			workers->process();
+			pthread_mutex_lock(&workers->mutex);
+			workers->active--;
+			if (workers->active == 0)
+				pthread_cond_signal(&workers->donecond);
+		}
+		pthread_mutex_unlock(&workers->mutex);
+		return 0;
+	}
+	void WorkerPool::process()
+	{
+		while (true)
+		{
+			unsigned int index = __sync_fetch_and_add(&next, 1);
+			if (index >= count)
+				break;
+			task(index, data);
+		}
+	}
+}
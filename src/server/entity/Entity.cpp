@@ -20,7 +20,10 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 */
 
 #include "entity/Entity.hpp"
-#include "Server.hpp"
+#include "Game.hpp"
+#include "TickProfiler.hpp"
+#include "Engine.hpp"
+#include "BufferPool.hpp"
 
 #include <iostream>
 
@@ -30,7 +33,16 @@ namespace backlot
 	{
 		owner = 0;
 		positionproperty = 0;
+		priority = 1;
 		id = 0;
+		// No tick matches the empty history entries
+		for (unsigned int i = 0; i < HISTORY_SIZE; i++)
+			history[i].tick = (unsigned int)-1;
+		hashistory = false;
+		lasthistorytick = 0;
+		spawntick = 0;
+		moving = false;
+		inputsequence = 0;
 	}
 	Entity::~Entity()
 	{
@@ -42,6 +54,8 @@ namespace backlot
 
 	bool Entity::create(EntityTemplatePointer tpl, BufferPointer state)
 	{
+		// Rewound queries must not find the entity before it existed
+		spawntick = Game::get().getTime();
 		// Get a copy of the properties and their default values
 		properties = tpl->getProperties();
 		// Apply state
@@ -144,9 +158,17 @@ namespace backlot
 		for (unsigned int i = 0; i < properties.size(); i++)
 		{
 			int changed = buffer->readUnsignedInt(1);
-			if (changed && (properties[i].getFlags() & EPF_Unlocked))
-			{
+			if (!changed)
+				continue;
+			// Input is only accepted through EPT_Keys, other values are
+			// read into a copy to skip them
+			int flags = properties[i].getFlags();
+			if ((flags & EPF_Unlocked) && !(flags & EPF_Input))
 				properties[i].read(buffer);
+			else
+			{
+				Property ignored(properties[i]);
+				ignored.read(buffer);
 			}
 		}
 	}
@@ -208,6 +230,103 @@ namespace backlot
 		return RectangleF(getPosition() - tpl->getOrigin(), tpl->getSize());
 	}
 
+	float Entity::recordHistory(unsigned int tick)
+	{
+		RectangleF rectangle = getRectangle();
+		float movement = 0;
+		if (hashistory)
+		{
+			const RectangleF &previous = history[lasthistorytick % HISTORY_SIZE].rectangle;
+			movement = (Vector2F(rectangle.x, rectangle.y)
+				- Vector2F(previous.x, previous.y)).getLength();
+		}
+		PositionSnapshot &snapshot = history[tick % HISTORY_SIZE];
+		snapshot.tick = tick;
+		snapshot.rectangle = rectangle;
+		lasthistorytick = tick;
+		hashistory = true;
+		// Clients extrapolate moving entities, resending the position once
+		// it stops changing gives them a second snapshot at the same place
+		bool moved = movement > 0;
+		if (moving && !moved && positionproperty)
+			positionproperty->touch();
+		moving = moved;
+		return movement;
+	}
+	bool Entity::getPastRectangle(unsigned int tick, RectangleF &rectangle)
+	{
+		if (tick < spawntick)
+			return false;
+		if (!hashistory || tick > lasthistorytick)
+		{
+			rectangle = getRectangle();
+			return true;
+		}
+		const PositionSnapshot &snapshot = history[tick % HISTORY_SIZE];
+		if (snapshot.tick != tick)
+			return false;
+		rectangle = snapshot.rectangle;
+		return true;
+	}
+
+	void Entity::queueInput(unsigned int sequence, BufferPointer buffer)
+	{
+		bool isnew = sequence > inputsequence;
+		BufferPointer command;
+		if (isnew)
+			command = BufferPool::get().allocate();
+		// Copies of the properties are not attached to the entity and do
+		// not call any callbacks
+		for (unsigned int i = 0; i < properties.size(); i++)
+		{
+			if (!(properties[i].getFlags() & EPF_Input))
+				continue;
+			Property value(properties[i]);
+			value.read(buffer);
+			if (isnew)
+				value.write(command);
+		}
+		if (!isnew)
+			return;
+		command->setPosition(0);
+		input.push_back(command);
+		inputsequence = sequence;
+	}
+	void Entity::applyInput()
+	{
+		// Usually one command per tick, more if too many have piled up
+		unsigned int count = 1;
+		if (input.size() > MAX_INPUT_DELAY + 1)
+			count = input.size() - MAX_INPUT_DELAY;
+		for (unsigned int c = 0; c < count && input.size() > 0; c++)
+		{
+			BufferPointer command = input.front();
+			input.pop_front();
+			for (unsigned int i = 0; i < properties.size(); i++)
+			{
+				if (!(properties[i].getFlags() & EPF_Input))
+					continue;
+				// Only changes call the scripts
+				unsigned int position = command->getPosition();
+				Property value(properties[i]);
+				value.read(command);
+				if (value == properties[i])
+					continue;
+				command->setPosition(position);
+				properties[i].read(command);
+			}
+		}
+	}
+
+	void Entity::setPriority(float priority)
+	{
+		this->priority = priority;
+	}
+	float Entity::getPriority()
+	{
+		return priority;
+	}
+
 	Property *Entity::getProperty(std::string name)
 	{
 		// TODO: This is slow.
@@ -226,23 +345,24 @@ namespace backlot
 
 	void Entity::update()
 	{
+		TickProfiler &profiler = TickProfiler::get();
+		uint64_t start = Engine::getTime();
 		// Move entity
 		if (positionproperty && speed != Vector2F(0, 0))
 		{
 			Vector2F position = positionproperty->getVector2F();
-			MapPointer map = Server::get().getMap();
-			float currentheight = map->getHeight(position);
-			position += speed / 50;
-			RectangleF area(position.x - 0.35, position.y - 0.35, 0.7, 0.7);
-			float maxheight = map->getMaximumHeight(area);
-			if (maxheight <= currentheight + 0.5)
-			{
-				positionproperty->setVector2F(position);
-			}
+			Vector2F moved = Game::get().getMap()->move(position, speed);
+			if (moved != position)
+				positionproperty->setVector2F(moved);
 		}
+		start = profiler.addTime(ETP_Entities, start);
 		// Call frame callback
 		if (script->isFunction("on_update"))
+		{
 			script->callFunction("on_update");
+			uint64_t end = profiler.addTime(ETP_Scripts, start);
+			profiler.addEntityTime(id, tpl, end - start);
+		}
 	}
 
 	ScriptPointer Entity::getScript()
@@ -253,6 +373,8 @@ namespace backlot
 	void Entity::onChange(Property *property)
 	{
 		changed = true;
+		if (property == positionproperty)
+			Game::get().onEntityMoved(this);
 		// Callback
 		if (script->isFunction("on_changed"))
 		{
@@ -0,0 +1,550 @@
+#include "Buffer.hpp"
+#include "ReplayData.hpp"
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/time.h>
+
+using namespace backlot;
+
+/**
+ * Number of operations done between two clock reads.
+ */
+static const unsigned int OPS = 4096;
+
+static unsigned long long getMicroseconds()
+{
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return (unsigned long long)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/**
+ * Values read by the benchmarks end up here so that the reads cannot be
+ * optimized away.
+ */
+static volatile unsigned int sink = 0;
+
+struct Result
+{
+	std::string name;
+	/**
+	 * Bit offset of the first access relative to a byte boundary.
+	 */
+	unsigned int offset;
+	/**
+	 * Width in bits for single values, length in bytes for strings and
+	 * buffers and the average record size for replays.
+	 */
+	unsigned int size;
+	unsigned long long ops;
+	unsigned long long bytes;
+	unsigned long long time;
+};
+static std::vector<Result> results;
+
+/**
+ * Minimum time every benchmark runs, in microseconds.
+ */
+static unsigned long long mintime = 100000;
+
+/**
+ * A benchmark does OPS operations (or one pass over its data) per call and
+ * returns the number of operations and bytes processed.
+ */
+class Benchmark
+{
+	public:
+		virtual ~Benchmark()
+		{
+		}
+
+		virtual void run(unsigned long long &ops, unsigned long long &bytes) = 0;
+};
+
+static void measure(const char *name, unsigned int offset, unsigned int size,
+	Benchmark &benchmark)
+{
+	Result result;
+	result.name = name;
+	result.offset = offset;
+	result.size = size;
+	result.ops = 0;
+	result.bytes = 0;
+	// Warm up caches and let the buffers reach their final capacity
+	benchmark.run(result.ops, result.bytes);
+	result.ops = 0;
+	result.bytes = 0;
+	unsigned long long start = getMicroseconds();
+	do
+	{
+		benchmark.run(result.ops, result.bytes);
+		result.time = getMicroseconds() - start;
+	}
+	while (result.time < mintime);
+	results.push_back(result);
+}
+
+/**
+ * Fills a buffer with random data so that reads do not only return zeros.
+ */
+static void fill(Buffer &buffer, unsigned int size)
+{
+	buffer.setPosition(0);
+	for (unsigned int i = 0; i < size; i++)
+		buffer.write8(rand());
+	buffer.setPosition(0);
+}
+
+class Write16 : public Benchmark
+{
+	public:
+		Write16(unsigned int offset) : offset(offset)
+		{
+		}
+
+		virtual void run(unsigned long long &ops, unsigned long long &bytes)
+		{
+			buffer.setPosition(offset);
+			for (unsigned int i = 0; i < OPS; i++)
+				buffer.write16(i);
+			ops += OPS;
+			bytes += OPS * 2;
+		}
+	private:
+		Buffer buffer;
+		unsigned int offset;
+};
+class Read16 : public Benchmark
+{
+	public:
+		Read16(unsigned int offset) : offset(offset)
+		{
+			fill(buffer, OPS * 2 + 1);
+		}
+
+		virtual void run(unsigned long long &ops, unsigned long long &bytes)
+		{
+			buffer.setPosition(offset);
+			unsigned int sum = 0;
+			for (unsigned int i = 0; i < OPS; i++)
+				sum += buffer.read16();
+			sink += sum;
+			ops += OPS;
+			bytes += OPS * 2;
+		}
+	private:
+		Buffer buffer;
+		unsigned int offset;
+};
+class Write32 : public Benchmark
+{
+	public:
+		Write32(unsigned int offset) : offset(offset)
+		{
+		}
+
+		virtual void run(unsigned long long &ops, unsigned long long &bytes)
+		{
+			buffer.setPosition(offset);
+			for (unsigned int i = 0; i < OPS; i++)
+				buffer.write32(i * 2654435761u);
+			ops += OPS;
+			bytes += OPS * 4;
+		}
+	private:
+		Buffer buffer;
+		unsigned int offset;
+};
+class Read32 : public Benchmark
+{
+	public:
+		Read32(unsigned int offset) : offset(offset)
+		{
+			fill(buffer, OPS * 4 + 1);
+		}
+
+		virtual void run(unsigned long long &ops, unsigned long long &bytes)
+		{
+			buffer.setPosition(offset);
+			unsigned int sum = 0;
+			for (unsigned int i = 0; i < OPS; i++)
+				sum += buffer.read32();
+			sink += sum;
+			ops += OPS;
+			bytes += OPS * 4;
+		}
+	private:
+		Buffer buffer;
+		unsigned int offset;
+};
+class WriteInt : public Benchmark
+{
+	public:
+		WriteInt(unsigned int offset, unsigned int width)
+			: offset(offset), width(width)
+		{
+		}
+
+		virtual void run(unsigned long long &ops, unsigned long long &bytes)
+		{
+			buffer.setPosition(offset);
+			// Values alternate between positive and negative and fit into
+			// the width
+			unsigned int mask = (1u << (width - 1)) - 1;
+			for (unsigned int i = 0; i < OPS; i++)
+			{
+				int value = (int)(i * 2654435761u & mask);
+				buffer.writeInt(i & 1 ? -value : value, width);
+			}
+			ops += OPS;
+			bytes += OPS * width / 8;
+		}
+	private:
+		Buffer buffer;
+		unsigned int offset;
+		unsigned int width;
+};
+class ReadInt : public Benchmark
+{
+	public:
+		ReadInt(unsigned int offset, unsigned int width)
+			: offset(offset), width(width)
+		{
+			fill(buffer, OPS * 4 + 1);
+		}
+
+		virtual void run(unsigned long long &ops, unsigned long long &bytes)
+		{
+			buffer.setPosition(offset);
+			unsigned int sum = 0;
+			for (unsigned int i = 0; i < OPS; i++)
+				sum += buffer.readInt(width);
+			sink += sum;
+			ops += OPS;
+			bytes += OPS * width / 8;
+		}
+	private:
+		Buffer buffer;
+		unsigned int offset;
+		unsigned int width;
+};
+class WriteString : public Benchmark
+{
+	public:
+		WriteString(unsigned int offset, unsigned int length)
+			: offset(offset), value(length, 'x')
+		{
+		}
+
+		virtual void run(unsigned long long &ops, unsigned long long &bytes)
+		{
+			buffer.setPosition(offset);
+			// Strings are not in the per-tick hot path, fewer are enough
+			for (unsigned int i = 0; i < OPS / 16; i++)
+				buffer.writeString(value);
+			ops += OPS / 16;
+			bytes += OPS / 16 * (value.size() + 1);
+		}
+	private:
+		Buffer buffer;
+		unsigned int offset;
+		std::string value;
+};
+/**
+ * Appends whole buffers like the server does when it batches messages. The
+ * target is cleared every 64 appends, which includes the cost of zeroing
+ * the freed memory.
+ */
+class Append : public Benchmark
+{
+	public:
+		Append(unsigned int size)
+		{
+			fill(source, size);
+		}
+
+		virtual void run(unsigned long long &ops, unsigned long long &bytes)
+		{
+			target.setSize(0);
+			for (unsigned int i = 0; i < 64; i++)
+				target += source;
+			ops += 64;
+			bytes += 64 * source.getSize();
+		}
+	private:
+		Buffer source;
+		Buffer target;
+};
+/**
+ * Copies buffers to arbitrary bit positions like Game::encodeUpdate() does
+ * with the entity updates.
+ */
+class Splice : public Benchmark
+{
+	public:
+		Splice(unsigned int offset, unsigned int size) : offset(offset)
+		{
+			fill(source, size);
+		}
+
+		virtual void run(unsigned long long &ops, unsigned long long &bytes)
+		{
+			target.setPosition(offset);
+			for (unsigned int i = 0; i < 64; i++)
+				target.writeBits(source, source.getSize() * 8);
+			ops += 64;
+			bytes += 64 * source.getSize();
+		}
+	private:
+		Buffer source;
+		Buffer target;
+		unsigned int offset;
+};
+
+static void noRelease(void *context)
+{
+}
+
+/**
+ * Replays the records of a recorded game. Every record is read like a
+ * client reads an update and is copied into an outgoing packet behind a
+ * packet header which is not a multiple of 8 bits long, which are the two
+ * operations the server and the clients do with every entity update.
+ */
+class ReplayRead : public Benchmark
+{
+	public:
+		ReplayRead(std::vector<std::string> &records) : records(records)
+		{
+		}
+
+		virtual void run(unsigned long long &ops, unsigned long long &bytes)
+		{
+			unsigned int sum = 0;
+			for (unsigned int i = 0; i < records.size(); i++)
+			{
+				std::string &record = records[i];
+				Buffer buffer((void*)record.data(), record.size(), noRelease,
+					0);
+				unsigned int bits = record.size() * 8;
+				// Mix of field widths similar to the entity properties
+				static const unsigned int widths[] = {16, 1, 16, 16, 12, 3, 8};
+				for (unsigned int j = 0; bits >= 16; j = (j + 1) % 7)
+				{
+					sum += buffer.readUnsignedInt(widths[j]);
+					bits -= widths[j];
+				}
+				bytes += record.size();
+			}
+			sink += sum;
+			ops += records.size();
+		}
+	private:
+		std::vector<std::string> &records;
+};
+class ReplayEncode : public Benchmark
+{
+	public:
+		ReplayEncode(std::vector<std::string> &records) : records(records)
+		{
+		}
+
+		virtual void run(unsigned long long &ops, unsigned long long &bytes)
+		{
+			for (unsigned int i = 0; i < records.size(); i++)
+			{
+				std::string &record = records[i];
+				Buffer buffer((void*)record.data(), record.size(), noRelease,
+					0);
+				packet.setSize(0);
+				packet.write8(i & 0xFF);
+				packet.write32(i);
+				packet.writeUnsignedInt(1, 1);
+				packet.writeBits(buffer, record.size() * 8);
+				bytes += record.size();
+			}
+			ops += records.size();
+		}
+	private:
+		std::vector<std::string> &records;
+		Buffer packet;
+};
+
+/**
+ * Loads the record payloads of a replay file written by ReplayRecorder.
+ */
+static bool loadReplay(const char *filename, std::vector<std::string> &records)
+{
+	FILE *file = fopen(filename, "rb");
+	if (!file)
+	{
+		std::cerr << "Could not open " << filename << "." << std::endl;
+		return false;
+	}
+	unsigned char header[REPLAY_HEADER_SIZE];
+	if (fread(header, 1, REPLAY_HEADER_SIZE, file) != REPLAY_HEADER_SIZE
+		|| memcmp(header, REPLAY_MAGIC, 4))
+	{
+		std::cerr << filename << " is not a replay." << std::endl;
+		fclose(file);
+		return false;
+	}
+	while (true)
+	{
+		unsigned char recordheader[REPLAY_RECORD_HEADER_SIZE];
+		if (fread(recordheader, 1, REPLAY_RECORD_HEADER_SIZE, file)
+			!= REPLAY_RECORD_HEADER_SIZE)
+			break;
+		Buffer buffer(recordheader, REPLAY_RECORD_HEADER_SIZE, noRelease, 0);
+		buffer.read32();
+		unsigned int type = buffer.read8();
+		unsigned int size = buffer.read32();
+		if (type == 0)
+			break;
+		std::string record(size, 0);
+		if (size && fread(&record[0], 1, size, file) != size)
+		{
+			std::cerr << "Truncated record in " << filename << "."
+				<< std::endl;
+			break;
+		}
+		records.push_back(record);
+	}
+	fclose(file);
+	return true;
+}
+
+static void printText()
+{
+	for (unsigned int i = 0; i < results.size(); i++)
+	{
+		Result &result = results[i];
+		char line[128];
+		snprintf(line, sizeof(line), "%-14s offset %u size %5u: %8.2f ns/op, "
+			"%8.1f MB/s", result.name.c_str(), result.offset, result.size,
+			(double)result.time * 1000 / result.ops,
+			(double)result.bytes / result.time);
+		std::cout << line << std::endl;
+	}
+}
+static void printJSON()
+{
+	std::cout << "{\"benchmarks\": [" << std::endl;
+	for (unsigned int i = 0; i < results.size(); i++)
+	{
+		Result &result = results[i];
+		char line[256];
+		snprintf(line, sizeof(line), "\t{\"name\": \"%s\", \"offset\": %u, "
+			"\"size\": %u, \"ops\": %llu, \"bytes\": %llu, \"time_us\": %llu, "
+			"\"ns_per_op\": %.3f, \"bytes_per_second\": %.0f}%s",
+			result.name.c_str(), result.offset, result.size, result.ops,
+			result.bytes, result.time, (double)result.time * 1000 / result.ops,
+			(double)result.bytes * 1000000 / result.time,
+			i + 1 < results.size() ? "," : "");
+		std::cout << line << std::endl;
+	}
+	std::cout << "]}" << std::endl;
+}
+
+static void usage(const char *name)
+{
+	std::cerr << "Usage: " << name << " [--json] [--time <ms>] "
+		"[--replay <file>]" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+	bool json = false;
+	const char *replay = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--json") || !strcmp(argv[i], "-j"))
+			json = true;
+		else if ((!strcmp(argv[i], "--time") || !strcmp(argv[i], "-t"))
+			&& i + 1 < argc)
+			mintime = (unsigned long long)atoi(argv[++i]) * 1000;
+		else if ((!strcmp(argv[i], "--replay") || !strcmp(argv[i], "-r"))
+			&& i + 1 < argc)
+			replay = argv[++i];
+		else
+		{
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	srand(42);
+	if (replay)
+	{
+		std::vector<std::string> records;
+		if (!loadReplay(replay, records))
+			return 1;
+		if (records.empty())
+		{
+			std::cerr << "The replay does not contain any records." << std::endl;
+			return 1;
+		}
+		unsigned long long total = 0;
+		for (unsigned int i = 0; i < records.size(); i++)
+			total += records[i].size();
+		ReplayRead read(records);
+		measure("replay-read", 0, total / records.size(), read);
+		ReplayEncode encode(records);
+		measure("replay-encode", 1, total / records.size(), encode);
+	}
+	else
+	{
+		// Aligned and unaligned fixed size accesses
+		unsigned int offsets[] = {0, 1, 3, 4, 7, 8};
+		for (unsigned int i = 0; i < 6; i++)
+		{
+			Read16 read16(offsets[i]);
+			measure("read16", offsets[i], 16, read16);
+			Read32 read32(offsets[i]);
+			measure("read32", offsets[i], 32, read32);
+			Write16 write16(offsets[i]);
+			measure("write16", offsets[i], 16, write16);
+			Write32 write32(offsets[i]);
+			measure("write32", offsets[i], 32, write32);
+		}
+		// Property widths
+		unsigned int widths[] = {2, 5, 8, 12, 16, 24, 32};
+		for (unsigned int i = 0; i < 7; i++)
+		{
+			for (unsigned int offset = 0; offset < 4; offset += 3)
+			{
+				WriteInt writeint(offset, widths[i]);
+				measure("writeInt", offset, widths[i], writeint);
+				ReadInt readint(offset, widths[i]);
+				measure("readInt", offset, widths[i], readint);
+			}
+		}
+		// Strings and whole buffers
+		unsigned int lengths[] = {8, 64, 512};
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			for (unsigned int offset = 0; offset < 4; offset += 3)
+			{
+				WriteString writestring(offset, lengths[i]);
+				measure("writeString", offset, lengths[i], writestring);
+			}
+		}
+		unsigned int sizes[] = {16, 256, 4096};
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			Append append(sizes[i]);
+			measure("operator+=", 0, sizes[i], append);
+			Splice splice(3, sizes[i]);
+			measure("writeBits", 3, sizes[i], splice);
+		}
+	}
+	if (json)
+		printJSON();
+	else
+		printText();
+	return 0;
+}
@@ -0,0 +1,91 @@
+#include "BufferPool.hpp"
+
+#include <iostream>
+#include <vector>
+#include <pthread.h>
+
+using namespace backlot;
+
+static const unsigned int BUFFERS_PER_TICK = 40;
+
+/**
+ * Drops buffers in a different thread, like the network thread does after
+ * sending them.
+ */
+static void *dropBuffers(void *buffers)
+{
+	((std::vector<BufferPointer>*)buffers)->clear();
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	BufferPool &pool = BufferPool::get();
+	bool ok = true;
+	// Buffers are reused and keep their memory
+	std::cout << "Reuse:" << std::endl;
+	BufferPointer buffer = pool.allocate(500);
+	Buffer *first = buffer.get();
+	for (unsigned int i = 0; i < 100; i++)
+		buffer->write32(0xDEADC0DE);
+	buffer = 0;
+	if (pool.getSize() != 1)
+	{
+		std::cout << "Buffer not returned: " << pool.getSize() << std::endl;
+		ok = false;
+	}
+	buffer = pool.allocate();
+	if (buffer.get() != first || pool.getHits() != 1 || pool.getMisses() != 1)
+	{
+		std::cout << "Buffer not reused." << std::endl;
+		ok = false;
+	}
+	if (buffer->getSize() != 0 || buffer->getPosition() != 0
+		|| buffer->getCapacity() < 500)
+	{
+		std::cout << "Buffer not reset properly." << std::endl;
+		ok = false;
+	}
+	// The old content must not show up in partial writes
+	buffer->writeUnsignedInt(1, 1);
+	if (*(unsigned char*)buffer->getData() != 0x80)
+	{
+		std::cout << "Old data in reused buffer." << std::endl;
+		ok = false;
+	}
+	buffer = 0;
+	// Buffers created in one thread and dropped in another
+	std::cout << "Threads:" << std::endl;
+	unsigned int misses = 0;
+	for (unsigned int tick = 0; tick < 1000; tick++)
+	{
+		if (tick == 10)
+			misses = pool.getMisses();
+		std::vector<BufferPointer> buffers;
+		for (unsigned int i = 0; i < BUFFERS_PER_TICK; i++)
+		{
+			BufferPointer buffer = pool.allocate();
+			for (unsigned int j = 0; j < 100; j++)
+				buffer->write32(j);
+			buffers.push_back(buffer);
+		}
+		pthread_t thread;
+		pthread_create(&thread, 0, dropBuffers, &buffers);
+		pthread_join(thread, 0);
+	}
+	if (pool.getMisses() != misses)
+	{
+		std::cout << "New buffers allocated after warming up: "
+			<< pool.getMisses() - misses << std::endl;
+		ok = false;
+	}
+	if (pool.getHighWater() < BUFFERS_PER_TICK)
+	{
+		std::cout << "Wrong high-water mark: " << pool.getHighWater()
+			<< std::endl;
+		ok = false;
+	}
+	std::cout << pool.getHits() << " hits, " << pool.getMisses()
+		<< " misses, high-water mark " << pool.getHighWater() << std::endl;
+	return ok ? 0 : 1;
+}
@@ -3,9 +3,22 @@
 
 #include <iostream>
 #include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
 
 using namespace backlot;
 
+/**
+ * Simple bit-by-bit encoder which defines the expected wire format.
+ */
+static void writeReference(std::vector<bool> &bits, unsigned int value,
+	unsigned int size)
+{
+	for (int i = size - 1; i >= 0; i--)
+		bits.push_back((value >> i) & 1);
+}
+
 int main(int argc, char **argv)
 {
 	// Simple, byte-aligned
@@ -83,5 +96,242 @@ int main(int argc, char **argv)
 	u8 = buffer->readUnsignedInt(1);
 	if (u8 != 1)
 		std::cout << "Wrong data (1): " << u8 << std::endl;
+	// Splicing bit-packed data into another buffer
+	std::cout << "Splicing:" << std::endl;
+	BufferPointer part = new Buffer();
+	part->writeUnsignedInt(0x2BAD, 14);
+	part->write16(0xCAFE);
+	part->writeUnsignedInt(0x5, 3);
+	for (unsigned int offset = 0; offset < 8; offset++)
+	{
+		buffer = new Buffer();
+		buffer->writeUnsignedInt(0, offset);
+		buffer->writeBits(*part.get(), part->getPosition());
+		buffer->writeUnsignedInt(0x1, 1);
+		if (buffer->getPosition() != offset + 34)
+			std::cout << "Wrong buffer position (" << offset + 34 << "): "
+				<< buffer->getPosition() << std::endl;
+		buffer->setPosition(offset);
+		u16 = buffer->readUnsignedInt(14);
+		if (u16 != 0x2BAD)
+			std::cout << "Wrong data (0x2BAD): " << u16 << std::endl;
+		u16 = buffer->read16();
+		if (u16 != 0xCAFE)
+			std::cout << "Wrong data (0xCAFE): " << u16 << std::endl;
+		u8 = buffer->readUnsignedInt(3);
+		if (u8 != 0x5)
+			std::cout << "Wrong data (0x5): " << (int)u8 << std::endl;
+		u8 = buffer->readUnsignedInt(1);
+		if (u8 != 1)
+			std::cout << "Wrong data (1): " << (int)u8 << std::endl;
+	}
+	// Overwriting, e.g. to fill in a header afterwards
+	std::cout << "Overwriting:" << std::endl;
+	buffer = new Buffer();
+	buffer->write16(0);
+	buffer->write8(0xAA);
+	buffer->setPosition(0);
+	buffer->write8(0xC2);
+	buffer->write8(0x2B);
+	buffer->write32(0xDEADC0DE);
+	if (buffer->getSize() != 6)
+		std::cout << "Wrong buffer size (6): " << buffer->getSize() << std::endl;
+	buffer->setPosition(0);
+	u16 = buffer->read16();
+	if (u16 != 0xC22B)
+		std::cout << "Wrong data (0xC22B): " << u16 << std::endl;
+	u32 = buffer->read32();
+	if (u32 != 0xDEADC0DE)
+		std::cout << "Wrong data (0xDEADC0DE): " << u32 << std::endl;
+	// Random mix of writes compared to the reference encoding
+	std::cout << "Random writes:" << std::endl;
+	srand(42);
+	for (unsigned int run = 0; run < 100; run++)
+	{
+		buffer = new Buffer();
+		std::vector<bool> bits;
+		std::vector<unsigned int> values;
+		std::vector<unsigned int> sizes;
+		for (unsigned int i = 0; i < 200; i++)
+		{
+			unsigned int size = rand() % 4;
+			size = size == 0 ? 8 : (size == 1 ? 16 : (size == 2 ? 32
+				: rand() % 32 + 1));
+			unsigned int value = ((unsigned int)rand() << 16) ^ rand();
+			if (size < 32)
+				value &= (1u << size) - 1;
+			if (size == 8)
+				buffer->write8(value);
+			else if (size == 16)
+				buffer->write16(value);
+			else if (size == 32)
+				buffer->write32(value);
+			else
+				buffer->writeUnsignedInt(value, size);
+			writeReference(bits, value, size);
+			values.push_back(value);
+			sizes.push_back(size);
+		}
+		if (buffer->getPosition() != bits.size()
+			|| buffer->getSize() != (bits.size() + 7) / 8)
+		{
+			std::cout << "Wrong size (" << std::dec << bits.size() << "): "
+				<< buffer->getPosition() << std::hex << std::endl;
+			break;
+		}
+		const unsigned char *data = (const unsigned char*)buffer->getData();
+		for (unsigned int i = 0; i < buffer->getSize() * 8; i++)
+		{
+			bool expected = i < bits.size() && bits[i];
+			if (((data[i / 8] >> (7 - i % 8)) & 1) != expected)
+			{
+				std::cout << "Wrong bit " << std::dec << i << std::hex
+					<< std::endl;
+				break;
+			}
+		}
+		buffer->setPosition(0);
+		for (unsigned int i = 0; i < values.size(); i++)
+		{
+			unsigned int value = buffer->readUnsignedInt(sizes[i]);
+			if (value != values[i])
+			{
+				std::cout << "Wrong data (" << values[i] << "): " << value
+					<< std::endl;
+				break;
+			}
+		}
+	}
+	// 64 bit values
+	std::cout << "64 bit:" << std::endl;
+	for (unsigned int offset = 0; offset < 8; offset++)
+	{
+		buffer = new Buffer();
+		buffer->writeUnsignedInt(0, offset);
+		buffer->write64(0x0123456789ABCDEFull);
+		buffer->setPosition(offset);
+		uint64_t u64 = buffer->read64();
+		if (u64 != 0x0123456789ABCDEFull)
+			std::cout << "Wrong data (0x0123456789ABCDEF): " << u64
+				<< std::endl;
+	}
+	// Memory is only reallocated a few times
+	std::cout << "Capacity:" << std::endl;
+	buffer = new Buffer();
+	unsigned int reallocations = 0;
+	unsigned int capacity = 0;
+	for (unsigned int i = 0; i < 1000; i++)
+	{
+		buffer->writeUnsignedInt(i, 11);
+		if (buffer->getCapacity() != capacity)
+		{
+			capacity = buffer->getCapacity();
+			reallocations++;
+		}
+	}
+	if (reallocations > 10)
+		std::cout << "Too many reallocations: " << std::dec << reallocations
+			<< std::hex << std::endl;
+	buffer = new Buffer();
+	buffer->reserve(1000);
+	for (unsigned int i = 0; i < 1000; i++)
+		buffer->write8(i);
+	if (buffer->getCapacity() != 1000)
+		std::cout << "Wrong capacity (1000): " << buffer->getCapacity()
+			<< std::endl;
+	// Borrowed memory is copied before it grows
+	std::cout << "Borrowed memory:" << std::endl;
+	static unsigned int released = 0;
+	struct Release
+	{
+		static void callback(void *context)
+		{
+			released++;
+		}
+	};
+	unsigned char borrowed[3] = {0xCA, 0xFE, 0xC2};
+	buffer = new Buffer(borrowed, 3, Release::callback, 0);
+	buffer->setPosition(24);
+	buffer->write32(0xDEADC0DE);
+	if (released != 1)
+		std::cout << "Memory not released after growing." << std::endl;
+	buffer->setPosition(0);
+	u16 = buffer->read16();
+	if (u16 != 0xCAFE)
+		std::cout << "Wrong data (0xCAFE): " << u16 << std::endl;
+	u8 = buffer->read8();
+	if (u8 != 0xC2)
+		std::cout << "Wrong data (0xC2): " << u8 << std::endl;
+	u32 = buffer->read32();
+	if (u32 != 0xDEADC0DE)
+		std::cout << "Wrong data (0xDEADC0DE): " << u32 << std::endl;
+	buffer = 0;
+	if (released != 1)
+		std::cout << "Memory released twice." << std::endl;
+	// Variable-length integers
+	std::cout << "Variable-length integers:" << std::endl;
+	buffer = new Buffer();
+	buffer->writeExpGolomb(3);
+	buffer->writeVarInt(300);
+	if (buffer->getPosition() != 21)
+		std::cout << "Wrong buffer position (21): " << std::dec
+			<< buffer->getPosition() << std::hex << std::endl;
+	buffer->setPosition(0);
+	u32 = buffer->readUnsignedInt(21);
+	if (u32 != 0x4AC02)
+		std::cout << "Wrong encoding (0x4AC02): " << u32 << std::endl;
+	uint32_t values[] = {0, 1, 2, 3, 127, 128, 255, 300, 16383, 16384,
+		65535, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFE, 0xFFFFFFFF};
+	unsigned int valuecount = sizeof(values) / sizeof(values[0]);
+	for (unsigned int offset = 0; offset < 8; offset++)
+	{
+		buffer = new Buffer();
+		buffer->writeUnsignedInt(0, offset);
+		for (unsigned int i = 0; i < valuecount; i++)
+		{
+			buffer->writeVarInt(values[i]);
+			buffer->writeZigZag(values[i]);
+			for (unsigned int order = 0; order < 4; order++)
+				buffer->writeExpGolomb(values[i], order);
+		}
+		buffer->writeUnsignedInt(0x5, 3);
+		buffer->setPosition(offset);
+		for (unsigned int i = 0; i < valuecount; i++)
+		{
+			u32 = buffer->readVarInt();
+			if (u32 != values[i])
+				std::cout << "Wrong varint (" << values[i] << "): " << u32
+					<< std::endl;
+			s32 = buffer->readZigZag();
+			if (s32 != (int32_t)values[i])
+				std::cout << "Wrong zigzag (" << values[i] << "): " << s32
+					<< std::endl;
+			for (unsigned int order = 0; order < 4; order++)
+			{
+				u32 = buffer->readExpGolomb(order);
+				if (u32 != values[i])
+					std::cout << "Wrong exp-Golomb (" << values[i] << ", "
+						<< order << "): " << u32 << std::endl;
+			}
+		}
+		u8 = buffer->readUnsignedInt(3);
+		if (u8 != 0x5)
+			std::cout << "Wrong data (0x5): " << (int)u8 << std::endl;
+	}
+	// Sizes of small values
+	buffer = new Buffer();
+	buffer->writeZigZag(-64);
+	buffer->writeExpGolomb(0);
+	buffer->writeExpGolomb(3, 2);
+	if (buffer->getPosition() != 12)
+		std::cout << "Wrong buffer position (12): " << std::dec
+			<< buffer->getPosition() << std::hex << std::endl;
+	// Truncated data
+	buffer = new Buffer();
+	buffer->write16(0);
+	buffer->setPosition(0);
+	u32 = buffer->readExpGolomb();
+	if (u32 != 0 || buffer->getPosition() != 16)
+		std::cout << "Truncated exp-Golomb code not detected." << std::endl;
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,194 @@
+#include "PacketCompressor.hpp"
+#include "NetworkData.hpp"
+
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <sys/time.h>
+
+using namespace backlot;
+
+static const int TICK_COUNT = 2000;
+
+static unsigned long long getMicroseconds()
+{
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return (unsigned long long)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+struct SimulatedEntity
+{
+	unsigned int x;
+	unsigned int y;
+	unsigned int rotation;
+	unsigned int health;
+};
+
+/**
+ * Creates an update packet similar to the ones written by Game::update()
+ * with quantized positions.
+ */
+static BufferPointer createUpdate(std::vector<SimulatedEntity> &entities,
+	unsigned int time)
+{
+	BufferPointer buffer = new Buffer();
+	buffer->write8(EPT_Update);
+	buffer->write32(time);
+	buffer->write32(3);
+	for (unsigned int i = 0; i < entities.size(); i++)
+	{
+		SimulatedEntity &entity = entities[i];
+		// Most entities move, some turn, few get hurt
+		bool moved = rand() % 4 != 0;
+		bool turned = rand() % 3 == 0;
+		bool hurt = rand() % 50 == 0;
+		if (!moved && !turned && !hurt)
+			continue;
+		buffer->write16(i + 1);
+		buffer->writeUnsignedInt(moved, 1);
+		if (moved)
+		{
+			entity.x += rand() % 65 - 32;
+			entity.y += rand() % 65 - 32;
+			buffer->writeUnsignedInt(entity.x & 0xFFFF, 16);
+			buffer->writeUnsignedInt(entity.y & 0xFFFF, 16);
+		}
+		buffer->writeUnsignedInt(turned, 1);
+		if (turned)
+		{
+			entity.rotation = (entity.rotation + rand() % 64) & 0xFFF;
+			buffer->writeUnsignedInt(entity.rotation, 12);
+		}
+		buffer->writeUnsignedInt(0, 2);
+		buffer->writeUnsignedInt(hurt, 1);
+		if (hurt)
+		{
+			entity.health = entity.health > 10 ? entity.health - 10 : 100;
+			buffer->writeUnsignedInt(entity.health, 8);
+		}
+		buffer->writeUnsignedInt(0, 3);
+	}
+	return buffer;
+}
+/**
+ * Creates an entity creation message like the ones sent when a client
+ * joins.
+ */
+static BufferPointer createEntity(unsigned int id, const char *type)
+{
+	BufferPointer buffer = new Buffer();
+	buffer->write8(EPT_EntityCreated);
+	buffer->write16(id);
+	buffer->write16(id % 4);
+	buffer->writeString(type);
+	buffer->writeUnsignedInt(rand() & 0xFFFF, 16);
+	buffer->writeUnsignedInt(rand() & 0xFFFF, 16);
+	buffer->writeUnsignedInt(0, 12);
+	buffer->writeUnsignedInt(id % 2, 4);
+	buffer->writeUnsignedInt(65535, 16);
+	buffer->writeUnsignedInt(0, 8);
+	buffer->writeUnsignedInt(100, 8);
+	buffer->writeUnsignedInt(65535, 16);
+	buffer->writeUnsignedInt(65535, 16);
+	return buffer;
+}
+
+static bool run(const char *name, std::vector<BufferPointer> &packets)
+{
+	// Small packets take less time than the clock resolution, so only whole
+	// loops are timed
+	std::vector<BufferPointer> compressed(packets.size());
+	unsigned long long start = getMicroseconds();
+	for (unsigned int i = 0; i < packets.size(); i++)
+		compressed[i] = PacketCompressor::compress(packets[i]);
+	unsigned long long encodetime = getMicroseconds() - start;
+	std::vector<BufferPointer> restored(packets.size());
+	start = getMicroseconds();
+	for (unsigned int i = 0; i < packets.size(); i++)
+	{
+		if (!compressed[i])
+			continue;
+		compressed[i]->setPosition(8);
+		restored[i] = PacketCompressor::decompress(compressed[i]);
+	}
+	unsigned long long decodetime = getMicroseconds() - start;
+	unsigned long long uncompressed = 0;
+	unsigned long long sent = 0;
+	unsigned long long decoded = 0;
+	unsigned int compressedcount = 0;
+	bool ok = true;
+	for (unsigned int i = 0; i < packets.size(); i++)
+	{
+		BufferPointer packet = packets[i];
+		uncompressed += packet->getSize();
+		if (!compressed[i])
+		{
+			sent += packet->getSize();
+			continue;
+		}
+		compressedcount++;
+		sent += compressed[i]->getSize();
+		decoded += packet->getSize();
+		if (!restored[i] || restored[i]->getSize() != packet->getSize()
+			|| memcmp(restored[i]->getData(), packet->getData(),
+				packet->getSize()))
+		{
+			std::cout << "Packet " << i << " was not restored correctly."
+				<< std::endl;
+			ok = false;
+		}
+	}
+	std::cout << name << ": " << packets.size() << " packets, "
+		<< compressedcount << " compressed, " << uncompressed << " -> "
+		<< sent << " bytes (ratio " << (double)sent / uncompressed << "), "
+		<< "encode " << (double)encodetime * 1000 / uncompressed
+		<< " ns/byte";
+	if (decoded)
+		std::cout << ", decode " << (double)decodetime * 1000 / decoded
+			<< " ns/byte";
+	std::cout << std::endl;
+	return ok;
+}
+
+int main(int argc, char **argv)
+{
+	srand(42);
+	bool ok = true;
+	// Update streams with different numbers of visible entities
+	unsigned int entitycounts[] = {4, 16, 64};
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		std::vector<SimulatedEntity> entities(entitycounts[i]);
+		for (unsigned int j = 0; j < entities.size(); j++)
+		{
+			entities[j].x = rand() & 0xFFFF;
+			entities[j].y = rand() & 0xFFFF;
+			entities[j].rotation = rand() & 0xFFF;
+			entities[j].health = 100;
+		}
+		std::vector<BufferPointer> packets;
+		for (int time = 0; time < TICK_COUNT; time++)
+			packets.push_back(createUpdate(entities, time));
+		std::cout << entitycounts[i] << " entities - ";
+		ok = run("Updates", packets) && ok;
+	}
+	// Initial state when a client joins
+	std::vector<BufferPointer> packets;
+	const char *types[] = {"player", "bot", "weapon", "spawnpoint"};
+	for (unsigned int i = 0; i < 200; i++)
+		packets.push_back(createEntity(i, types[i % 4]));
+	ok = run("Entity creation", packets) && ok;
+	// Random data must never grow
+	packets.clear();
+	for (unsigned int i = 0; i < 100; i++)
+	{
+		BufferPointer buffer = new Buffer();
+		for (unsigned int j = 0; j < 200; j++)
+			buffer->write8(rand());
+		packets.push_back(buffer);
+	}
+	ok = run("Random data", packets) && ok;
+	return ok ? 0 : 1;
+}
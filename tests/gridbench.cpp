@@ -0,0 +1,153 @@
+#include "entity/EntityGrid.hpp"
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <sys/time.h>
+
+using namespace backlot;
+
+static const int ENTITY_COUNT = 10000;
+static const float MAP_SIZE = 256.0f;
+static const int QUERY_COUNT = 10000;
+
+static unsigned long long getMicroseconds()
+{
+	struct timeval tv;
+	gettimeofday(&tv, 0);
+	return (unsigned long long)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+static float randomFloat(float max)
+{
+	return (float)rand() / RAND_MAX * max;
+}
+static bool touches(const RectangleF &a, const RectangleF &b)
+{
+	return a.x <= b.x + b.width && b.x <= a.x + a.width
+		&& a.y <= b.y + b.height && b.y <= a.y + a.height;
+}
+static float getDistanceSquared(const Vector2F &point, const RectangleF &r)
+{
+	float dx = std::max(std::max(r.x - point.x, point.x - r.x - r.width), 0.0f);
+	float dy = std::max(std::max(r.y - point.y, point.y - r.y - r.height), 0.0f);
+	return dx * dx + dy * dy;
+}
+static void report(const char *name, unsigned long long grid,
+	unsigned long long linear, int count)
+{
+	std::cout << name << ": grid " << (double)grid * 1000 / count
+		<< " ns, linear " << (double)linear * 1000 / count << " ns" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+	srand(42);
+	// Place entities with a size similar to the player
+	std::vector<RectangleF> rectangles(ENTITY_COUNT);
+	EntityGrid grid;
+	unsigned long long start = getMicroseconds();
+	for (int i = 0; i < ENTITY_COUNT; i++)
+	{
+		rectangles[i] = RectangleF(randomFloat(MAP_SIZE), randomFloat(MAP_SIZE), 0.7, 0.7);
+		grid.update(i, rectangles[i]);
+	}
+	std::cout << "Insert: " << (double)(getMicroseconds() - start) * 1000
+		/ ENTITY_COUNT << " ns" << std::endl;
+	// Move all entities by a small distance, like once per tick
+	start = getMicroseconds();
+	for (int i = 0; i < ENTITY_COUNT; i++)
+	{
+		rectangles[i].x += randomFloat(0.4) - 0.2;
+		rectangles[i].y += randomFloat(0.4) - 0.2;
+		grid.update(i, rectangles[i]);
+	}
+	std::cout << "Move: " << (double)(getMicroseconds() - start) * 1000
+		/ ENTITY_COUNT << " ns" << std::endl;
+	if (grid.getSize() != ENTITY_COUNT)
+		std::cout << "Wrong grid size (" << ENTITY_COUNT << "): "
+			<< grid.getSize() << std::endl;
+	// Random query positions
+	std::vector<Vector2F> points(QUERY_COUNT);
+	for (int i = 0; i < QUERY_COUNT; i++)
+		points[i] = Vector2F(randomFloat(MAP_SIZE), randomFloat(MAP_SIZE));
+	std::vector<int> result;
+	std::vector<int> expected;
+	unsigned int errors = 0;
+	// Rectangle queries
+	unsigned long long gridtime = 0;
+	unsigned long long lineartime = 0;
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		RectangleF area(points[i].x, points[i].y, 4, 4);
+		start = getMicroseconds();
+		grid.query(area, result);
+		gridtime += getMicroseconds() - start;
+		start = getMicroseconds();
+		expected.clear();
+		for (int j = 0; j < ENTITY_COUNT; j++)
+		{
+			if (touches(rectangles[j], area))
+				expected.push_back(j);
+		}
+		lineartime += getMicroseconds() - start;
+		std::sort(result.begin(), result.end());
+		if (result != expected)
+			errors++;
+	}
+	report("Rectangle query", gridtime, lineartime, QUERY_COUNT);
+	// Radius queries
+	gridtime = 0;
+	lineartime = 0;
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		start = getMicroseconds();
+		grid.queryRadius(points[i], 5, result);
+		gridtime += getMicroseconds() - start;
+		start = getMicroseconds();
+		expected.clear();
+		for (int j = 0; j < ENTITY_COUNT; j++)
+		{
+			if (getDistanceSquared(points[i], rectangles[j]) <= 25)
+				expected.push_back(j);
+		}
+		lineartime += getMicroseconds() - start;
+		std::sort(result.begin(), result.end());
+		if (result != expected)
+			errors++;
+	}
+	report("Radius query", gridtime, lineartime, QUERY_COUNT);
+	// Nearest entity queries
+	gridtime = 0;
+	lineartime = 0;
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		start = getMicroseconds();
+		int nearest = grid.getNearest(points[i], 50);
+		gridtime += getMicroseconds() - start;
+		start = getMicroseconds();
+		float bestdistance = 2500;
+		for (int j = 0; j < ENTITY_COUNT; j++)
+		{
+			float distance = getDistanceSquared(points[i], rectangles[j]);
+			if (distance <= bestdistance)
+				bestdistance = distance;
+		}
+		lineartime += getMicroseconds() - start;
+		if (nearest == -1 || getDistanceSquared(points[i],
+			rectangles[nearest]) != bestdistance)
+			errors++;
+	}
+	report("Nearest query", gridtime, lineartime, QUERY_COUNT);
+	// Removal
+	start = getMicroseconds();
+	for (int i = 0; i < ENTITY_COUNT; i++)
+		grid.remove(i);
+	std::cout << "Remove: " << (double)(getMicroseconds() - start) * 1000
+		/ ENTITY_COUNT << " ns" << std::endl;
+	if (grid.getSize() != 0)
+		std::cout << "Wrong grid size (0): " << grid.getSize() << std::endl;
+	if (errors)
+		std::cout << errors << " queries returned wrong results." << std::endl;
+	return errors != 0;
+}
@@ -0,0 +1,106 @@
+#include "Log.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+using namespace backlot;
+
+static const unsigned int THREADS = 4;
+static const unsigned int MESSAGES = 200;
+
+static void *writeMessages(void *data)
+{
+	unsigned long thread = (unsigned long)data;
+	for (unsigned int i = 0; i < MESSAGES; i++)
+	{
+		LogMessage message;
+		message << "thread " << thread << " message " << i;
+		Log::get().write(ELL_Info, message);
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	const char *filename = "logtest.log";
+	// Long messages are cut off
+	LogMessage message;
+	for (unsigned int i = 0; i < 100; i++)
+		message << "0123456789";
+	if (message.getLength() != LogMessage::MAX_LENGTH - 1)
+	{
+		std::cout << "Error: Message not truncated." << std::endl;
+		return 1;
+	}
+	// Write from several threads at once
+	Log::get().setRateLimit(5);
+	if (!Log::get().setFile(filename) || !Log::get().init())
+	{
+		std::cout << "Could not start logging." << std::endl;
+		return 1;
+	}
+	std::vector<pthread_t> threads(THREADS);
+	for (unsigned long i = 0; i < THREADS; i++)
+		pthread_create(&threads[i], 0, writeMessages, (void*)i);
+	for (unsigned int i = 0; i < THREADS; i++)
+		pthread_join(threads[i], 0);
+	// Rate limited statement
+	for (unsigned int i = 0; i < 100; i++)
+		LOG_INFO("limited " << i);
+	// Debug messages are disabled at runtime
+	LOG_DEBUG("debug message");
+	Log::get().destroy();
+	// Check the messages
+	std::ifstream file(filename);
+	std::vector<unsigned int> next(THREADS, 0);
+	unsigned int limited = 0;
+	std::string line;
+	while (std::getline(file, line))
+	{
+		std::istringstream stream(line);
+		std::string word;
+		stream >> word;
+		if (word == "thread")
+		{
+			unsigned int thread;
+			unsigned int index;
+			stream >> thread >> word >> index;
+			if (thread >= THREADS || index != next[thread])
+			{
+				std::cout << "Error: Unexpected message \"" << line << "\"."
+					<< std::endl;
+				return 1;
+			}
+			next[thread]++;
+		}
+		else if (word == "limited")
+			limited++;
+		else
+		{
+			std::cout << "Error: Unexpected message \"" << line << "\"."
+				<< std::endl;
+			return 1;
+		}
+	}
+	for (unsigned int i = 0; i < THREADS; i++)
+	{
+		if (next[i] != MESSAGES)
+		{
+			std::cout << "Error: Thread " << i << " lost messages."
+				<< std::endl;
+			return 1;
+		}
+	}
+	if (limited != 5)
+	{
+		std::cout << "Error: " << limited << " rate limited messages written."
+			<< std::endl;
+		return 1;
+	}
+	std::cout << "Done." << std::endl;
+	return 0;
+}
@@ -0,0 +1,228 @@
+#include "Client.hpp"
+#include "NetworkData.hpp"
+
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+using namespace backlot;
+
+static const int TICK_COUNT = 1000;
+static const unsigned int CLIENT_COUNT = 32;
+
+/**
+ * All heap allocations are counted, including the ones done by operator
+ * new.
+ */
+static unsigned long long allocations = 0;
+static unsigned long long copied = 0;
+
+extern "C"
+{
+	void *__libc_malloc(size_t size);
+	void *__libc_realloc(void *ptr, size_t size);
+	void *__libc_calloc(size_t count, size_t size);
+
+	void *malloc(size_t size)
+	{
+		__sync_add_and_fetch(&allocations, 1);
+		return __libc_malloc(size);
+	}
+	void *realloc(void *ptr, size_t size)
+	{
+		__sync_add_and_fetch(&allocations, 1);
+		return __libc_realloc(ptr, size);
+	}
+	void *calloc(size_t count, size_t size)
+	{
+		__sync_add_and_fetch(&allocations, 1);
+		return __libc_calloc(count, size);
+	}
+}
+
+/**
+ * Minimal replacement for the ENet functions used by the server client
+ * code. Packets are reference counted like in ENet and are "sent" when the
+ * peers are flushed.
+ */
+struct SimulatedPeer
+{
+	ENetPeer peer;
+	std::vector<ENetPacket*> outgoing;
+};
+
+ENetPacket *enet_packet_create(const void *data, size_t length,
+	enet_uint32 flags)
+{
+	ENetPacket *packet = (ENetPacket*)malloc(sizeof(ENetPacket));
+	if (flags & ENET_PACKET_FLAG_NO_ALLOCATE)
+		packet->data = (enet_uint8*)data;
+	else
+	{
+		packet->data = (enet_uint8*)malloc(length);
+		memcpy(packet->data, data, length);
+		copied += length;
+	}
+	packet->referenceCount = 0;
+	packet->flags = flags;
+	packet->dataLength = length;
+	packet->freeCallback = 0;
+	packet->userData = 0;
+	return packet;
+}
+void enet_packet_destroy(ENetPacket *packet)
+{
+	if (packet->freeCallback)
+		packet->freeCallback(packet);
+	if (!(packet->flags & ENET_PACKET_FLAG_NO_ALLOCATE))
+		free(packet->data);
+	free(packet);
+}
+int enet_peer_send(ENetPeer *peer, enet_uint8 channel, ENetPacket *packet)
+{
+	packet->referenceCount++;
+	((SimulatedPeer*)peer->data)->outgoing.push_back(packet);
+	return 0;
+}
+void enet_peer_disconnect_later(ENetPeer *peer, enet_uint32 data)
+{
+}
+
+static void transmit(std::vector<SimulatedPeer> &peers)
+{
+	for (unsigned int i = 0; i < peers.size(); i++)
+	{
+		for (unsigned int j = 0; j < peers[i].outgoing.size(); j++)
+		{
+			ENetPacket *packet = peers[i].outgoing[j];
+			packet->referenceCount--;
+			if (packet->referenceCount == 0)
+				enet_packet_destroy(packet);
+		}
+		peers[i].outgoing.clear();
+	}
+}
+
+static void releasePacket(void *packet)
+{
+	enet_packet_destroy((ENetPacket*)packet);
+}
+
+/**
+ * Creates a packet like the ones ENet returns when receiving data.
+ */
+static ENetPacket *receivePacket(PacketType type, unsigned int size)
+{
+	ENetPacket *packet = enet_packet_create(0, size,
+		ENET_PACKET_FLAG_NO_ALLOCATE);
+	packet->flags = 0;
+	packet->data = (enet_uint8*)malloc(size);
+	packet->data[0] = type;
+	for (unsigned int i = 1; i < size; i++)
+		packet->data[i] = rand();
+	return packet;
+}
+static BufferPointer createMessage(PacketType type, unsigned int size)
+{
+	BufferPointer buffer = new Buffer();
+	buffer->write8(type);
+	for (unsigned int i = 1; i < size; i++)
+		buffer->write8(rand());
+	return buffer;
+}
+
+/**
+ * Simulates the network side of a server tick: Every client sends an input
+ * packet, the server broadcasts an event to all clients and sends every
+ * client its own update. The old code path copied every received packet
+ * into a buffer and every sent packet into a separate ENet packet.
+ */
+static void run(const char *name, bool zerocopy)
+{
+	std::vector<SimulatedPeer> peers(CLIENT_COUNT);
+	std::vector<Client*> clients;
+	for (unsigned int i = 0; i < CLIENT_COUNT; i++)
+	{
+		memset(&peers[i].peer, 0, sizeof(ENetPeer));
+		peers[i].peer.data = &peers[i];
+		clients.push_back(new Client(&peers[i].peer));
+	}
+	// The messages are created once, creating them costs the same in both
+	// cases
+	BufferPointer event = createMessage(EPT_ServerStatistics, 60);
+	std::vector<BufferPointer> updates;
+	for (unsigned int i = 0; i < CLIENT_COUNT; i++)
+		updates.push_back(createMessage(EPT_Update, 400));
+	std::vector<OutgoingPacketPointer> created;
+	created.reserve(CLIENT_COUNT * 2);
+	std::vector<BufferPointer> received;
+	received.reserve(CLIENT_COUNT);
+	unsigned long long bytes = 0;
+	allocations = 0;
+	copied = 0;
+	for (int tick = 0; tick < TICK_COUNT; tick++)
+	{
+		// Receive input
+		for (unsigned int i = 0; i < CLIENT_COUNT; i++)
+		{
+			ENetPacket *packet = receivePacket(EPT_Keys, 24);
+			bytes += packet->dataLength;
+			if (zerocopy)
+			{
+				received.push_back(new Buffer(packet->data,
+					packet->dataLength, releasePacket, packet));
+			}
+			else
+			{
+				received.push_back(new Buffer(packet->data,
+					packet->dataLength, true));
+				copied += packet->dataLength;
+				enet_packet_destroy(packet);
+			}
+		}
+		received.clear();
+		// Broadcast and per-client updates
+		OutgoingPacketPointer shared = OutgoingPacket::create(event, false);
+		for (unsigned int i = 0; i < CLIENT_COUNT; i++)
+		{
+			BufferPointer update = updates[i];
+			bytes += event->getSize() + update->getSize();
+			if (zerocopy)
+			{
+				clients[i]->sendPacket(shared);
+				clients[i]->sendRaw(update);
+			}
+			else
+			{
+				enet_peer_send(&peers[i].peer, ENC_Updates,
+					enet_packet_create(event->getData(), event->getSize(), 0));
+				enet_peer_send(&peers[i].peer, ENC_Updates,
+					enet_packet_create(update->getData(), update->getSize(),
+						0));
+			}
+		}
+		shared = 0;
+		for (unsigned int i = 0; i < CLIENT_COUNT; i++)
+			clients[i]->flushSendQueue(created);
+		for (unsigned int i = 0; i < created.size(); i++)
+			created[i]->release();
+		created.clear();
+		transmit(peers);
+	}
+	std::cout << name << ": " << (double)allocations / TICK_COUNT
+		<< " allocations/tick, " << (double)copied / TICK_COUNT
+		<< " bytes copied/tick, " << (double)bytes / TICK_COUNT
+		<< " bytes/tick sent or received" << std::endl;
+	for (unsigned int i = 0; i < CLIENT_COUNT; i++)
+		delete clients[i];
+}
+
+int main(int argc, char **argv)
+{
+	srand(42);
+	std::cout << CLIENT_COUNT << " clients" << std::endl;
+	run("Copying", false);
+	run("Zero-copy", true);
+	return 0;
+}
@@ -0,0 +1,83 @@
+#include "TickScheduler.hpp"
+#include "Engine.hpp"
+
+#include <iostream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace backlot;
+
+int main(int argc, char **argv)
+{
+	int sockets[2];
+	if (socketpair(AF_UNIX, SOCK_DGRAM, 0, sockets) == -1)
+	{
+		std::cout << "Could not create the sockets." << std::endl;
+		return 1;
+	}
+	TickScheduler &scheduler = TickScheduler::get();
+	if (!scheduler.init(sockets[0], 20000))
+	{
+		std::cout << "Could not start the scheduler." << std::endl;
+		return 1;
+	}
+	// Data has to be reported before the tick is due
+	uint64_t start = Engine::getTime();
+	char data = 0;
+	send(sockets[1], &data, 1, 0);
+	if (scheduler.wait() != ETE_Receive)
+	{
+		std::cout << "Error: Data was not reported." << std::endl;
+		return 1;
+	}
+	if (Engine::getTime() - start > 100000)
+	{
+		std::cout << "Error: Data was reported too late." << std::endl;
+		return 1;
+	}
+	recv(sockets[0], &data, 1, 0);
+	scheduler.onReceived();
+	// The rooms record the latency when they handle the packet
+	scheduler.getLatency().add(TickScheduler::getMonotonicTime()
+		- scheduler.getArrivalTime());
+	// Ticks keep their rate even if some of them are late
+	unsigned int ticks = 0;
+	while (ticks < 50)
+	{
+		if (scheduler.wait() != ETE_Tick)
+		{
+			std::cout << "Error: Unexpected data." << std::endl;
+			return 1;
+		}
+		ticks++;
+		if (ticks == 10)
+			usleep(50000);
+	}
+	uint64_t duration = Engine::getTime() - start;
+	std::cout << "50 ticks in " << duration << " us, max jitter "
+		<< scheduler.getJitter().getMaximum() << " us." << std::endl;
+	// The deadlines are absolute, so the ticks can never run faster. The
+	// upper limit is generous as machines running the tests may be busy.
+	if (duration < 990000 || duration > 2000000)
+	{
+		std::cout << "Error: Wrong tick rate." << std::endl;
+		return 1;
+	}
+	if (scheduler.getJitter().getCount() != 50
+		|| scheduler.getLatency().getCount() != 1)
+	{
+		std::cout << "Error: Wrong histogram counts." << std::endl;
+		return 1;
+	}
+	// The sleep delayed the next tick by more than a full tick
+	if (scheduler.getMissed() < 1)
+	{
+		std::cout << "Error: Late ticks were not counted." << std::endl;
+		return 1;
+	}
+	scheduler.destroy();
+	close(sockets[0]);
+	close(sockets[1]);
+	std::cout << "Done." << std::endl;
+	return 0;
+}
@@ -0,0 +1,82 @@
+#include "WorkerPool.hpp"
+#include "ReferenceCounted.hpp"
+
+#include <iostream>
+#include <vector>
+
+using namespace backlot;
+
+class Counted : public ReferenceCounted
+{
+	public:
+		Counted()
+		{
+			alive++;
+		}
+		~Counted()
+		{
+			alive--;
+		}
+
+		static int alive;
+};
+int Counted::alive = 0;
+
+struct TestData
+{
+	std::vector<unsigned int> results;
+	SharedPointer<Counted> shared;
+};
+
+static void square(unsigned int index, void *data)
+{
+	TestData *test = (TestData*)data;
+	test->results[index] = index * index;
+	// Copy the shared pointer around a lot
+	for (unsigned int i = 0; i < 1000; i++)
+	{
+		SharedPointer<Counted> copy = test->shared;
+		SharedPointer<Counted> other = copy;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int threadcounts[] = {0, 1, 4};
+	for (unsigned int t = 0; t < 3; t++)
+	{
+		std::cout << threadcounts[t] << " threads:" << std::endl;
+		WorkerPool workers;
+		if (!workers.init(threadcounts[t]))
+		{
+			std::cout << "Could not start threads." << std::endl;
+			return 1;
+		}
+		TestData test;
+		test.shared = new Counted();
+		// Run several tasks in a row to check that no worker misses one
+		for (unsigned int run = 0; run < 100; run++)
+		{
+			unsigned int count = run % 10 * 7;
+			test.results.assign(count, 0);
+			workers.run(square, &test, count);
+			for (unsigned int i = 0; i < count; i++)
+			{
+				if (test.results[i] != i * i)
+				{
+					std::cout << "Error: Index " << i << " not processed."
+						<< std::endl;
+					return 1;
+				}
+			}
+		}
+		test.shared = 0;
+		if (Counted::alive != 0)
+		{
+			std::cout << "Error: Object still alive." << std::endl;
+			return 1;
+		}
+	}
+	std::cout << "Done." << std::endl;
+	return 0;
+}